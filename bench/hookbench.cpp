@@ -0,0 +1,277 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+// Loads D2VDump the way Metamod would, against the stand-in engine in standins.h, and replays a
+// generated API through its real hooks, into a new VM each run. Each step is run on an unhooked VM
+// too, so the report can give what the hooks themselves cost per call, what they allocate on the
+// game thread, and how long Unload takes to write the dumps.
+
+#include "standins.h"
+#include "syntheticapi.h"
+
+#include "../d2vdump.h"
+
+#include <tier0/icommandline.h>
+#include <tier0/platform.h>
+#include <tier1/fmtstr.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <vector>
+
+// Every allocation is counted, and those made on the game thread are also counted separately.
+static std::atomic<uint64_t> s_nAllocs;
+static thread_local uint64_t t_nAllocs;
+
+void *operator new(size_t size)
+{
+	s_nAllocs.fetch_add(1, std::memory_order_relaxed);
+	++t_nAllocs;
+
+	void *p = malloc(size ? size : 1);
+	if (!p)
+		abort();
+
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+struct Step_t
+{
+	const char *pszName;
+	size_t calls;
+	std::function<void(IScriptVM *)> run;
+};
+
+struct Timing_t
+{
+	double flSeconds;
+	uint64_t allocs;
+};
+
+static Timing_t TimeStep(const Step_t &step, IScriptVM *pVM)
+{
+	uint64_t allocs = t_nAllocs;
+	double flStart = Plat_FloatTime();
+	step.run(pVM);
+
+	return Timing_t{ Plat_FloatTime() - flStart, t_nAllocs - allocs };
+}
+
+// Median time and most allocations of one step over every run.
+static Timing_t Summarise(std::vector<Timing_t> runs)
+{
+	std::sort(runs.begin(), runs.end(), [](const Timing_t &a, const Timing_t &b) { return a.flSeconds < b.flSeconds; });
+
+	Timing_t summary = runs[runs.size() / 2];
+	for (auto &run : runs)
+		summary.allocs = std::max(summary.allocs, run.allocs);
+
+	return summary;
+}
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: hookbench [-scale <n>] [-runs <n>] [-root <dir>] [-stats] [-vdump_journal] [+<convar> <value> ...]\n"
+		"  -scale          size of the generated API, as a multiple of Dota's main VM (default 1)\n"
+		"  -runs           VMs to replay it into, one after the other; the median run is reported (default 5)\n"
+		"  -root           directory the plugin's vdump/ is written under (default .)\n"
+		"  -stats          also print the plugin's own hook timings (vdump_stats) before unloading\n"
+		"  -vdump_journal  capture with the journal on, as the plugin's launch option does\n"
+		"  +<convar>       sets one of the plugin's ConVars before it loads, e.g. +vdump_compress 1\n");
+}
+
+int main(int argc, char **argv)
+{
+	float scale = 1.0f;
+	int runs = 5;
+	const char *pszRoot = ".";
+	bool bStats = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-scale") && i + 1 < argc)
+			scale = (float)atof(argv[++i]);
+		else if (!strcmp(argv[i], "-runs") && i + 1 < argc)
+			runs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-root") && i + 1 < argc)
+			pszRoot = argv[++i];
+		else if (!strcmp(argv[i], "-stats"))
+			bStats = true;
+		else if (!strcmp(argv[i], "-vdump_journal"))
+			continue;
+		else if (argv[i][0] == '+' && i + 1 < argc)
+		{
+			if (!SetConVar(argv[i] + 1, argv[i + 1]))
+			{
+				fprintf(stderr, "Unknown ConVar %s\n", argv[i] + 1);
+				return 1;
+			}
+			++i;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (scale <= 0.0f || runs < 1)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	CommandLine()->CreateCmdLine(argc, argv);
+
+	ReplayScriptManager scriptManager;
+	ReplayServer server;
+	ReplayFileSystem fileSystem(pszRoot);
+	ReplaySMAPI smapi(&scriptManager, &server, &fileSystem);
+
+	SyntheticAPIConfig_t config = SyntheticAPIConfig_t::Scaled(scale);
+	SyntheticAPI api(config);
+
+	// Array slots and string values aren't part of the generated API, so they're made up here,
+	// one of each per global, in a table set as a global of its own.
+	HSCRIPT hTable = (HSCRIPT)uintptr_t(0x1000);
+	uint32_t instances = config.classes * 10;
+	uint32_t frames = 10000;
+
+	std::vector<Step_t> steps;
+	steps.push_back(Step_t{ "RegisterScriptClass", api.ClassCount(), [&](IScriptVM *pVM) { api.RegisterClasses(pVM); } });
+	steps.push_back(Step_t{ "RegisterFunction", config.globalFuncs, [&](IScriptVM *pVM) { api.RegisterFunctions(pVM); } });
+	steps.push_back(Step_t{ "RegisterInstance", instances, [&](IScriptVM *pVM) { api.RegisterInstances(pVM, instances); } });
+	steps.push_back(Step_t{ "SetEnumValue", size_t(config.enums) * config.valuesPerEnum, [&](IScriptVM *pVM) { api.SetEnumValues(pVM); } });
+	steps.push_back(Step_t{ "SetValue (key)", config.globals, [&](IScriptVM *pVM) { api.SetValues(pVM); } });
+	steps.push_back(Step_t{ "SetValue (string)", config.globals, [&](IScriptVM *pVM) {
+		for (uint32_t g = 0; g < config.globals; ++g)
+			pVM->SetValue(nullptr, CFmtStr("SYNTHETIC_STRING_%06u", g), "Synthetic string");
+	} });
+	steps.push_back(Step_t{ "SetValue (index)", config.globals, [&](IScriptVM *pVM) {
+		pVM->SetValue(nullptr, "SYNTHETIC_TABLE", ScriptVariant_t(hTable));
+		for (uint32_t g = 0; g < config.globals; ++g)
+			pVM->SetValue(hTable, int(g), ScriptVariant_t(int(g)));
+	} });
+
+	// The same steps with nothing hooked, for the cost of the calls and the stand-ins alone.
+	std::vector<std::vector<Timing_t>> baseline(steps.size());
+	for (int r = 0; r < runs; ++r)
+	{
+		ReplayScriptVM vm;
+		for (size_t i = 0; i < steps.size(); ++i)
+			baseline[i].push_back(TimeStep(steps[i], &vm));
+	}
+
+	double flFrameStart = Plat_FloatTime();
+	for (uint32_t f = 0; f < frames; ++f)
+		server.GameFrame(true, f == 0, f + 1 == frames);
+	double flBaselineFrames = Plat_FloatTime() - flFrameStart;
+
+	char error[256] = "";
+	double flLoadStart = Plat_FloatTime();
+	if (!g_PLAPI->Load(0, &smapi, error, sizeof(error), false))
+	{
+		fprintf(stderr, "Load failed: %s\n", error);
+		return 1;
+	}
+	double flLoad = Plat_FloatTime() - flLoadStart;
+
+	// Each VM is destroyed before the next is created, as on a map change, so every run captures
+	// into the same slot from scratch. The last one is left up for Unload.
+	D2VDump *pPlugin = static_cast<D2VDump *>(g_PLAPI);
+	std::vector<std::vector<Timing_t>> hooked(steps.size());
+	IScriptVM *pVM = nullptr;
+	for (int r = 0; r < runs; ++r)
+	{
+		if (pVM)
+			scriptManager.DestroyVM(pVM);
+		pVM = scriptManager.CreateVM(SL_LUA);
+
+		// Each step starts with the capture worker idle, as after any burst of registrations, rather
+		// than with it still busy on the last step's, which would depend on the order they're run in.
+		for (size_t i = 0; i < steps.size(); ++i)
+		{
+			pPlugin->FlushCapture();
+			hooked[i].push_back(TimeStep(steps[i], pVM));
+		}
+	}
+
+	pPlugin->FlushCapture();
+	flFrameStart = Plat_FloatTime();
+	for (uint32_t f = 0; f < frames; ++f)
+		server.GameFrame(true, f == 0, f + 1 == frames);
+	double flHookedFrames = Plat_FloatTime() - flFrameStart;
+
+	printf("%gx: %u classes, %u functions, %u values, replayed through %s's hooks, median of %d runs\n\n", scale,
+		(unsigned)api.ClassCount(), (unsigned)api.FunctionCount(), (unsigned)api.ValueCount(), g_PLAPI->GetName(), runs);
+	printf("%-20s %8s %12s %12s %12s %10s\n", "Hook", "Calls", "Bare ns", "Hooked ns", "Hook ns", "Allocs");
+
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		Timing_t bare = Summarise(baseline[i]);
+		Timing_t hook = Summarise(hooked[i]);
+		double calls = double(steps[i].calls ? steps[i].calls : 1);
+		double flBare = bare.flSeconds * 1e9 / calls;
+		double flHooked = hook.flSeconds * 1e9 / calls;
+		printf("%-20s %8u %12.1f %12.1f %12.1f %10.2f\n", steps[i].pszName, (unsigned)steps[i].calls, flBare, flHooked, flHooked - flBare,
+			double(hook.allocs - std::min(hook.allocs, bare.allocs)) / calls);
+	}
+
+	printf("%-20s %8u %12.1f %12.1f %12.1f %10s\n", "GameFrame", frames, flBaselineFrames * 1e9 / frames, flHookedFrames * 1e9 / frames,
+		(flHookedFrames - flBaselineFrames) * 1e9 / frames, "-");
+	printf("\nHook ns is hooked minus bare; Allocs are the hooks' own, per call, on the game thread, in the worst run.\n");
+
+	if (bStats)
+	{
+		printf("\n");
+		StatsPrint([](const char *pszLine) { fputs(pszLine, stdout); });
+	}
+
+	// Unloads with the VM still up, as on server exit, so whatever the capture worker hasn't
+	// reached yet is part of it.
+	uint64_t allocs = s_nAllocs.load();
+	double flUnloadStart = Plat_FloatTime();
+	g_PLAPI->Unload(error, sizeof(error));
+	double flUnload = Plat_FloatTime() - flUnloadStart;
+	allocs = s_nAllocs.load() - allocs;
+
+	printf("\nLoad: %.3f ms\nUnload: %.3f ms, %u allocations\n", flLoad * 1000.0, flUnload * 1000.0, (unsigned)allocs);
+
+	// The manager's hooks went with Unload, so this is the stand-in's alone.
+	scriptManager.DestroyVM(pVM);
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+// Checks on ScriptModel that hookbench's timings wouldn't catch. Prints each failure and exits
+// non-zero if there were any.
+
+#include "../scriptmodel.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int s_nFailures;
+
+#define CHECK(expr) \
+	do { if (!(expr)) { fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #expr); ++s_nFailures; } } while (0)
+
+static HSCRIPT Handle(uintptr_t i)
+{
+	return (HSCRIPT)(0x10000 + i * 16);
+}
+
+// Handles passed around as values don't each become a scope. Only tables values are set in do.
+static void TestHandleValuesStayFlat()
+{
+	static const uintptr_t kHandles = 100000;
+
+	ScriptModel model;
+	for (uintptr_t i = 0; i < kHandles; ++i)
+	{
+		model.AddValue(nullptr, "hLast", ScriptVariant_t(Handle(i)), VM_Main);
+		model.AddValue(Handle(kHandles + i % 4), "hItem", ScriptVariant_t(Handle(i)), VM_Main);
+	}
+
+	const ScriptModel::VMCapture_t &vm = model.FindVM(VM_Main);
+	CHECK(vm.scopes.size() == 5); // The root and the four tables values were set in
+	CHECK(vm.globalConstants.Count() == 5);
+	CHECK(vm.pendingTables.Count() <= vm.globalConstants.Count());
+}
+
+// A table set as a value before anything was set in it still gets the path it was set under.
+static void TestTableSetBeforeUse()
+{
+	ScriptModel model;
+	model.AddValue(nullptr, "GameRules", ScriptVariant_t(Handle(1)), VM_Main);
+	model.AddValue(Handle(1), "Settings", ScriptVariant_t(Handle(2)), VM_Main);
+	model.AddValue(Handle(2), "nMaxPlayers", ScriptVariant_t(10), VM_Main);
+	model.AddValue(nullptr, "hUnused", ScriptVariant_t(Handle(3)), VM_Main);
+	model.AddValue(nullptr, "hUnused", ScriptVariant_t(4), VM_Main);
+	model.AddValue(Handle(3), "x", ScriptVariant_t(1), VM_Main);
+
+	const ScriptModel::VMCapture_t &vm = model.FindVM(VM_Main);
+	std::vector<std::string> paths;
+	ScriptModel::ScopePaths(vm, paths);
+
+	CHECK(vm.scopes.size() == 4);
+	CHECK(paths.size() == 4 && paths[1] == "GameRules" && paths[2] == "GameRules.Settings");
+	// No longer held by hUnused when values were set in it, so it was never seen set anywhere.
+	CHECK(paths.size() == 4 && paths[3] == "<table 3>");
+	CHECK(vm.pendingTables.Count() == 0);
+}
+
+// The values fingerprint follows what would be written out, not how it got there.
+static void TestValuesFingerprint()
+{
+	ScriptModel model;
+	model.AddValue(nullptr, "nRound", ScriptVariant_t(1), VM_Main);
+	model.AddValue(nullptr, "szMap", ScriptVariant_t("dota"), VM_Main);
+	uint64_t before = model.GetFingerprint(VM_Main, true);
+
+	model.AddValue(nullptr, "nRound", ScriptVariant_t(2), VM_Main);
+	CHECK(model.GetFingerprint(VM_Main, true) != before);
+	model.AddValue(nullptr, "nRound", ScriptVariant_t(1), VM_Main);
+	CHECK(model.GetFingerprint(VM_Main, true) == before);
+
+	// With history kept, the round trip shows up in it, so it does change what's written out.
+	model.SetValueHistory(4);
+	model.AddValue(nullptr, "nRound", ScriptVariant_t(2), VM_Main);
+	model.AddValue(nullptr, "nRound", ScriptVariant_t(1), VM_Main);
+	CHECK(model.GetFingerprint(VM_Main, true) != before);
+}
+
+int main()
+{
+	TestHandleValuesStayFlat();
+	TestTableSetBeforeUse();
+	TestValuesFingerprint();
+
+	if (s_nFailures)
+	{
+		fprintf(stderr, "%d checks failed\n", s_nFailures);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
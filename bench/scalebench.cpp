@@ -0,0 +1,117 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+// Generates an API at each scale given, captures it into a model of its own and renders it with
+// every dumper, printing the time per entity, the bytes the model holds and the size of each
+// rendering. Flat per-entity times across scales mean nothing grows superlinearly.
+
+#include "syntheticapi.h"
+
+#include "../binarydumper.h"
+#include "../jsondumper.h"
+#include "../outputbuffer.h"
+#include "../workerpool.h"
+
+#include <tier0/platform.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"usage: scalebench <scale> [<scale> ...]\n"
+		"  <scale>  size of a generated API, as a multiple of Dota's main VM, e.g. scalebench 1 10 100\n");
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<float> scales;
+	for (int i = 1; i < argc; ++i)
+	{
+		float scale = (float)atof(argv[i]);
+		if (scale <= 0.0f)
+		{
+			PrintUsage();
+			return 1;
+		}
+		scales.push_back(scale);
+	}
+
+	if (scales.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	JSONScriptDumper json;
+	BinaryScriptDumper binary;
+	IScriptDumper *dumpers[] = { &json, &binary };
+	WorkerPool pool;
+
+	for (float scale : scales)
+	{
+		double flStart = Plat_FloatTime();
+		SyntheticAPI api(SyntheticAPIConfig_t::Scaled(scale));
+		double flGenerated = Plat_FloatTime();
+
+		ScriptModel model;
+		api.Capture(model, VM_Main);
+		double flCaptured = Plat_FloatTime();
+
+		size_t entities = api.FunctionCount() + api.ValueCount();
+		printf("%gx: %u functions, %u values. Generated in %.1f ms, captured in %.1f ms (%.3f us each)\n",
+			scale, (unsigned)api.FunctionCount(), (unsigned)api.ValueCount(), (flGenerated - flStart) * 1000.0,
+			(flCaptured - flGenerated) * 1000.0, (flCaptured - flGenerated) * 1e6 / (entities ? entities : 1));
+
+		// What the model itself allocated, rather than the process's RSS.
+		size_t modelBytes = model.MemoryUsage(VM_Main);
+		printf("  Model: %.2f MB (%.0f bytes each)\n", modelBytes / (1024.0 * 1024.0), double(modelBytes) / (entities ? entities : 1));
+
+		for (auto d : dumpers)
+		{
+			double flRenderStart = Plat_FloatTime();
+			size_t bytes = 0;
+			{
+				OutputBuffer out;
+				d->SaveFunctions(out, model, VM_Main, pool);
+				bytes += out.Size();
+			}
+			if (d->HasValuesFile())
+			{
+				OutputBuffer out;
+				d->SaveValues(out, model, VM_Main, pool);
+				bytes += out.Size();
+			}
+			double flRendered = Plat_FloatTime() - flRenderStart;
+
+			printf("  %s: rendered %.2f MB in %.1f ms (%.3f us each)\n", d->GetOutputTypeName(), bytes / (1024.0 * 1024.0),
+				flRendered * 1000.0, flRendered * 1e6 / (entities ? entities : 1));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+// Stand-in for Metamod:Source's plugin API: just what D2VDump uses, with the engine's interfaces
+// handed out by the harness.
+
+#include <cstddef>
+
+#include "sourcehook.h"
+#include "tier1/convar.h"
+
+typedef int PluginId;
+typedef void *(*CreateInterfaceFn)(const char *pszName, int *pReturnCode);
+
+class ISmmAPI
+{
+public:
+	virtual void Format(char *buffer, size_t maxlength, const char *format, ...) = 0;
+	virtual void ConPrintf(const char *format, ...) = 0;
+	virtual bool RegisterConCommandBase(ConCommandBase *pCommand) = 0;
+
+	virtual CreateInterfaceFn GetEngineFactory(bool syn = true) = 0;
+	virtual CreateInterfaceFn GetFileSystemFactory(bool syn = true) = 0;
+	virtual CreateInterfaceFn GetServerFactory(bool syn = true) = 0;
+	// Any version at or above min will do. -1 only takes the exact one asked for.
+	virtual void *VInterfaceMatch(CreateInterfaceFn fn, const char *iface, int min = -1) = 0;
+};
+
+class ISmmPlugin
+{
+public:
+	virtual ~ISmmPlugin() {}
+
+	virtual bool Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool late) = 0;
+	virtual bool Unload(char *error, size_t maxlen) = 0;
+	virtual const char *GetAuthor() = 0;
+	virtual const char *GetName() = 0;
+	virtual const char *GetDescription() = 0;
+	virtual const char *GetURL() = 0;
+	virtual const char *GetLicense() = 0;
+	virtual const char *GetVersion() = 0;
+	virtual const char *GetDate() = 0;
+	virtual const char *GetLogTag() = 0;
+};
+
+#define PLUGIN_GLOBALVARS() extern ISmmAPI *g_SMAPI; extern ISmmPlugin *g_PLAPI; extern PluginId g_PLID
+#define PLUGIN_EXPOSE(name, var) ISmmAPI *g_SMAPI = nullptr; ISmmPlugin *g_PLAPI = &var; PluginId g_PLID = 0
+#define PLUGIN_SAVEVARS() g_SMAPI = ismm; g_PLID = id
+
+#define GET_V_IFACE_CURRENT(v_factory, v_var, v_type, v_name) \
+	v_var = (v_type *)ismm->VInterfaceMatch(ismm->v_factory(), v_name); \
+	if (!v_var) \
+	{ \
+		if (error && maxlen) \
+			ismm->Format(error, maxlen, "Could not find interface: %s", v_name); \
+		return false; \
+	}
+
+#define GET_V_IFACE_ANY(v_factory, v_var, v_type, v_name) \
+	v_var = (v_type *)ismm->VInterfaceMatch(ismm->v_factory(), v_name, 0); \
+	if (!v_var) \
+	{ \
+		if (error && maxlen) \
+			ismm->Format(error, maxlen, "Could not find interface: %s", v_name); \
+		return false; \
+	}
+
+#define META_REGCVAR(var) g_SMAPI->RegisterConCommandBase(var)
+#define META_CONPRINT(text) g_SMAPI->ConPrintf("%s", text)
+#define META_CONPRINTF g_SMAPI->ConPrintf
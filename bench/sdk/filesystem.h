@@ -0,0 +1,63 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include "tier0/platform.h"
+
+#define FILESYSTEM_INTERFACE_VERSION "VFileSystem017"
+
+typedef void *FileHandle_t;
+#define FILESYSTEM_INVALID_HANDLE (FileHandle_t)0
+
+enum FileSystemSeek_t
+{
+	FILESYSTEM_SEEK_HEAD = 0,
+	FILESYSTEM_SEEK_CURRENT,
+	FILESYSTEM_SEEK_TAIL,
+};
+
+// The engine's filesystem, less everything D2VDump doesn't call.
+class IFileSystem
+{
+public:
+	virtual int Read(void *pOutput, int size, FileHandle_t file) = 0;
+	virtual int Write(void const *pInput, int size, FileHandle_t file) = 0;
+	virtual FileHandle_t Open(const char *pFileName, const char *pOptions, const char *pathID = nullptr) = 0;
+	virtual void Close(FileHandle_t file) = 0;
+	virtual void Seek(FileHandle_t file, int pos, FileSystemSeek_t seekType) = 0;
+	virtual unsigned int Size(FileHandle_t file) = 0;
+	virtual unsigned int Size(const char *pFileName, const char *pPathID = nullptr) = 0;
+	virtual void Flush(FileHandle_t file) = 0;
+	virtual bool FileExists(const char *pFileName, const char *pPathID = nullptr) = 0;
+	virtual bool IsDirectory(const char *pFileName, const char *pathID = nullptr) = 0;
+	virtual void CreateDirHierarchy(const char *path, const char *pathID = nullptr) = 0;
+	virtual void RemoveFile(char const *pRelativePath, const char *pathID = nullptr) = 0;
+	virtual bool RenameFile(char const *pOldPath, char const *pNewPath, const char *pathID = nullptr) = 0;
+};
+
+int Q_snprintf(char *pDest, int maxLen, const char *pFormat, ...);
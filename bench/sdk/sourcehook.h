@@ -0,0 +1,262 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+// Stand-in for SourceHook. Instead of patching vtables, the stand-in interfaces route each call
+// through SourceHook::Dispatch, which runs the hooks added with SH_ADD_HOOK around the original the
+// way SourceHook does: pre hooks, the original unless a pre hook supercedes it, then post hooks.
+// Single threaded, like the game thread the real hooks fire on.
+
+#include <cstring>
+#include <vector>
+
+enum META_RES
+{
+	MRES_IGNORED = 1,
+	MRES_HANDLED,
+	MRES_OVERRIDE,
+	MRES_SUPERCEDE
+};
+
+#define SH_NOATTRIB
+
+namespace SourceHook
+{
+	template <class T> struct Identity { typedef T type; };
+
+	// A member function bound to an object. Two are equal when they bind the same method on the same object.
+	template <class F> class Delegate;
+
+	template <class R, class... A> class Delegate<R(A...)>
+	{
+	public:
+		template <class C> Delegate(C *pObject, R (C::*pfnMethod)(A...)) : m_pObject(pObject), m_pfnThunk(&Thunk<C>)
+		{
+			static_assert(sizeof(pfnMethod) <= sizeof(m_Method), "Member function pointer too big");
+			memset(m_Method, 0, sizeof(m_Method));
+			memcpy(m_Method, &pfnMethod, sizeof(pfnMethod));
+		}
+
+		R operator()(A... args) const { return m_pfnThunk(*this, args...); }
+
+		bool operator==(const Delegate &other) const
+		{
+			return m_pObject == other.m_pObject && m_pfnThunk == other.m_pfnThunk && !memcmp(m_Method, other.m_Method, sizeof(m_Method));
+		}
+
+	private:
+		template <class C> static R Thunk(const Delegate &d, A... args)
+		{
+			R (C::*pfnMethod)(A...);
+			memcpy(&pfnMethod, d.m_Method, sizeof(pfnMethod));
+			return (static_cast<C *>(d.m_pObject)->*pfnMethod)(args...);
+		}
+
+	private:
+		void *m_pObject;
+		R (*m_pfnThunk)(const Delegate &, A...);
+		char m_Method[2 * sizeof(void *)];
+	};
+
+	template <class C, class R, class... A> Delegate<R(A...)> MakeDelegate(C *pObject, R (C::*pfnMethod)(A...))
+	{
+		return Delegate<R(A...)>(pObject, pfnMethod);
+	}
+
+	// What the hook being run sees through META_IFACEPTR and reports through RETURN_META.
+	struct CallState_t
+	{
+		void *pIface = nullptr;
+		META_RES status = MRES_IGNORED;
+		bool bBypass = false; // Set by SH_CALL, so the next call goes straight to the original
+	};
+
+	inline CallState_t &GetCallState()
+	{
+		static CallState_t state;
+		return state;
+	}
+
+	// Hooks on one method of one interface instance.
+	template <class I, class R, class... A> struct HookList_t
+	{
+		I *pIface;
+		R (I::*pfnMethod)(A...);
+		std::vector<Delegate<R(A...)>> pre;
+		std::vector<Delegate<R(A...)>> post;
+	};
+
+	template <class I, class R, class... A> HookList_t<I, R, A...> *FindHooks(I *pIface, R (I::*pfnMethod)(A...), bool bCreate)
+	{
+		static std::vector<HookList_t<I, R, A...> *> lists;
+
+		for (auto pList : lists)
+		{
+			if (pList->pIface == pIface && pList->pfnMethod == pfnMethod)
+				return pList;
+		}
+
+		if (!bCreate)
+			return nullptr;
+
+		lists.push_back(new HookList_t<I, R, A...>{ pIface, pfnMethod, {}, {} });
+		return lists.back();
+	}
+
+	template <class I, class R, class... A> void AddHook(I *pIface, R (I::*pfnMethod)(A...), const Delegate<R(A...)> &handler, bool bPost)
+	{
+		HookList_t<I, R, A...> *pList = FindHooks(pIface, pfnMethod, true);
+		(bPost ? pList->post : pList->pre).push_back(handler);
+	}
+
+	template <class I, class R, class... A> void RemoveHook(I *pIface, R (I::*pfnMethod)(A...), const Delegate<R(A...)> &handler, bool bPost)
+	{
+		HookList_t<I, R, A...> *pList = FindHooks(pIface, pfnMethod, false);
+		if (!pList)
+			return;
+
+		auto &hooks = bPost ? pList->post : pList->pre;
+		for (size_t i = 0; i < hooks.size(); ++i)
+		{
+			if (hooks[i] == handler)
+			{
+				hooks.erase(hooks.begin() + i);
+				return;
+			}
+		}
+	}
+
+	// Holds the value a call returns, if it returns one.
+	template <class R> struct Result_t
+	{
+		R value = R();
+		template <class F> void Call(const F &f) { value = f(); }
+		R Get() const { return value; }
+	};
+
+	template <> struct Result_t<void>
+	{
+		template <class F> void Call(const F &f) { f(); }
+		void Get() const {}
+	};
+
+	// Calls pfnOriginal on pThis with whatever hooks there are on pfnMethod around it.
+	template <class I, class C, class R, class... A>
+	R Dispatch(C *pThis, R (I::*pfnMethod)(A...), R (C::*pfnOriginal)(A...), typename Identity<A>::type... args)
+	{
+		CallState_t &state = GetCallState();
+		HookList_t<I, R, A...> *pList = state.bBypass ? nullptr : FindHooks(static_cast<I *>(pThis), pfnMethod, false);
+		state.bBypass = false;
+
+		if (!pList || (pList->pre.empty() && pList->post.empty()))
+			return (pThis->*pfnOriginal)(args...);
+
+		CallState_t outer = state;
+		state.pIface = static_cast<I *>(pThis);
+
+		Result_t<R> result;
+		META_RES highest = MRES_IGNORED;
+		for (size_t i = 0; i < pList->pre.size(); ++i)
+		{
+			state.status = MRES_IGNORED;
+			Result_t<R> hookResult;
+			hookResult.Call([&]() { return pList->pre[i](args...); });
+			if (state.status >= MRES_OVERRIDE && state.status >= highest)
+				result = hookResult;
+			if (state.status > highest)
+				highest = state.status;
+		}
+
+		if (highest < MRES_SUPERCEDE)
+		{
+			Result_t<R> origResult;
+			origResult.Call([&]() { return (pThis->*pfnOriginal)(args...); });
+			if (highest < MRES_OVERRIDE)
+				result = origResult;
+		}
+
+		for (size_t i = 0; i < pList->post.size(); ++i)
+		{
+			state.status = MRES_IGNORED;
+			Result_t<R> hookResult;
+			hookResult.Call([&]() { return pList->post[i](args...); });
+			if (state.status >= MRES_OVERRIDE)
+				result = hookResult;
+		}
+
+		state = outer;
+		return result.Get();
+	}
+
+	// What SH_CALL returns: calls the original, skipping any hooks.
+	template <class I, class R, class... A> class CallClass
+	{
+	public:
+		CallClass(I *pIface, R (I::*pfnMethod)(A...)) : m_pIface(pIface), m_pfnMethod(pfnMethod) {}
+
+		R operator()(A... args) const
+		{
+			GetCallState().bBypass = true;
+			return (m_pIface->*m_pfnMethod)(args...);
+		}
+
+	private:
+		I *m_pIface;
+		R (I::*m_pfnMethod)(A...);
+	};
+
+	template <class I, class R, class... A> CallClass<I, R, A...> MakeCallClass(I *pIface, R (I::*pfnMethod)(A...))
+	{
+		return CallClass<I, R, A...>(pIface, pfnMethod);
+	}
+}
+
+// Declarations only check the method exists with that signature, as hooks are looked up by method.
+#define SH_DECL_STANDIN(iface, method, rettype, ...) \
+	static_assert(sizeof(static_cast<rettype (iface::*)(__VA_ARGS__)>(&iface::method)) != 0, #iface "::" #method)
+
+#define SH_DECL_HOOK1(iface, method, attr, overload, rettype, p1) SH_DECL_STANDIN(iface, method, rettype, p1)
+#define SH_DECL_HOOK2(iface, method, attr, overload, rettype, p1, p2) SH_DECL_STANDIN(iface, method, rettype, p1, p2)
+#define SH_DECL_HOOK3(iface, method, attr, overload, rettype, p1, p2, p3) SH_DECL_STANDIN(iface, method, rettype, p1, p2, p3)
+#define SH_DECL_HOOK4(iface, method, attr, overload, rettype, p1, p2, p3, p4) SH_DECL_STANDIN(iface, method, rettype, p1, p2, p3, p4)
+#define SH_DECL_HOOK5(iface, method, attr, overload, rettype, p1, p2, p3, p4, p5) SH_DECL_STANDIN(iface, method, rettype, p1, p2, p3, p4, p5)
+
+#define SH_DECL_HOOK1_void(iface, method, attr, overload, p1) SH_DECL_STANDIN(iface, method, void, p1)
+#define SH_DECL_HOOK2_void(iface, method, attr, overload, p1, p2) SH_DECL_STANDIN(iface, method, void, p1, p2)
+#define SH_DECL_HOOK3_void(iface, method, attr, overload, p1, p2, p3) SH_DECL_STANDIN(iface, method, void, p1, p2, p3)
+#define SH_DECL_HOOK4_void(iface, method, attr, overload, p1, p2, p3, p4) SH_DECL_STANDIN(iface, method, void, p1, p2, p3, p4)
+#define SH_DECL_HOOK5_void(iface, method, attr, overload, p1, p2, p3, p4, p5) SH_DECL_STANDIN(iface, method, void, p1, p2, p3, p4, p5)
+
+// Overloads are told apart by the handler's signature, as SourceHook does.
+#define SH_ADD_HOOK(iface, method, pIface, handler, post) SourceHook::AddHook<iface>(pIface, &iface::method, handler, post)
+#define SH_REMOVE_HOOK(iface, method, pIface, handler, post) SourceHook::RemoveHook<iface>(pIface, &iface::method, handler, post)
+#define SH_MEMBER(pObject, pfnMethod) SourceHook::MakeDelegate(pObject, pfnMethod)
+#define SH_CALL(pIface, pfnMethod) SourceHook::MakeCallClass(pIface, pfnMethod)
+
+#define META_IFACEPTR(type) static_cast<type *>(SourceHook::GetCallState().pIface)
+#define SET_META_RESULT(result) SourceHook::GetCallState().status = (result)
+#define RETURN_META(result) do { SET_META_RESULT(result); return; } while (0)
+#define RETURN_META_VALUE(result, value) do { SET_META_RESULT(result); return (value); } while (0)
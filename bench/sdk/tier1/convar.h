@@ -0,0 +1,118 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "iconvar.h"
+
+#include <string>
+#include <vector>
+
+#define FCVAR_NONE 0
+
+class CCommand
+{
+public:
+	CCommand() {}
+	CCommand(int argc, const char **argv) : m_Args(argv, argv + argc) {}
+
+	int ArgC() const { return (int)m_Args.size(); }
+	const char *Arg(int index) const { return index < ArgC() ? m_Args[index].c_str() : ""; }
+	const char *operator[](int index) const { return Arg(index); }
+
+private:
+	std::vector<std::string> m_Args;
+};
+
+// Every command and variable links itself into one list as it's constructed. ConVar_Register hands
+// them all to the accessor, the same as tier1 does.
+class ConCommandBase
+{
+public:
+	ConCommandBase(const char *pszName, const char *pszHelpString, int flags);
+	virtual ~ConCommandBase() {}
+
+	virtual bool IsCommand() const = 0;
+
+	const char *GetName() const { return m_pszName; }
+	const char *GetHelpText() const { return m_pszHelpString; }
+	ConCommandBase *GetNext() const { return m_pNext; }
+
+	static ConCommandBase *GetFirst();
+
+private:
+	const char *m_pszName;
+	const char *m_pszHelpString;
+	int m_nFlags;
+	ConCommandBase *m_pNext;
+};
+
+class ConVar : public ConCommandBase
+{
+public:
+	ConVar(const char *pszName, const char *pszDefaultValue, int flags = 0);
+	ConVar(const char *pszName, const char *pszDefaultValue, int flags, const char *pszHelpString);
+	ConVar(const char *pszName, const char *pszDefaultValue, int flags, const char *pszHelpString, bool bMin, float fMin, bool bMax, float fMax);
+
+	bool IsCommand() const override { return false; }
+
+	float GetFloat() const { return m_fValue; }
+	int GetInt() const { return m_nValue; }
+	bool GetBool() const { return !!m_nValue; }
+	const char *GetString() const { return m_Value.c_str(); }
+
+	// Numbers outside the bounds are clamped to them.
+	void SetValue(const char *pszValue);
+
+private:
+	std::string m_Value;
+	float m_fValue;
+	int m_nValue;
+	bool m_bHasMin;
+	float m_fMin;
+	bool m_bHasMax;
+	float m_fMax;
+};
+
+typedef void (*FnCommandCallback_t)(const CCommand &command);
+
+class ConCommand : public ConCommandBase
+{
+public:
+	ConCommand(const char *pszName, FnCommandCallback_t callback, const char *pszHelpString = nullptr, int flags = 0);
+
+	bool IsCommand() const override { return true; }
+
+	void Dispatch(const CCommand &command) { m_fnCallback(command); }
+
+private:
+	FnCommandCallback_t m_fnCallback;
+};
+
+// Not every command reads its arguments.
+#define CON_COMMAND(name, description) \
+	static void name(const CCommand &args); \
+	static ConCommand name##_command(#name, name, description); \
+	static void name(const CCommand &args __attribute__((unused)))
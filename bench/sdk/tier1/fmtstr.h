@@ -0,0 +1,53 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <cstdarg>
+#include <cstdio>
+
+#define FMTSTR_STD_LEN 256
+
+// Formats into a fixed buffer, truncating like the SDK's.
+template <int SIZE_BUF> class CFmtStrN
+{
+public:
+	CFmtStrN() { m_szBuf[0] = '\0'; }
+	CFmtStrN(const char *pszFormat, ...)
+	{
+		va_list args;
+		va_start(args, pszFormat);
+		vsnprintf(m_szBuf, SIZE_BUF, pszFormat, args);
+		va_end(args);
+	}
+
+	const char *Get() const { return m_szBuf; }
+	operator const char *() const { return m_szBuf; }
+
+private:
+	char m_szBuf[SIZE_BUF];
+};
+
+typedef CFmtStrN<FMTSTR_STD_LEN> CFmtStr;
@@ -0,0 +1,54 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <vector>
+
+template <class T> class CUtlVector
+{
+public:
+	T &operator[](int i) { return m_Memory[i]; }
+	const T &operator[](int i) const { return m_Memory[i]; }
+	int Count() const { return (int)m_Memory.size(); }
+
+	// Returns the index of the new, value initialised, element.
+	int AddToTail()
+	{
+		m_Memory.emplace_back();
+		return Count() - 1;
+	}
+
+	int AddToTail(const T &src)
+	{
+		m_Memory.push_back(src);
+		return Count() - 1;
+	}
+
+private:
+	std::vector<T> m_Memory;
+};
+
+#define FOR_EACH_VEC(vecName, iteratorName) for (int iteratorName = 0; iteratorName < (vecName).Count(); iteratorName++)
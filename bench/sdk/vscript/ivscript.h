@@ -0,0 +1,147 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+// Stand-in for the VScript interfaces: the descriptors as the game lays them out, and only the
+// IScriptVM methods D2VDump hooks.
+
+#include <cstdint>
+
+#include "../mathlib/vector.h"
+#include "../tier1/utlvector.h"
+
+#define VSCRIPT_INTERFACE_VERSION "VScriptManager010"
+
+enum ScriptLanguage_t
+{
+	SL_NONE,
+	SL_LUA,
+};
+
+enum ScriptDataType_t
+{
+	FIELD_VOID = 0,
+	FIELD_FLOAT,
+	FIELD_VECTOR,
+	FIELD_QUATERNION,
+	FIELD_INTEGER,
+	FIELD_BOOLEAN,
+	FIELD_CHARACTER,
+	FIELD_COLOR32,
+	FIELD_EHANDLE,
+	FIELD_VECTOR2D,
+	FIELD_VECTOR4D,
+	FIELD_INTEGER64,
+	FIELD_RESOURCE,
+	FIELD_CSTRING,
+	FIELD_HSCRIPT,
+	FIELD_VARIANT,
+	FIELD_UINT64,
+	FIELD_FLOAT64,
+	FIELD_UINT,
+	FIELD_UTLSTRINGTOKEN,
+	FIELD_QANGLE,
+	FIELD_TYPEUNKNOWN,
+};
+
+typedef struct HSCRIPT__ *HSCRIPT;
+#define INVALID_HSCRIPT ((HSCRIPT)-1)
+
+#define SV_FREE 0x01
+
+struct ScriptFuncDescriptor_t
+{
+	const char *m_pszScriptName = nullptr;
+	const char *m_pszFunction = nullptr;
+	const char *m_pszDescription = nullptr;
+	ScriptDataType_t m_ReturnType = FIELD_VOID;
+	int m_iParamCount = 0;
+	ScriptDataType_t m_Parameters[16];
+	const char *m_pszParameterNames = nullptr; // Back to back, each null terminated
+};
+
+struct ScriptFunctionBinding_t
+{
+	ScriptFuncDescriptor_t m_desc;
+	void *m_pfnBinding = nullptr;
+	void *m_pFunction = nullptr;
+	unsigned m_flags = 0;
+};
+
+struct ScriptClassDesc_t
+{
+	const char *m_pszScriptName = nullptr;
+	const char *m_pszClassname = nullptr;
+	const char *m_pszDescription = nullptr;
+	ScriptClassDesc_t *m_pBaseDesc = nullptr;
+	CUtlVector<ScriptFunctionBinding_t> m_FunctionBindings;
+};
+
+struct ScriptVariant_t
+{
+	ScriptVariant_t() : m_int(0), m_type(FIELD_VOID), m_flags(0) {}
+	ScriptVariant_t(int val) : m_int(val), m_type(FIELD_INTEGER), m_flags(0) {}
+	ScriptVariant_t(unsigned val) : m_uint(val), m_type(FIELD_UINT), m_flags(0) {}
+	ScriptVariant_t(float val) : m_float(val), m_type(FIELD_FLOAT), m_flags(0) {}
+	ScriptVariant_t(bool val) : m_bool(val), m_type(FIELD_BOOLEAN), m_flags(0) {}
+	ScriptVariant_t(const char *val) : m_pszString(val), m_type(FIELD_CSTRING), m_flags(0) {}
+	ScriptVariant_t(const Vector *val) : m_pVector(const_cast<Vector *>(val)), m_type(FIELD_VECTOR), m_flags(0) {}
+	ScriptVariant_t(HSCRIPT val) : m_hScript(val), m_type(FIELD_HSCRIPT), m_flags(0) {}
+
+	union
+	{
+		int m_int;
+		unsigned m_uint;
+		float m_float;
+		bool m_bool;
+		const char *m_pszString;
+		Vector *m_pVector;
+		HSCRIPT m_hScript;
+	};
+
+	int16_t m_type;
+	int16_t m_flags;
+};
+
+class IScriptVM
+{
+public:
+	virtual void RegisterFunction(ScriptFunctionBinding_t *pScriptFunction) = 0;
+	virtual bool RegisterScriptClass(ScriptClassDesc_t *pClassDesc) = 0;
+	virtual HSCRIPT RegisterInstance(ScriptClassDesc_t *pDesc, void *pInstance) = 0;
+	virtual bool SetValue(HSCRIPT hScope, const char *pszKey, const char *pszValue) = 0;
+	virtual bool SetValue(HSCRIPT hScope, const char *pszKey, const ScriptVariant_t &value) = 0;
+	virtual bool SetValue(HSCRIPT hScope, int nIndex, const ScriptVariant_t &value) = 0;
+	// Also sets the value itself, through SetValue.
+	virtual bool SetEnumValue(HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription) = 0;
+};
+
+class IScriptManager
+{
+public:
+	virtual IScriptVM *CreateVM(ScriptLanguage_t language) = 0;
+	virtual void DestroyVM(IScriptVM *pVM) = 0;
+};
@@ -0,0 +1,363 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "standins.h"
+
+#include <tier0/icommandline.h>
+#include <tier0/platform.h>
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+
+static IScriptManager *s_pScriptManager;
+static ISource2Server *s_pServer;
+static IFileSystem *s_pFileSystem;
+
+// tier0
+
+double Plat_FloatTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Console output goes to stderr, leaving stdout to the harness's report.
+static void ConsolePrint(const char *pszFormat, va_list args)
+{
+	vfprintf(stderr, pszFormat, args);
+}
+
+void Msg(const char *pszFormat, ...)
+{
+	va_list args;
+	va_start(args, pszFormat);
+	ConsolePrint(pszFormat, args);
+	va_end(args);
+}
+
+void DevMsg(const char *pszFormat, ...)
+{
+	va_list args;
+	va_start(args, pszFormat);
+	ConsolePrint(pszFormat, args);
+	va_end(args);
+}
+
+void Warning(const char *pszFormat, ...)
+{
+	va_list args;
+	va_start(args, pszFormat);
+	ConsolePrint(pszFormat, args);
+	va_end(args);
+}
+
+int Q_snprintf(char *pDest, int maxLen, const char *pFormat, ...)
+{
+	va_list args;
+	va_start(args, pFormat);
+	int len = vsnprintf(pDest, maxLen, pFormat, args);
+	va_end(args);
+
+	return len;
+}
+
+static class ReplayCommandLine : public ICommandLine
+{
+public:
+	void CreateCmdLine(int argc, char **argv) override
+	{
+		m_argc = argc;
+		m_argv = argv;
+	}
+
+	bool HasParm(const char *psz) override
+	{
+		return FindParm(psz) != 0;
+	}
+
+	const char *ParmValue(const char *psz, const char *pDefaultVal = nullptr) override
+	{
+		int i = FindParm(psz);
+		return i && i + 1 < m_argc ? m_argv[i + 1] : pDefaultVal;
+	}
+
+private:
+	int FindParm(const char *psz) const
+	{
+		for (int i = 1; i < m_argc; ++i)
+		{
+			if (!strcmp(m_argv[i], psz))
+				return i;
+		}
+
+		return 0;
+	}
+
+private:
+	int m_argc = 0;
+	char **m_argv = nullptr;
+} s_CommandLine;
+
+ICommandLine *CommandLine()
+{
+	return &s_CommandLine;
+}
+
+// tier1
+
+static ConCommandBase *&FirstConCommandBase()
+{
+	// Reached from other files' static constructors, so it can't be a plain global.
+	static ConCommandBase *pFirst = nullptr;
+	return pFirst;
+}
+
+ConCommandBase::ConCommandBase(const char *pszName, const char *pszHelpString, int flags)
+	: m_pszName(pszName), m_pszHelpString(pszHelpString ? pszHelpString : ""), m_nFlags(flags), m_pNext(FirstConCommandBase())
+{
+	FirstConCommandBase() = this;
+}
+
+ConCommandBase *ConCommandBase::GetFirst()
+{
+	return FirstConCommandBase();
+}
+
+ConVar::ConVar(const char *pszName, const char *pszDefaultValue, int flags)
+	: ConVar(pszName, pszDefaultValue, flags, nullptr, false, 0.0f, false, 0.0f)
+{
+}
+
+ConVar::ConVar(const char *pszName, const char *pszDefaultValue, int flags, const char *pszHelpString)
+	: ConVar(pszName, pszDefaultValue, flags, pszHelpString, false, 0.0f, false, 0.0f)
+{
+}
+
+ConVar::ConVar(const char *pszName, const char *pszDefaultValue, int flags, const char *pszHelpString, bool bMin, float fMin, bool bMax, float fMax)
+	: ConCommandBase(pszName, pszHelpString, flags), m_bHasMin(bMin), m_fMin(fMin), m_bHasMax(bMax), m_fMax(fMax)
+{
+	SetValue(pszDefaultValue);
+}
+
+void ConVar::SetValue(const char *pszValue)
+{
+	float fValue = (float)atof(pszValue);
+	if (m_bHasMin && fValue < m_fMin)
+		fValue = m_fMin;
+	if (m_bHasMax && fValue > m_fMax)
+		fValue = m_fMax;
+
+	char szClamped[32];
+	if (fValue != (float)atof(pszValue))
+	{
+		snprintf(szClamped, sizeof(szClamped), "%g", fValue);
+		pszValue = szClamped;
+	}
+
+	m_Value = pszValue;
+	m_fValue = fValue;
+	m_nValue = (int)fValue;
+}
+
+ConCommand::ConCommand(const char *pszName, FnCommandCallback_t callback, const char *pszHelpString, int flags)
+	: ConCommandBase(pszName, pszHelpString, flags), m_fnCallback(callback)
+{
+}
+
+static class ReplayCvar : public ICvar
+{
+public:
+	ConVar *FindVar(const char *pszName) override
+	{
+		ConCommandBase *pBase = Find(pszName);
+		return pBase && !pBase->IsCommand() ? static_cast<ConVar *>(pBase) : nullptr;
+	}
+
+	ConCommand *FindCommand(const char *pszName) override
+	{
+		ConCommandBase *pBase = Find(pszName);
+		return pBase && pBase->IsCommand() ? static_cast<ConCommand *>(pBase) : nullptr;
+	}
+
+private:
+	static ConCommandBase *Find(const char *pszName)
+	{
+		for (ConCommandBase *pBase = ConCommandBase::GetFirst(); pBase; pBase = pBase->GetNext())
+		{
+			if (!strcmp(pBase->GetName(), pszName))
+				return pBase;
+		}
+
+		return nullptr;
+	}
+} s_Cvar;
+
+ICvar *g_pCVar;
+
+void ConVar_Register(int, IConCommandBaseAccessor *pAccessor)
+{
+	for (ConCommandBase *pBase = ConCommandBase::GetFirst(); pBase; pBase = pBase->GetNext())
+		pAccessor->RegisterConCommandBase(pBase);
+}
+
+bool SetConVar(const char *pszName, const char *pszValue)
+{
+	ConVar *pVar = s_Cvar.FindVar(pszName);
+	if (!pVar)
+		return false;
+
+	pVar->SetValue(pszValue);
+	return true;
+}
+
+// Filesystem
+
+int ReplayFileSystem::Read(void *pOutput, int size, FileHandle_t file)
+{
+	return (int)fread(pOutput, 1, size, (FILE *)file);
+}
+
+int ReplayFileSystem::Write(void const *pInput, int size, FileHandle_t file)
+{
+	return (int)fwrite(pInput, 1, size, (FILE *)file);
+}
+
+FileHandle_t ReplayFileSystem::Open(const char *pFileName, const char *pOptions, const char *)
+{
+	// Always binary, as the engine's is. Text mode only differs on Windows anyway.
+	std::string mode(pOptions);
+	if (mode.find('b') == std::string::npos)
+		mode += 'b';
+
+	return (FileHandle_t)fopen(FullPath(pFileName).c_str(), mode.c_str());
+}
+
+void ReplayFileSystem::Close(FileHandle_t file)
+{
+	fclose((FILE *)file);
+}
+
+void ReplayFileSystem::Seek(FileHandle_t file, int pos, FileSystemSeek_t seekType)
+{
+	static const int origins[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+	fseek((FILE *)file, pos, origins[seekType]);
+}
+
+unsigned int ReplayFileSystem::Size(FileHandle_t file)
+{
+	struct stat st;
+	return fstat(fileno((FILE *)file), &st) ? 0 : (unsigned int)st.st_size;
+}
+
+unsigned int ReplayFileSystem::Size(const char *pFileName, const char *)
+{
+	struct stat st;
+	return stat(FullPath(pFileName).c_str(), &st) ? 0 : (unsigned int)st.st_size;
+}
+
+void ReplayFileSystem::Flush(FileHandle_t file)
+{
+	fflush((FILE *)file);
+}
+
+bool ReplayFileSystem::FileExists(const char *pFileName, const char *)
+{
+	struct stat st;
+	return !stat(FullPath(pFileName).c_str(), &st);
+}
+
+bool ReplayFileSystem::IsDirectory(const char *pFileName, const char *)
+{
+	struct stat st;
+	return !stat(FullPath(pFileName).c_str(), &st) && S_ISDIR(st.st_mode);
+}
+
+void ReplayFileSystem::CreateDirHierarchy(const char *path, const char *)
+{
+	std::string full = FullPath(path);
+	for (size_t i = m_Root.size() + 1; i <= full.size(); ++i)
+	{
+		if (i == full.size() || full[i] == '/')
+			mkdir(full.substr(0, i).c_str(), 0755);
+	}
+}
+
+void ReplayFileSystem::RemoveFile(char const *pRelativePath, const char *)
+{
+	remove(FullPath(pRelativePath).c_str());
+}
+
+bool ReplayFileSystem::RenameFile(char const *pOldPath, char const *pNewPath, const char *)
+{
+	return !rename(FullPath(pOldPath).c_str(), FullPath(pNewPath).c_str());
+}
+
+// Metamod
+
+ReplaySMAPI::ReplaySMAPI(IScriptManager *pScriptManager, ISource2Server *pServer, IFileSystem *pFileSystem)
+{
+	s_pScriptManager = pScriptManager;
+	s_pServer = pServer;
+	s_pFileSystem = pFileSystem;
+}
+
+void ReplaySMAPI::Format(char *buffer, size_t maxlength, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, maxlength, format, args);
+	va_end(args);
+}
+
+void ReplaySMAPI::ConPrintf(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	ConsolePrint(format, args);
+	va_end(args);
+}
+
+void *ReplaySMAPI::VInterfaceMatch(CreateInterfaceFn fn, const char *iface, int)
+{
+	return fn(iface, nullptr);
+}
+
+void *ReplaySMAPI::CreateInterface(const char *pszName, int *)
+{
+	if (!strcmp(pszName, VSCRIPT_INTERFACE_VERSION))
+		return s_pScriptManager;
+	if (!strcmp(pszName, INTERFACEVERSION_SERVERGAMEDLL))
+		return s_pServer;
+	if (!strcmp(pszName, FILESYSTEM_INTERFACE_VERSION))
+		return s_pFileSystem;
+	if (!strcmp(pszName, CVAR_INTERFACE_VERSION))
+		return &s_Cvar;
+
+	return nullptr;
+}
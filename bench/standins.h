@@ -0,0 +1,174 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+// Stand-ins for the engine interfaces D2VDump takes from Metamod. Every hookable call goes through
+// SourceHook::Dispatch, so the plugin's real hooks run around it.
+
+#include <ISmmPlugin.h>
+#include <eiface.h>
+#include <filesystem.h>
+#include <icvar.h>
+#include <vscript/ivscript.h>
+
+#include <string>
+
+// Does as little as a VM can, so what's timed is the hooks around it.
+class ReplayScriptVM final : public IScriptVM
+{
+public:
+	void RegisterFunction(ScriptFunctionBinding_t *pScriptFunction) override
+	{
+		SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::RegisterFunction, &ReplayScriptVM::DoRegisterFunction, pScriptFunction);
+	}
+
+	bool RegisterScriptClass(ScriptClassDesc_t *pClassDesc) override
+	{
+		return SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::RegisterScriptClass, &ReplayScriptVM::DoRegisterScriptClass, pClassDesc);
+	}
+
+	HSCRIPT RegisterInstance(ScriptClassDesc_t *pDesc, void *pInstance) override
+	{
+		return SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::RegisterInstance, &ReplayScriptVM::DoRegisterInstance, pDesc, pInstance);
+	}
+
+	bool SetValue(HSCRIPT hScope, const char *pszKey, const char *pszValue) override
+	{
+		return SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::SetValue, &ReplayScriptVM::DoSetValueString, hScope, pszKey, pszValue);
+	}
+
+	bool SetValue(HSCRIPT hScope, const char *pszKey, const ScriptVariant_t &value) override
+	{
+		return SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::SetValue, &ReplayScriptVM::DoSetValue, hScope, pszKey, value);
+	}
+
+	bool SetValue(HSCRIPT hScope, int nIndex, const ScriptVariant_t &value) override
+	{
+		return SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::SetValue, &ReplayScriptVM::DoSetValueIndex, hScope, nIndex, value);
+	}
+
+	bool SetEnumValue(HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription) override
+	{
+		return SourceHook::Dispatch<IScriptVM>(this, &IScriptVM::SetEnumValue, &ReplayScriptVM::DoSetEnumValue, hScope, pszEnumName, pszValueName, value, pszDescription);
+	}
+
+private:
+	void DoRegisterFunction(ScriptFunctionBinding_t *) { ++m_nCalls; }
+	bool DoRegisterScriptClass(ScriptClassDesc_t *) { ++m_nCalls; return true; }
+	HSCRIPT DoRegisterInstance(ScriptClassDesc_t *, void *pInstance) { ++m_nCalls; return (HSCRIPT)pInstance; }
+	bool DoSetValueString(HSCRIPT, const char *, const char *) { ++m_nCalls; return true; }
+	bool DoSetValue(HSCRIPT, const char *, const ScriptVariant_t &) { ++m_nCalls; return true; }
+	bool DoSetValueIndex(HSCRIPT, int, const ScriptVariant_t &) { ++m_nCalls; return true; }
+
+	// The game's sets the value through its own, hookable, SetValue.
+	bool DoSetEnumValue(HSCRIPT hScope, const char *, const char *pszValueName, int value, const char *)
+	{
+		++m_nCalls;
+		return SetValue(hScope, pszValueName, ScriptVariant_t(value));
+	}
+
+private:
+	size_t m_nCalls = 0;
+};
+
+class ReplayScriptManager : public IScriptManager
+{
+public:
+	IScriptVM *CreateVM(ScriptLanguage_t language) override
+	{
+		return SourceHook::Dispatch<IScriptManager>(this, &IScriptManager::CreateVM, &ReplayScriptManager::DoCreateVM, language);
+	}
+
+	void DestroyVM(IScriptVM *pVM) override
+	{
+		SourceHook::Dispatch<IScriptManager>(this, &IScriptManager::DestroyVM, &ReplayScriptManager::DoDestroyVM, pVM);
+	}
+
+private:
+	IScriptVM *DoCreateVM(ScriptLanguage_t) { return new ReplayScriptVM; }
+	void DoDestroyVM(IScriptVM *pVM) { delete static_cast<ReplayScriptVM *>(pVM); }
+};
+
+class ReplayServer : public ISource2Server
+{
+public:
+	void GameFrame(bool simulating, bool bFirstTick, bool bLastTick) override
+	{
+		SourceHook::Dispatch<ISource2Server>(this, &ISource2Server::GameFrame, &ReplayServer::DoGameFrame, simulating, bFirstTick, bLastTick);
+	}
+
+private:
+	void DoGameFrame(bool, bool, bool) {}
+};
+
+// Files on disk, with every path ID rooted in one directory.
+class ReplayFileSystem : public IFileSystem
+{
+public:
+	explicit ReplayFileSystem(const char *pszRoot) : m_Root(pszRoot) {}
+
+	int Read(void *pOutput, int size, FileHandle_t file) override;
+	int Write(void const *pInput, int size, FileHandle_t file) override;
+	FileHandle_t Open(const char *pFileName, const char *pOptions, const char *pathID = nullptr) override;
+	void Close(FileHandle_t file) override;
+	void Seek(FileHandle_t file, int pos, FileSystemSeek_t seekType) override;
+	unsigned int Size(FileHandle_t file) override;
+	unsigned int Size(const char *pFileName, const char *pPathID = nullptr) override;
+	void Flush(FileHandle_t file) override;
+	bool FileExists(const char *pFileName, const char *pPathID = nullptr) override;
+	bool IsDirectory(const char *pFileName, const char *pathID = nullptr) override;
+	void CreateDirHierarchy(const char *path, const char *pathID = nullptr) override;
+	void RemoveFile(char const *pRelativePath, const char *pathID = nullptr) override;
+	bool RenameFile(char const *pOldPath, char const *pNewPath, const char *pathID = nullptr) override;
+
+private:
+	std::string FullPath(const char *pszPath) const { return m_Root + "/" + pszPath; }
+
+private:
+	std::string m_Root;
+};
+
+// Hands out the interfaces above by name, as Metamod hands out the engine's.
+class ReplaySMAPI : public ISmmAPI
+{
+public:
+	ReplaySMAPI(IScriptManager *pScriptManager, ISource2Server *pServer, IFileSystem *pFileSystem);
+
+	void Format(char *buffer, size_t maxlength, const char *format, ...) override;
+	void ConPrintf(const char *format, ...) override;
+	bool RegisterConCommandBase(ConCommandBase *) override { return true; }
+
+	CreateInterfaceFn GetEngineFactory(bool = true) override { return &CreateInterface; }
+	CreateInterfaceFn GetFileSystemFactory(bool = true) override { return &CreateInterface; }
+	CreateInterfaceFn GetServerFactory(bool = true) override { return &CreateInterface; }
+	void *VInterfaceMatch(CreateInterfaceFn fn, const char *iface, int min = -1) override;
+
+private:
+	static void *CreateInterface(const char *pszName, int *pReturnCode);
+};
+
+// Sets a ConVar by name, as the console would. False if there's no such ConVar.
+bool SetConVar(const char *pszName, const char *pszValue);
@@ -0,0 +1,176 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "syntheticapi.h"
+
+#include <tier1/fmtstr.h>
+
+SyntheticAPIConfig_t SyntheticAPIConfig_t::Scaled(float scale)
+{
+	auto scaled = [scale](uint32_t count) { return uint32_t(count * scale + 0.5f); };
+
+	SyntheticAPIConfig_t config;
+	config.classes = scaled(180);
+	config.inheritanceDepth = 4;
+	config.funcsPerClass = 30;
+	config.maxParams = 4;
+	config.globalFuncs = scaled(400);
+	config.enums = scaled(80);
+	config.valuesPerEnum = 25;
+	config.globals = scaled(300);
+	return config;
+}
+
+SyntheticAPI::SyntheticAPI(const SyntheticAPIConfig_t &config) : m_Config(config)
+{
+	for (uint32_t c = 0; c < config.classes; ++c)
+	{
+		m_Classes.emplace_back();
+		ScriptClassDesc_t &classDesc = m_Classes.back();
+		classDesc.m_pszScriptName = Store(std::string(CFmtStr("CSynthetic%06u", c)));
+		classDesc.m_pszClassname = classDesc.m_pszScriptName;
+		classDesc.m_pszDescription = c % 2 ? Store(std::string(CFmtStr("Synthetic class %u", c))) : nullptr;
+		classDesc.m_pBaseDesc = config.inheritanceDepth > 1 && c % config.inheritanceDepth ? &m_Classes[c - 1] : nullptr;
+
+		for (uint32_t f = 0; f < config.funcsPerClass; ++f)
+		{
+			int i = classDesc.m_FunctionBindings.AddToTail();
+			FillFunction(classDesc.m_FunctionBindings[i].m_desc, std::string(CFmtStr("Func%04u", f)), c * config.funcsPerClass + f);
+		}
+	}
+
+	for (uint32_t g = 0; g < config.globalFuncs; ++g)
+	{
+		m_GlobalFuncs.emplace_back();
+		FillFunction(m_GlobalFuncs.back().m_desc, std::string(CFmtStr("SyntheticGlobal%06u", g)), g);
+	}
+}
+
+const char *SyntheticAPI::Store(const std::string &str)
+{
+	m_Strings.push_back(str);
+	return m_Strings.back().c_str();
+}
+
+void SyntheticAPI::FillFunction(ScriptFuncDescriptor_t &funcDesc, const std::string &name, uint32_t seed)
+{
+	funcDesc.m_pszScriptName = Store(name);
+	funcDesc.m_pszFunction = funcDesc.m_pszScriptName;
+	funcDesc.m_pszDescription = seed % 3 ? Store("Synthetic function " + name) : "";
+	funcDesc.m_ReturnType = ScriptDataType_t(seed % 3 ? FIELD_INTEGER : FIELD_VOID);
+
+	uint32_t params = m_Config.maxParams ? seed % (m_Config.maxParams + 1) : 0;
+	funcDesc.m_iParamCount = params;
+
+	// Packed back to back, each null terminated, as the game stores them.
+	std::string names;
+	for (uint32_t p = 0; p < params; ++p)
+	{
+		funcDesc.m_Parameters[p] = ScriptDataType_t(p % 2 ? FIELD_FLOAT : FIELD_INTEGER);
+		names += CFmtStr("arg%u", p);
+		names.push_back('\0');
+	}
+	funcDesc.m_pszParameterNames = seed % 5 ? Store(names) : nullptr;
+}
+
+void SyntheticAPI::Capture(ScriptModel &model, VMType v) const
+{
+	model.Clear(v);
+
+	for (auto &classDesc : m_Classes)
+		model.AddClass(const_cast<ScriptClassDesc_t &>(classDesc), v);
+
+	for (auto &binding : m_GlobalFuncs)
+		model.AddFunction(const_cast<ScriptFuncDescriptor_t &>(binding.m_desc), v);
+
+	for (uint32_t e = 0; e < m_Config.enums; ++e)
+	{
+		CFmtStr enumName("SYNTHETIC_ENUM_%05u", e);
+		for (uint32_t i = 0; i < m_Config.valuesPerEnum; ++i)
+			model.AddEnumValue(enumName, CFmtStr("SYNTHETIC_%05u_%03u", e, i), i % 2 ? "Synthetic value" : nullptr, int(i), v);
+	}
+
+	for (uint32_t g = 0; g < m_Config.globals; ++g)
+	{
+		CFmtStr name("SYNTHETIC_GLOBAL_%06u", g);
+		model.AddValue(nullptr, name, g % 2 ? ScriptVariant_t(float(g)) : ScriptVariant_t(int(g)), v);
+	}
+}
+
+void SyntheticAPI::RegisterClasses(IScriptVM *pVM) const
+{
+	for (auto &classDesc : m_Classes)
+		pVM->RegisterScriptClass(const_cast<ScriptClassDesc_t *>(&classDesc));
+}
+
+void SyntheticAPI::RegisterFunctions(IScriptVM *pVM) const
+{
+	for (auto &binding : m_GlobalFuncs)
+		pVM->RegisterFunction(const_cast<ScriptFunctionBinding_t *>(&binding));
+}
+
+void SyntheticAPI::SetEnumValues(IScriptVM *pVM) const
+{
+	for (uint32_t e = 0; e < m_Config.enums; ++e)
+	{
+		CFmtStr enumName("SYNTHETIC_ENUM_%05u", e);
+		for (uint32_t i = 0; i < m_Config.valuesPerEnum; ++i)
+			pVM->SetEnumValue(nullptr, enumName, CFmtStr("SYNTHETIC_%05u_%03u", e, i), int(i), i % 2 ? "Synthetic value" : nullptr);
+	}
+}
+
+void SyntheticAPI::SetValues(IScriptVM *pVM) const
+{
+	for (uint32_t g = 0; g < m_Config.globals; ++g)
+	{
+		CFmtStr name("SYNTHETIC_GLOBAL_%06u", g);
+		pVM->SetValue(nullptr, name, g % 2 ? ScriptVariant_t(float(g)) : ScriptVariant_t(int(g)));
+	}
+}
+
+void SyntheticAPI::RegisterInstances(IScriptVM *pVM, uint32_t count) const
+{
+	if (m_Classes.empty())
+		return;
+
+	// Entities only need to be told apart, never dereferenced.
+	for (uint32_t i = 0; i < count; ++i)
+		pVM->RegisterInstance(const_cast<ScriptClassDesc_t *>(&m_Classes[i % m_Classes.size()]), reinterpret_cast<void *>(uintptr_t(i + 1)));
+}
+
+size_t SyntheticAPI::ClassCount() const
+{
+	return m_Classes.size();
+}
+
+size_t SyntheticAPI::FunctionCount() const
+{
+	return size_t(m_Config.classes) * m_Config.funcsPerClass + m_Config.globalFuncs;
+}
+
+size_t SyntheticAPI::ValueCount() const
+{
+	return size_t(m_Config.enums) * m_Config.valuesPerEnum + m_Config.globals;
+}
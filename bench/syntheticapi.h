@@ -0,0 +1,82 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "../common.h"
+#include "../scriptmodel.h"
+
+#include <deque>
+#include <string>
+
+// Shape of a generated API. Functions get between 0 and maxParams parameters.
+struct SyntheticAPIConfig_t
+{
+	uint32_t classes;
+	uint32_t inheritanceDepth; // Length of each base class chain
+	uint32_t funcsPerClass;
+	uint32_t maxParams;
+	uint32_t globalFuncs;
+	uint32_t enums;
+	uint32_t valuesPerEnum;
+	uint32_t globals;
+
+	// Roughly what Dota's main VM registers today, times scale.
+	static SyntheticAPIConfig_t Scaled(float scale);
+};
+
+// Class and function descriptors laid out the way the game registers them, so the capture and
+// dump paths can be measured on APIs far bigger than any real one.
+class SyntheticAPI
+{
+public:
+	explicit SyntheticAPI(const SyntheticAPIConfig_t &config);
+
+	// Registers everything into the VM, in the order the game would: classes, functions, then values.
+	void Capture(ScriptModel &model, VMType v) const;
+
+	// Registers the same API through a VM's own interface instead, a step at a time, so anything
+	// hooking the VM sees the calls the game would make.
+	void RegisterClasses(IScriptVM *pVM) const;
+	void RegisterFunctions(IScriptVM *pVM) const;
+	void SetEnumValues(IScriptVM *pVM) const;
+	void SetValues(IScriptVM *pVM) const;
+	// One instance per entity, cycling through the classes, as entities spawn.
+	void RegisterInstances(IScriptVM *pVM, uint32_t count) const;
+
+	size_t ClassCount() const;
+	size_t FunctionCount() const;
+	size_t ValueCount() const;
+
+private:
+	const char *Store(const std::string &str);
+	void FillFunction(ScriptFuncDescriptor_t &funcDesc, const std::string &name, uint32_t seed);
+
+private:
+	SyntheticAPIConfig_t m_Config;
+	std::deque<std::string> m_Strings; // Backs every name, stable as it grows
+	std::deque<ScriptClassDesc_t> m_Classes;
+	std::deque<ScriptFunctionBinding_t> m_GlobalFuncs;
+};
@@ -0,0 +1,211 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "binarydumper.h"
+
+#include <algorithm>
+#include <cstring>
+
+struct BinaryScriptDumper::Tables_t
+{
+	StringPool strings;
+	std::vector<VDBClass_t> classes;
+	std::vector<VDBFunction_t> functions;
+	std::vector<VDBParam_t> params;
+	std::vector<VDBEnum_t> enums;
+	std::vector<VDBConstant_t> constants;
+};
+
+VDBRange_t BinaryScriptDumper::AddFunctions(Tables_t &tables, const VMCapture_t &vm, const ScriptFunction_t *pFuncs, size_t count)
+{
+	VDBRange_t range;
+	range.first = uint32_t(tables.functions.size());
+
+	for (auto *i : ScriptModel::SortByName(pFuncs, count, vm.strings))
+	{
+		VDBFunction_t func;
+		func.name = tables.strings.Intern(vm.strings.Get(i->name));
+		func.description = tables.strings.Intern(vm.strings.Get(i->desc));
+		func.returnType = tables.strings.Intern(NameForType(i->returnType));
+		func.flags = i->hasParamNames ? uint32_t(VDBFunction_HasParamNames) : 0;
+		func.params.first = uint32_t(tables.params.size());
+		func.params.count = i->paramCount;
+
+		for (size_t p = 0; p < i->paramCount; ++p)
+		{
+			VDBParam_t param;
+			param.name = i->hasParamNames ? tables.strings.Intern(vm.strings.Get(vm.paramNames[i->firstParam + p])) : kVDBNoString;
+			param.type = tables.strings.Intern(NameForType(vm.params[i->firstParam + p]));
+			tables.params.push_back(param);
+		}
+
+		tables.functions.push_back(func);
+	}
+
+	range.count = uint32_t(tables.functions.size()) - range.first;
+	return range;
+}
+
+VDBValueKind_t BinaryScriptDumper::ValueKind(int16_t type)
+{
+	switch (type)
+	{
+	case FIELD_CSTRING:
+		return VDBValue_String;
+	case FIELD_INTEGER:
+		return VDBValue_Int;
+	case FIELD_FLOAT:
+		return VDBValue_Float;
+	case FIELD_HSCRIPT:
+		return VDBValue_Handle;
+	case FIELD_UINT:
+		return VDBValue_UInt;
+	case FIELD_VECTOR:
+		return VDBValue_Vector;
+	default:
+		return VDBValue_Unhandled;
+	}
+}
+
+VDBRange_t BinaryScriptDumper::AddConstants(Tables_t &tables, const VMCapture_t &vm, const ConstantTable_t &table, const RowRange_t *pRanges, size_t rangeCount, const std::vector<std::string> *pScopePaths)
+{
+	VDBRange_t range;
+	range.first = uint32_t(tables.constants.size());
+
+	for (size_t r = 0; r < rangeCount; ++r)
+	{
+		for (uint32_t i = pRanges[r].first, end = pRanges[r].first + pRanges[r].count; i < end; ++i)
+		{
+			const ScriptValueData_t &value = table.values[i];
+
+			VDBConstant_t constant;
+			memset(&constant, 0, sizeof(constant));
+			constant.name = tables.strings.Intern(vm.valueStrings.Get(table.names[i]));
+			constant.description = tables.strings.Intern(vm.valueStrings.Get(table.descs[i]));
+			constant.scope = kVDBNoString;
+			if (pScopePaths && vm.globalScopes[i] != ScriptModel::kRootScope)
+				constant.scope = tables.strings.Intern((*pScopePaths)[vm.globalScopes[i]].c_str());
+
+			constant.kind = ValueKind(table.types[i]);
+			switch (constant.kind)
+			{
+			case VDBValue_String:
+				constant.str = tables.strings.Intern(vm.valueStrings.Get(value.s));
+				break;
+			case VDBValue_Handle:
+				break;
+			case VDBValue_Unhandled:
+				constant.i = table.types[i];
+				break;
+			default:
+				// Int, UInt, Float and Vector share the union's layout with ScriptValueData_t.
+				memcpy(constant.vec, value.vec, sizeof(constant.vec));
+				break;
+			}
+
+			tables.constants.push_back(constant);
+		}
+	}
+
+	range.count = uint32_t(tables.constants.size()) - range.first;
+	return range;
+}
+
+template <typename T>
+static void WriteSection(OutputBuffer &out, const std::vector<T> &records)
+{
+	if (!records.empty())
+		out.Write((const char *)records.data(), records.size() * sizeof(T));
+}
+
+template <typename T>
+static VDBSection_t PlaceSection(uint32_t &offset, const std::vector<T> &records)
+{
+	VDBSection_t section;
+	section.offset = offset;
+	section.count = uint32_t(records.size());
+	offset += uint32_t(records.size() * sizeof(T));
+	return section;
+}
+
+void BinaryScriptDumper::SaveFunctions(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &) const
+{
+	const VMCapture_t &vm = model.FindVM(v);
+
+	Tables_t tables;
+	tables.classes.reserve(vm.classDefs.size());
+	tables.functions.reserve(vm.classFuncs.size() + vm.globalFuncs.size());
+	tables.params.reserve(vm.params.size());
+
+	for (auto *i : ScriptModel::SortByName(vm.classDefs.data(), vm.classDefs.size(), vm.strings))
+	{
+		VDBClass_t scriptClass;
+		scriptClass.name = tables.strings.Intern(vm.strings.Get(i->name));
+		scriptClass.description = i->hasDesc ? tables.strings.Intern(vm.strings.Get(i->desc)) : kVDBNoString;
+		scriptClass.base = i->hasBase ? tables.strings.Intern(vm.strings.Get(i->base)) : kVDBNoString;
+		scriptClass.functions = AddFunctions(tables, vm, &vm.classFuncs[i->firstFunc], i->funcCount);
+		tables.classes.push_back(scriptClass);
+	}
+
+	VDBHeader_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kVDBMagic;
+	header.version = kVDBVersion;
+	header.vm = uint32_t(v);
+	header.globalFunctions = AddFunctions(tables, vm, vm.globalFuncs.data(), vm.globalFuncs.size());
+
+	tables.constants.reserve(vm.enumValues.Count() + vm.globalConstants.Count());
+	for (auto *i : ScriptModel::SortByName(vm.enums.data(), vm.enums.size(), vm.valueStrings))
+	{
+		VDBEnum_t scriptEnum;
+		scriptEnum.name = tables.strings.Intern(vm.valueStrings.Get(i->name));
+		scriptEnum.constants = AddConstants(tables, vm, vm.enumValues, i->rows.data(), i->rows.size(), nullptr);
+		tables.enums.push_back(scriptEnum);
+	}
+
+	std::vector<std::string> scopePaths;
+	ScriptModel::ScopePaths(vm, scopePaths);
+	RowRange_t globals = { 0, vm.globalConstants.Count() };
+	header.globalConstants = AddConstants(tables, vm, vm.globalConstants, &globals, 1, &scopePaths);
+
+	// Records first, in the order the header lists them, then the string table.
+	uint32_t offset = sizeof(VDBHeader_t);
+	header.classes = PlaceSection(offset, tables.classes);
+	header.functions = PlaceSection(offset, tables.functions);
+	header.params = PlaceSection(offset, tables.params);
+	header.enums = PlaceSection(offset, tables.enums);
+	header.constants = PlaceSection(offset, tables.constants);
+	header.strings.offset = offset;
+	header.strings.count = uint32_t(tables.strings.Size());
+	header.fileSize = offset + header.strings.count;
+
+	out.Write((const char *)&header, sizeof(header));
+	WriteSection(out, tables.classes);
+	WriteSection(out, tables.functions);
+	WriteSection(out, tables.params);
+	WriteSection(out, tables.enums);
+	WriteSection(out, tables.constants);
+	out.Write(tables.strings.Data(), tables.strings.Size());
+}
@@ -0,0 +1,51 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "binaryformat.h"
+#include "iscriptdumper.h"
+
+// Writes everything for a VM into one file in the layout described in binaryformat.h.
+class BinaryScriptDumper : public IScriptDumper
+{
+public: // IScriptDumper
+	const char *GetOutputTypeName() const override { return "vdb"; }
+	bool HasValuesFile() const override { return false; }
+	bool IsBinaryOutput() const override { return true; }
+	void SaveFunctions(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &pool) const override;
+	void SaveValues(OutputBuffer &, const ScriptModel &, VMType, WorkerPool &) const override {}
+
+public:
+	// How a captured value of the engine's field type is stored. Also used by CaptureJournal.
+	static VDBValueKind_t ValueKind(int16_t type);
+
+private:
+	struct Tables_t;
+
+	static VDBRange_t AddFunctions(Tables_t &tables, const VMCapture_t &vm, const ScriptFunction_t *pFuncs, size_t count);
+	// pScopePaths is for globals only, from ScriptModel::ScopePaths.
+	static VDBRange_t AddConstants(Tables_t &tables, const VMCapture_t &vm, const ConstantTable_t &table, const RowRange_t *pRanges, size_t rangeCount, const std::vector<std::string> *pScopePaths);
+};
@@ -0,0 +1,145 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// Layout of the binary dump (out<vm>.vdb). Everything is little endian and made of 32-bit
+// fields, so every record is 4-byte aligned and a reader can map the file and use the
+// records in place. This header deliberately has no SDK dependencies so tools can use it.
+//
+// The file is a VDBHeader_t followed by the sections it points at. References between
+// records are indices into the referenced section; strings are byte offsets into the string
+// table, which holds null terminated UTF-8. Classes, functions (per class) and enums are
+// sorted by name (strcmp order) so they can be binary searched. Constants keep the order
+// they were registered in.
+//
+// Version 2 added VDBConstant_t::scope.
+
+static const uint32_t kVDBMagic = 0x31424456; // "VDB1"
+static const uint32_t kVDBVersion = 2;
+
+// For optional string fields that were never set, as opposed to set to an empty string.
+static const uint32_t kVDBNoString = 0xFFFFFFFF;
+
+struct VDBSection_t
+{
+	uint32_t offset; // From the start of the file
+	uint32_t count;  // In records, or in bytes for the string table
+};
+
+// A run of records inside a section.
+struct VDBRange_t
+{
+	uint32_t first;
+	uint32_t count;
+};
+
+struct VDBHeader_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	uint32_t vm; // VMType the dump was taken from
+
+	VDBSection_t classes;   // VDBClass_t
+	VDBSection_t functions; // VDBFunction_t
+	VDBSection_t params;    // VDBParam_t
+	VDBSection_t enums;     // VDBEnum_t
+	VDBSection_t constants; // VDBConstant_t
+	VDBSection_t strings;
+
+	VDBRange_t globalFunctions; // Into functions
+	VDBRange_t globalConstants; // Into constants, for values set outside of any enum
+};
+
+struct VDBClass_t
+{
+	uint32_t name;
+	uint32_t description; // Or kVDBNoString
+	uint32_t base;        // Name of the base class, or kVDBNoString
+	VDBRange_t functions;
+};
+
+struct VDBFunction_t
+{
+	uint32_t name;
+	uint32_t description;
+	uint32_t returnType; // Type name, as in the JSON dumps
+	uint32_t flags;
+	VDBRange_t params;
+};
+
+enum VDBFunctionFlags_t : uint32_t
+{
+	VDBFunction_HasParamNames = 1 << 0, // Set even when there are no parameters to name
+};
+
+struct VDBParam_t
+{
+	uint32_t name; // Or kVDBNoString if the function has no parameter names
+	uint32_t type;
+};
+
+struct VDBEnum_t
+{
+	uint32_t name;
+	VDBRange_t constants;
+};
+
+enum VDBValueKind_t : uint32_t
+{
+	VDBValue_Int,
+	VDBValue_UInt,
+	VDBValue_Float,
+	VDBValue_String, // str is a string offset
+	VDBValue_Vector,
+	VDBValue_Handle,
+	VDBValue_Unhandled, // i holds the engine's field type
+};
+
+struct VDBConstant_t
+{
+	uint32_t name;
+	uint32_t description;
+	uint32_t scope; // Path of the script table a global was set in, e.g. "GameRules.Settings[2]", or kVDBNoString for the root
+	VDBValueKind_t kind;
+	union
+	{
+		int32_t i;
+		uint32_t u;
+		float f;
+		uint32_t str;
+		float vec[3];
+	};
+};
+
+static_assert(sizeof(VDBHeader_t) == 80, "VDBHeader_t layout changed");
+static_assert(sizeof(VDBClass_t) == 20, "VDBClass_t layout changed");
+static_assert(sizeof(VDBFunction_t) == 24, "VDBFunction_t layout changed");
+static_assert(sizeof(VDBParam_t) == 8, "VDBParam_t layout changed");
+static_assert(sizeof(VDBEnum_t) == 12, "VDBEnum_t layout changed");
+static_assert(sizeof(VDBConstant_t) == 28, "VDBConstant_t layout changed");
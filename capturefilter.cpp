@@ -0,0 +1,307 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "capturefilter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace
+{
+	struct Rule_t
+	{
+		std::string pattern; // Category byte, or ? for any, then the glob
+		bool bExclude;
+	};
+
+	bool ParseRules(const char *pszRules, std::vector<Rule_t> &rules, std::string &error)
+	{
+		static const struct
+		{
+			const char *pszPrefix;
+			FilterCategory_t category;
+		} kCategories[] = {
+			{ "class:", Filter_Class },
+			{ "function:", Filter_Function },
+			{ "enum:", Filter_Enum },
+			{ "value:", Filter_Value },
+		};
+
+		const char *p = pszRules;
+		for (;;)
+		{
+			while (*p && (strchr(" \t\r\n,;", *p) || *p == '#'))
+			{
+				if (*p == '#')
+				{
+					while (*p && *p != '\n')
+						++p;
+				}
+				else
+				{
+					++p;
+				}
+			}
+			if (!*p)
+				return true;
+
+			const char *pEnd = p;
+			while (*pEnd && !strchr(" \t\r\n,;#", *pEnd))
+				++pEnd;
+			std::string token(p, pEnd);
+			p = pEnd;
+
+			Rule_t rule;
+			rule.bExclude = token[0] == '-';
+			size_t start = token[0] == '-' || token[0] == '+' ? 1 : 0;
+
+			char category = '?';
+			size_t colon = token.find(':', start);
+			if (colon != std::string::npos)
+			{
+				std::string prefix = token.substr(start, colon + 1 - start);
+				for (auto &c : kCategories)
+				{
+					if (prefix == c.pszPrefix)
+						category = char(c.category);
+				}
+				if (category == '?')
+				{
+					error = "unknown category in \"" + token + "\"";
+					return false;
+				}
+				start = colon + 1;
+			}
+
+			if (start == token.size())
+			{
+				error = "empty pattern in \"" + token + "\"";
+				return false;
+			}
+
+			rule.pattern = category + token.substr(start);
+			rules.push_back(rule);
+		}
+	}
+
+	// Glob NFA: a position is an index into one pattern. Positions of all patterns are numbered
+	// back to back, so a DFA state is a sorted set of numbers.
+	class GlobNFA
+	{
+	public:
+		explicit GlobNFA(const std::vector<Rule_t> &rules) : m_Rules(rules)
+		{
+			for (size_t r = 0; r < rules.size(); ++r)
+			{
+				for (size_t i = 0; i <= rules[r].pattern.size(); ++i)
+				{
+					Position_t pos = { uint32_t(r), uint32_t(i) };
+					m_Positions.push_back(pos);
+				}
+			}
+		}
+
+		std::vector<uint32_t> Start() const
+		{
+			std::vector<uint32_t> set;
+			for (uint32_t id = 0; id < m_Positions.size(); ++id)
+			{
+				if (m_Positions[id].index == 0)
+					set.push_back(id);
+			}
+			return Close(set);
+		}
+
+		std::vector<uint32_t> Step(const std::vector<uint32_t> &set, uint8_t c) const
+		{
+			std::vector<uint32_t> next;
+			for (uint32_t id : set)
+			{
+				const std::string &pattern = m_Rules[m_Positions[id].rule].pattern;
+				uint32_t i = m_Positions[id].index;
+				if (i == pattern.size())
+					continue;
+
+				if (pattern[i] == '*')
+					next.push_back(id);
+				else if (pattern[i] == '?' || uint8_t(pattern[i]) == c)
+					next.push_back(id + 1);
+			}
+			return Close(next);
+		}
+
+		uint8_t Flags(const std::vector<uint32_t> &set, uint8_t include, uint8_t exclude) const
+		{
+			uint8_t flags = 0;
+			for (uint32_t id : set)
+			{
+				const Rule_t &rule = m_Rules[m_Positions[id].rule];
+				if (m_Positions[id].index == rule.pattern.size())
+					flags |= rule.bExclude ? exclude : include;
+			}
+			return flags;
+		}
+
+	private:
+		struct Position_t
+		{
+			uint32_t rule;
+			uint32_t index;
+		};
+
+		// A * can also match nothing, so reaching it reaches what follows it too.
+		std::vector<uint32_t> Close(std::vector<uint32_t> set) const
+		{
+			for (size_t n = 0; n < set.size(); ++n)
+			{
+				const std::string &pattern = m_Rules[m_Positions[set[n]].rule].pattern;
+				uint32_t i = m_Positions[set[n]].index;
+				if (i < pattern.size() && pattern[i] == '*')
+					set.push_back(set[n] + 1);
+			}
+
+			std::sort(set.begin(), set.end());
+			set.erase(std::unique(set.begin(), set.end()), set.end());
+			return set;
+		}
+
+	private:
+		const std::vector<Rule_t> &m_Rules;
+		std::vector<Position_t> m_Positions;
+	};
+}
+
+uint32_t CaptureFilter::CategoryBit(FilterCategory_t category)
+{
+	switch (category)
+	{
+	case Filter_Class:
+		return 1 << 0;
+	case Filter_Function:
+		return 1 << 1;
+	case Filter_Enum:
+		return 1 << 2;
+	default:
+		return 1 << 3;
+	}
+}
+
+void CaptureFilter::Clear()
+{
+	m_bEmpty = true;
+	m_IncludeCategories = 0;
+	m_Start = 0;
+	m_ClassCount = 1;
+	memset(m_ByteClass, 0, sizeof(m_ByteClass));
+	m_Table.assign(1, 0);
+	m_Flags.assign(1, 0);
+}
+
+bool CaptureFilter::Compile(const char *pszRules, std::string &error)
+{
+	static const uint32_t kMaxStates = 1 << 16;
+
+	std::vector<Rule_t> rules;
+	if (!ParseRules(pszRules, rules, error))
+		return false;
+
+	if (rules.empty())
+	{
+		Clear();
+		return true;
+	}
+
+	// Every byte a pattern names literally gets a class of its own. Everything else, including the
+	// null byte that is never fed in, shares class 0.
+	uint8_t byteClass[256] = {};
+	std::vector<uint8_t> representative(1, 0);
+	uint32_t includeCategories = 0;
+	for (auto &rule : rules)
+	{
+		for (size_t i = 0; i < rule.pattern.size(); ++i)
+		{
+			uint8_t c = uint8_t(rule.pattern[i]);
+			if (i > 0 && (c == '*' || c == '?'))
+				continue;
+			if (c != '?' && !byteClass[c])
+			{
+				byteClass[c] = uint8_t(representative.size());
+				representative.push_back(c);
+			}
+		}
+
+		if (!rule.bExclude)
+			includeCategories |= rule.pattern[0] == '?' ? 0xF : CategoryBit(FilterCategory_t(rule.pattern[0]));
+	}
+
+	// Subset construction. State 0 is the empty set, which never leaves itself.
+	GlobNFA nfa(rules);
+	uint32_t classCount = uint32_t(representative.size());
+	std::map<std::vector<uint32_t>, uint32_t> ids;
+	std::vector<std::vector<uint32_t>> sets;
+	std::vector<uint32_t> table(classCount, 0);
+	std::vector<uint8_t> flags(1, 0);
+	ids[std::vector<uint32_t>()] = 0;
+	sets.push_back(std::vector<uint32_t>());
+
+	auto stateFor = [&](const std::vector<uint32_t> &set) -> uint32_t {
+		auto inserted = ids.insert(std::make_pair(set, uint32_t(sets.size())));
+		if (inserted.second)
+		{
+			sets.push_back(set);
+			table.resize(table.size() + classCount, 0);
+			flags.push_back(nfa.Flags(set, Match_Include, Match_Exclude));
+		}
+		return inserted.first->second;
+	};
+
+	uint32_t start = stateFor(nfa.Start());
+	for (uint32_t state = 1; state < sets.size(); ++state)
+	{
+		if (sets.size() > kMaxStates)
+		{
+			error = "rules are too complex";
+			return false;
+		}
+
+		for (uint32_t c = 0; c < classCount; ++c)
+		{
+			// stateFor grows sets and table, so nothing in them can be held across the call.
+			std::vector<uint32_t> set = sets[state];
+			uint32_t next = stateFor(nfa.Step(set, representative[c]));
+			table[state * classCount + c] = next;
+		}
+	}
+
+	m_bEmpty = false;
+	m_IncludeCategories = includeCategories;
+	m_Start = start;
+	m_ClassCount = classCount;
+	memcpy(m_ByteClass, byteClass, sizeof(m_ByteClass));
+	m_Table.swap(table);
+	m_Flags.swap(flags);
+	return true;
+}
@@ -0,0 +1,98 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a name passed to CaptureFilter::Accepts belongs to. The values are the prefixes the
+// automaton sees ahead of the name.
+enum FilterCategory_t : uint8_t
+{
+	Filter_Class = 'c',
+	Filter_Function = 'f', // Global functions
+	Filter_Enum = 'e',
+	Filter_Value = 'v',    // Globals
+};
+
+// Include/exclude rules over glob patterns (* and ?), compiled into a single DFA so checking a
+// name is one table lookup per character, with no allocation.
+//
+// Rules are separated by whitespace, commas or semicolons; # starts a comment running to the end
+// of the line. Each is an optional + (include, the default) or - (exclude), an optional category
+// (class:, function:, enum: or value:; without one it applies to every category) and a pattern:
+//
+//   class:CDOTA_* -class:CDOTA_Item_* enum:DOTA_*
+//
+// A name is accepted if it matches no exclude rule and either matches an include rule or its
+// category has no include rules at all. No rules accept everything.
+class CaptureFilter
+{
+public:
+	CaptureFilter() { Clear(); }
+
+	// On failure, keeps the rules it had and describes the problem in error.
+	bool Compile(const char *pszRules, std::string &error);
+	void Clear();
+
+	bool IsEmpty() const { return m_bEmpty; }
+
+	bool Accepts(FilterCategory_t category, const char *pszName) const
+	{
+		if (m_bEmpty)
+			return true;
+
+		uint32_t state = Next(m_Start, uint8_t(category));
+		for (const char *p = pszName; *p && state; ++p)
+			state = Next(state, uint8_t(*p));
+
+		uint8_t flags = m_Flags[state];
+		if (flags & Match_Exclude)
+			return false;
+		return (flags & Match_Include) || !(m_IncludeCategories & CategoryBit(category));
+	}
+
+private:
+	enum MatchFlags_t : uint8_t
+	{
+		Match_Include = 1 << 0,
+		Match_Exclude = 1 << 1,
+	};
+
+	uint32_t Next(uint32_t state, uint8_t c) const { return m_Table[state * m_ClassCount + m_ByteClass[c]]; }
+
+	static uint32_t CategoryBit(FilterCategory_t category);
+
+private:
+	bool m_bEmpty;
+	uint32_t m_IncludeCategories; // CategoryBit() of every category with an include rule
+	uint32_t m_Start;
+	uint32_t m_ClassCount;
+	uint8_t m_ByteClass[256];     // Bytes no pattern tells apart share a class
+	std::vector<uint32_t> m_Table; // [state][class], state 0 is dead
+	std::vector<uint8_t> m_Flags;  // MatchFlags_t per state, for the name ending there
+};
@@ -0,0 +1,210 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "capturejournal.h"
+#include "binarydumper.h"
+
+bool CaptureJournal::Open(const char *pszPath)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	CloseFile();
+
+	m_File = filesystem->Open(pszPath, "wb", "DEFAULT_WRITE_PATH");
+	if (m_File == FILESYSTEM_INVALID_HANDLE)
+		return false;
+
+	VDJHeader_t header;
+	header.magic = kVDJMagic;
+	header.version = kVDJVersion;
+	m_Buffer.Write((const char *)&header, sizeof(header));
+	FlushFile();
+
+	return true;
+}
+
+void CaptureJournal::Close()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	CloseFile();
+}
+
+void CaptureJournal::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	FlushFile();
+}
+
+void CaptureJournal::CloseFile()
+{
+	if (!IsOpen())
+		return;
+
+	FlushFile();
+	filesystem->Close(m_File);
+	m_File = FILESYSTEM_INVALID_HANDLE;
+}
+
+void CaptureJournal::FlushFile()
+{
+	m_Buffer.Flush();
+	if (m_bDirty)
+	{
+		filesystem->Flush(m_File);
+		m_bDirty = false;
+	}
+}
+
+void CaptureJournal::Write(const char *pData, size_t len)
+{
+	filesystem->Write(pData, (int)len, m_File);
+	m_bDirty = true;
+}
+
+void CaptureJournal::BeginRecord()
+{
+	m_Record.Clear();
+}
+
+void CaptureJournal::EndRecord(VDJRecordKind_t kind, VMType v)
+{
+	VDJRecord_t record;
+	record.size = uint32_t(m_Record.Size());
+	record.kind = kind;
+	record.reserved = 0;
+	record.vm = uint16_t(v);
+
+	m_Buffer.Write((const char *)&record, sizeof(record));
+	m_Buffer.Write(m_Record.Data(), m_Record.Size());
+}
+
+void CaptureJournal::WriteString(const char *psz)
+{
+	if (!psz)
+	{
+		WriteU32(kVDBNoString);
+		return;
+	}
+
+	uint32_t len = uint32_t(strlen(psz));
+	WriteU32(len);
+	m_Record.Write(psz, len);
+}
+
+void CaptureJournal::WriteFunction(const ScriptModel::VMCapture_t &vm, const ScriptModel::ScriptFunction_t &func)
+{
+	WriteString(vm.strings.Get(func.name));
+	WriteString(vm.strings.Get(func.desc));
+	WriteString(NameForType(func.returnType));
+	WriteU32(func.hasParamNames ? uint32_t(VDBFunction_HasParamNames) : 0);
+	WriteU32(func.paramCount);
+	for (size_t i = 0; i < func.paramCount; ++i)
+	{
+		WriteString(NameForType(vm.params[func.firstParam + i]));
+		WriteString(func.hasParamNames ? vm.strings.Get(vm.paramNames[func.firstParam + i]) : nullptr);
+	}
+}
+
+void CaptureJournal::WriteConstant(const ScriptModel::VMCapture_t &vm, const ScriptModel::ConstantTable_t &table, uint32_t row)
+{
+	int16_t type = table.types[row];
+	VDBValueKind_t kind = BinaryScriptDumper::ValueKind(type);
+	WriteU32(kind);
+
+	// The same value union as VDBConstant_t, filled the way BinaryScriptDumper fills it.
+	uint32_t data[3] = {};
+	switch (kind)
+	{
+	case VDBValue_String:
+		WriteString(vm.valueStrings.Get(table.values[row].s));
+		return;
+	case VDBValue_Handle:
+		break;
+	case VDBValue_Unhandled:
+		data[0] = uint32_t(int32_t(type));
+		break;
+	default:
+		memcpy(data, table.values[row].vec, sizeof(data));
+		break;
+	}
+	m_Record.Write((const char *)data, sizeof(data));
+}
+
+void CaptureJournal::ClearVM(VMType v)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	BeginRecord();
+	EndRecord(VDJRecord_ClearVM, v);
+}
+
+void CaptureJournal::DestroyVM(VMType v)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	BeginRecord();
+	EndRecord(VDJRecord_DestroyVM, v);
+}
+
+void CaptureJournal::AddClass(const ScriptModel::VMCapture_t &vm, VMType v, const ScriptModel::ScriptClass_t &scriptClass)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	BeginRecord();
+	WriteString(vm.strings.Get(scriptClass.name));
+	WriteString(scriptClass.hasDesc ? vm.strings.Get(scriptClass.desc) : nullptr);
+	WriteString(scriptClass.hasBase ? vm.strings.Get(scriptClass.base) : nullptr);
+	WriteU32(scriptClass.funcCount);
+	for (size_t i = 0; i < scriptClass.funcCount; ++i)
+		WriteFunction(vm, vm.classFuncs[scriptClass.firstFunc + i]);
+	EndRecord(VDJRecord_Class, v);
+}
+
+void CaptureJournal::AddFunction(const ScriptModel::VMCapture_t &vm, VMType v, const ScriptModel::ScriptFunction_t &func)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	BeginRecord();
+	WriteFunction(vm, func);
+	EndRecord(VDJRecord_Function, v);
+}
+
+void CaptureJournal::AddValue(const ScriptModel::VMCapture_t &vm, VMType v, uint32_t row)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	BeginRecord();
+	WriteU64(uint64_t(uintptr_t(vm.scopes[vm.globalScopes[row]].handle)));
+	WriteString(vm.valueStrings.Get(vm.globalConstants.names[row]));
+	WriteConstant(vm, vm.globalConstants, row);
+	if (vm.globalConstants.types[row] == FIELD_HSCRIPT)
+		WriteU64(uint64_t(uintptr_t(vm.globalTables[row])));
+	EndRecord(VDJRecord_Value, v);
+}
+
+void CaptureJournal::AddEnumValue(const ScriptModel::VMCapture_t &vm, VMType v, const char *pszEnumName, uint32_t row)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	BeginRecord();
+	WriteString(pszEnumName);
+	WriteString(vm.valueStrings.Get(vm.enumValues.names[row]));
+	WriteString(vm.valueStrings.Get(vm.enumValues.descs[row]));
+	WriteConstant(vm, vm.enumValues, row);
+	EndRecord(VDJRecord_EnumValue, v);
+}
@@ -0,0 +1,83 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "journalformat.h"
+#include "outputbuffer.h"
+#include "scriptmodel.h"
+
+#include <filesystem.h>
+
+#include <mutex>
+
+// Appends everything the model accepts to a journal file in the layout from journalformat.h,
+// so a session that never reaches Unload can still be recovered with tools/vdumprecover.
+// Records are buffered and handed to the OS whenever the capture goes idle.
+//
+// The capture worker and the game thread (when it delivers an event itself) can both append
+// while the worker flushes, so every record and flush happens whole under a lock.
+class CaptureJournal : private IOutputSink
+{
+public:
+	CaptureJournal() : m_File(FILESYSTEM_INVALID_HANDLE), m_Buffer(this), m_bDirty(false) {}
+	~CaptureJournal() { Close(); }
+
+	// Starts a new journal, replacing any file already at the path.
+	bool Open(const char *pszPath);
+	void Close();
+	bool IsOpen() const { return m_File != FILESYSTEM_INVALID_HANDLE; }
+	void Flush();
+
+	void ClearVM(VMType v);
+	void DestroyVM(VMType v);
+	void AddClass(const ScriptModel::VMCapture_t &vm, VMType v, const ScriptModel::ScriptClass_t &scriptClass);
+	void AddFunction(const ScriptModel::VMCapture_t &vm, VMType v, const ScriptModel::ScriptFunction_t &func);
+	void AddValue(const ScriptModel::VMCapture_t &vm, VMType v, uint32_t row);
+	void AddEnumValue(const ScriptModel::VMCapture_t &vm, VMType v, const char *pszEnumName, uint32_t row);
+
+private: // IOutputSink
+	void Write(const char *pData, size_t len) override;
+
+private:
+	void CloseFile();
+	void FlushFile();
+
+	void BeginRecord();
+	void EndRecord(VDJRecordKind_t kind, VMType v);
+
+	void WriteU32(uint32_t value) { m_Record.Write((const char *)&value, sizeof(value)); }
+	void WriteU64(uint64_t value) { m_Record.Write((const char *)&value, sizeof(value)); }
+	void WriteString(const char *psz);
+	void WriteFunction(const ScriptModel::VMCapture_t &vm, const ScriptModel::ScriptFunction_t &func);
+	void WriteConstant(const ScriptModel::VMCapture_t &vm, const ScriptModel::ConstantTable_t &table, uint32_t row);
+
+private:
+	std::mutex m_Mutex;
+	FileHandle_t m_File;
+	OutputBuffer m_Buffer; // Whole records, waiting to be written to m_File
+	OutputBuffer m_Record; // Payload of the record being built
+	bool m_bDirty;         // Written to m_File since the last Flush()
+};
@@ -0,0 +1,324 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "capturequeue.h"
+#include "stats.h"
+
+#include <cstring>
+
+CaptureQueue::CaptureQueue(ScriptModel &model)
+	: m_Model(model), m_pRing(new CaptureEvent_t[kCapacity]), m_Head(0), m_Tail(0), m_bWorkerWaiting(false), m_bStop(false), m_SyncFallbacks(0)
+{
+}
+
+void CaptureQueue::Start()
+{
+	if (m_Thread.joinable())
+		return;
+
+	m_bStop = false;
+	m_Thread = std::thread(&CaptureQueue::ThreadMain, this);
+}
+
+void CaptureQueue::Stop()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bStop = true;
+	}
+	m_CV.notify_one();
+	m_Thread.join();
+}
+
+void CaptureQueue::Flush()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	while (m_Tail.load(std::memory_order_acquire) != head)
+		std::this_thread::yield();
+}
+
+CaptureEvent_t *CaptureQueue::BeginPush()
+{
+	uint32_t head = m_Head.load(std::memory_order_relaxed);
+	if (head - m_Tail.load(std::memory_order_acquire) == kCapacity)
+		return nullptr;
+
+	return &m_pRing[head & (kCapacity - 1)];
+}
+
+void CaptureQueue::EndPush()
+{
+	// Sequentially consistent against m_bWorkerWaiting, so either the worker sees the new head before
+	// sleeping or we see it waiting. The lock keeps the notify from landing before it actually sleeps.
+	m_Head.store(m_Head.load(std::memory_order_relaxed) + 1);
+	if (m_bWorkerWaiting.load())
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CV.notify_one();
+	}
+}
+
+void CaptureQueue::PushOrDeliver(CaptureEvent_t &event)
+{
+	if (!m_Thread.joinable())
+	{
+		Deliver(event);
+		return;
+	}
+
+	CaptureEvent_t *pSlot = BeginPush();
+	if (!pSlot)
+	{
+		Flush();
+		++m_SyncFallbacks;
+		Deliver(event);
+		return;
+	}
+
+	*pSlot = event;
+	EndPush();
+}
+
+bool CaptureQueue::PackStrings(CaptureEvent_t &event, const char *pszA, const char *pszB, const char *pszC)
+{
+	const char *strings[] = { pszA, pszB, pszC };
+
+	size_t used = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!strings[i])
+		{
+			event.strings[i] = CaptureEvent_t::kNoText;
+			continue;
+		}
+
+		size_t len = strlen(strings[i]) + 1;
+		if (used + len > CaptureEvent_t::kTextSize)
+			return false;
+
+		memcpy(&event.text[used], strings[i], len);
+		event.strings[i] = uint16_t(used);
+		used += len;
+	}
+
+	return true;
+}
+
+void CaptureQueue::Clear(VMType v)
+{
+	CaptureEvent_t event;
+	event.kind = CaptureEvent_t::Clear;
+	event.v = v;
+	PushOrDeliver(event);
+}
+
+void CaptureQueue::DestroyVM(VMType v)
+{
+	CaptureEvent_t event;
+	event.kind = CaptureEvent_t::DestroyVM;
+	event.v = v;
+	PushOrDeliver(event);
+}
+
+void CaptureQueue::AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v)
+{
+	CaptureEvent_t event;
+	event.kind = CaptureEvent_t::Function;
+	event.v = v;
+	event.pFunc = &funcDesc;
+	PushOrDeliver(event);
+}
+
+void CaptureQueue::AddClass(ScriptClassDesc_t &classDesc, VMType v)
+{
+	CaptureEvent_t event;
+	event.kind = CaptureEvent_t::Class;
+	event.v = v;
+	event.pClass = &classDesc;
+	PushOrDeliver(event);
+}
+
+void CaptureQueue::AddValue(HSCRIPT hScope, const char *pszName, const ScriptVariant_t &value, VMType v)
+{
+	CaptureEvent_t event;
+	event.kind = CaptureEvent_t::Value;
+	event.v = v;
+	event.hScope = hScope;
+	event.valueType = value.m_type;
+
+	if (value.m_type == FIELD_VECTOR)
+	{
+		event.vec[0] = value.m_pVector->x;
+		event.vec[1] = value.m_pVector->y;
+		event.vec[2] = value.m_pVector->z;
+	}
+	else if (value.m_type == FIELD_HSCRIPT)
+	{
+		event.hValue = value.m_hScript;
+	}
+	else
+	{
+		event.u = value.m_uint;
+	}
+
+	if (!PackStrings(event, pszName, value.m_type == FIELD_CSTRING ? value.m_pszString : nullptr, nullptr))
+	{
+		Flush();
+		++m_SyncFallbacks;
+		{
+			D2V_STAT_SCOPE(Stat_ModelAddValue, v);
+			m_Model.AddValue(hScope, pszName, value, v);
+		}
+		return;
+	}
+
+	PushOrDeliver(event);
+}
+
+void CaptureQueue::AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v)
+{
+	CaptureEvent_t event;
+	event.kind = CaptureEvent_t::EnumValue;
+	event.v = v;
+	event.i = value;
+
+	if (!PackStrings(event, pszEnumName, pszName, pszDesc))
+	{
+		Flush();
+		++m_SyncFallbacks;
+		{
+			D2V_STAT_SCOPE(Stat_ModelAddEnumValue, v);
+			m_Model.AddEnumValue(pszEnumName, pszName, pszDesc, value, v);
+		}
+		return;
+	}
+
+	PushOrDeliver(event);
+}
+
+void CaptureQueue::Deliver(const CaptureEvent_t &event)
+{
+	auto text = [&event](int i) -> const char * {
+		return event.strings[i] == CaptureEvent_t::kNoText ? nullptr : &event.text[event.strings[i]];
+	};
+
+	switch (event.kind)
+	{
+	case CaptureEvent_t::Clear:
+		{
+			D2V_STAT_SCOPE(Stat_ModelClear, event.v);
+			m_Model.Clear(event.v);
+		}
+		break;
+	case CaptureEvent_t::DestroyVM:
+		m_Model.DestroyVM(event.v);
+		break;
+	case CaptureEvent_t::Function:
+		{
+			D2V_STAT_SCOPE(Stat_ModelAddFunction, event.v);
+			m_Model.AddFunction(*event.pFunc, event.v);
+		}
+		break;
+	case CaptureEvent_t::Class:
+		{
+			D2V_STAT_SCOPE(Stat_ModelAddClass, event.v);
+			m_Model.AddClass(*event.pClass, event.v);
+		}
+		break;
+	case CaptureEvent_t::Value:
+	{
+		Vector vec;
+		ScriptVariant_t value;
+		value.m_type = event.valueType;
+		if (event.valueType == FIELD_CSTRING)
+		{
+			value.m_pszString = text(1);
+		}
+		else if (event.valueType == FIELD_VECTOR)
+		{
+			vec.x = event.vec[0];
+			vec.y = event.vec[1];
+			vec.z = event.vec[2];
+			value.m_pVector = &vec;
+		}
+		else if (event.valueType == FIELD_HSCRIPT)
+		{
+			value.m_hScript = event.hValue;
+		}
+		else
+		{
+			value.m_uint = event.u;
+		}
+
+		{
+			D2V_STAT_SCOPE(Stat_ModelAddValue, event.v);
+			m_Model.AddValue(event.hScope, text(0), value, event.v);
+		}
+		break;
+	}
+	case CaptureEvent_t::EnumValue:
+		{
+			D2V_STAT_SCOPE(Stat_ModelAddEnumValue, event.v);
+			m_Model.AddEnumValue(text(0), text(1), text(2), event.i, event.v);
+		}
+		break;
+	}
+}
+
+void CaptureQueue::ThreadMain()
+{
+	StatsRegisterThread();
+
+	for (;;)
+	{
+		uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail != m_Head.load(std::memory_order_acquire))
+		{
+			// Only released once delivered, so the slot stays put and Flush() knows the model is done with it.
+			Deliver(m_pRing[tail & (kCapacity - 1)]);
+			m_Tail.store(tail + 1, std::memory_order_release);
+			continue;
+		}
+
+		// Caught up, so this is a cheap moment to hand the journal's records to the OS. The game
+		// thread may be appending to it by now, so this relies on the journal's own lock.
+		m_Model.FlushJournal();
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_bWorkerWaiting = true;
+		m_CV.wait(lock, [this, tail]() { return m_bStop || m_Head.load() != tail; });
+		m_bWorkerWaiting = false;
+
+		// Anything pushed before Stop() still gets delivered.
+		if (m_bStop && m_Head.load() == tail)
+			return;
+	}
+}
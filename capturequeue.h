@@ -0,0 +1,133 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "scriptmodel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One captured registration. Class and function descriptors are static data in the game's
+// modules and are passed by pointer; everything else the engine hands us may be a temporary,
+// so names, descriptions and values are copied in.
+struct CaptureEvent_t
+{
+	enum Kind_t : uint8_t
+	{
+		Clear,
+		DestroyVM,
+		Function,
+		Class,
+		Value,
+		EnumValue,
+	};
+
+	static const size_t kTextSize = 224;
+	static const uint16_t kNoText = 0xFFFF;
+
+	Kind_t kind;
+	int16_t valueType;
+	VMType v;
+	HSCRIPT hScope; // Value only
+	union
+	{
+		ScriptFuncDescriptor_t *pFunc;
+		ScriptClassDesc_t *pClass;
+		int32_t i;
+		uint32_t u;
+		float f;
+		float vec[3];
+		HSCRIPT hValue; // A table set as a value
+	};
+
+	// Offsets into text of each string, or kNoText. Value: key and string value. EnumValue: enum name, name and description.
+	uint16_t strings[3];
+	char text[kTextSize];
+};
+
+// Decouples the capture hooks from the model. The game thread pushes events into a bounded
+// single producer, single consumer ring and a worker thread feeds them to the model in order.
+// When the ring is full, or an event's strings don't fit in it, the game thread waits for the
+// worker to catch up and hands that event to the model itself.
+//
+// The model may only be touched from the game thread after a Flush(), which also has to happen
+// before anything that was captured by pointer can go away. The worker may still be flushing
+// the model's journal then, which CaptureJournal locks against.
+class CaptureQueue
+{
+public:
+	explicit CaptureQueue(ScriptModel &model);
+	~CaptureQueue() { Stop(); }
+
+	void Start();
+	// Delivers everything still queued, then stops the worker. Events are delivered synchronously until the next Start().
+	void Stop();
+	// Waits until every queued event has reached the model.
+	void Flush();
+
+	void Clear(VMType v);
+	void DestroyVM(VMType v);
+	void AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v);
+	void AddClass(ScriptClassDesc_t &classDesc, VMType v);
+	void AddValue(HSCRIPT hScope, const char *pszName, const ScriptVariant_t &value, VMType v);
+	void AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v);
+
+	// Events the game thread had to deliver itself, because the ring was full or the event too big for it.
+	size_t SyncFallbacks() const { return m_SyncFallbacks; }
+
+private:
+	CaptureEvent_t *BeginPush();
+	void EndPush();
+	void PushOrDeliver(CaptureEvent_t &event);
+	bool PackStrings(CaptureEvent_t &event, const char *pszA, const char *pszB, const char *pszC);
+
+	void Deliver(const CaptureEvent_t &event);
+	void ThreadMain();
+
+private:
+	static const uint32_t kCapacity = 4096; // Power of two
+
+	ScriptModel &m_Model;
+	std::unique_ptr<CaptureEvent_t[]> m_pRing;
+
+	// Free-running indices, masked on use. Kept apart so the two threads don't share a cache line.
+	std::atomic<uint32_t> m_Head; // Next slot to write. Only the game thread stores it.
+	char m_Pad1[64];
+	std::atomic<uint32_t> m_Tail; // Next slot to deliver, advanced once delivered. Only the worker stores it.
+	char m_Pad2[64];
+
+	std::atomic<bool> m_bWorkerWaiting;
+	std::atomic<bool> m_bStop;
+	std::mutex m_Mutex;
+	std::condition_variable m_CV;
+	std::thread m_Thread;
+
+	size_t m_SyncFallbacks;
+};
@@ -37,7 +37,11 @@ enum VMType : size_t
 	VM_Main = 0,
 	VM_Bot,
 
-	VM_Count
+	// Any further VMs are numbered on from here, in the order their slots are first needed.
+	VM_FirstExtra
 };
 
+// The engine's filesystem is thread safe. The plugin calls it from the game thread, the dump writer,
+// the render pool (for compressed dumps) and the capture worker, but only ever uses a FileHandle_t
+// from one thread at a time.
 extern IFileSystem *filesystem;
@@ -0,0 +1,109 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "compression.h"
+
+#include <cstring>
+
+const char *CompressionSuffix(DumpCompression_t compression)
+{
+	return compression == Compression_Gzip ? ".gz" : "";
+}
+
+bool CompressionAvailable(DumpCompression_t compression)
+{
+#ifdef D2V_ZLIB
+	return compression == Compression_None || compression == Compression_Gzip;
+#else
+	return compression == Compression_None;
+#endif
+}
+
+#ifdef D2V_ZLIB
+// Compressed bytes are handed to the next sink in pieces of this size.
+static const size_t kDeflateChunkSize = 16 * 1024;
+
+GzipSink::GzipSink(IOutputSink &out) : m_Out(out), m_bFinished(false)
+{
+	memset(&m_Stream, 0, sizeof(m_Stream));
+
+	// 15 window bits plus 16 asks zlib for a gzip header and trailer instead of a raw zlib stream.
+	m_bInitialized = deflateInit2(&m_Stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+	m_bFailed = !m_bInitialized;
+}
+
+GzipSink::~GzipSink()
+{
+	if (m_bInitialized)
+		deflateEnd(&m_Stream);
+}
+
+void GzipSink::Write(const char *pData, size_t len)
+{
+	if (m_bFailed)
+		return;
+
+	m_Stream.next_in = (Bytef *)pData;
+	m_Stream.avail_in = (uInt)len;
+	Deflate(Z_NO_FLUSH);
+}
+
+void GzipSink::Finish()
+{
+	if (m_bFinished || m_bFailed)
+		return;
+
+	m_Stream.next_in = nullptr;
+	m_Stream.avail_in = 0;
+	Deflate(Z_FINISH);
+	m_bFinished = true;
+}
+
+void GzipSink::Deflate(int flush)
+{
+	Bytef chunk[kDeflateChunkSize];
+
+	int ret;
+	do
+	{
+		m_Stream.next_out = chunk;
+		m_Stream.avail_out = sizeof(chunk);
+		ret = deflate(&m_Stream, flush);
+
+		// Z_BUF_ERROR only means there was nothing to do this time round.
+		if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+		{
+			m_bFailed = true;
+			return;
+		}
+
+		if (m_Stream.avail_out != sizeof(chunk))
+			m_Out.Write((const char *)chunk, sizeof(chunk) - m_Stream.avail_out);
+	} while (m_Stream.avail_out == 0 || (flush == Z_FINISH && ret == Z_OK));
+
+	if (flush == Z_FINISH && ret != Z_STREAM_END)
+		m_bFailed = true;
+}
+#endif
@@ -0,0 +1,77 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "outputbuffer.h"
+
+#include <cstdint>
+
+#ifdef D2V_ZLIB
+#include <zlib.h>
+#endif
+
+enum DumpCompression_t
+{
+	Compression_None,
+	Compression_Gzip,
+};
+
+// File name suffix for a compression mode, empty for none.
+const char *CompressionSuffix(DumpCompression_t compression);
+
+// Whether this build can produce the given compression mode.
+bool CompressionAvailable(DumpCompression_t compression);
+
+#ifdef D2V_ZLIB
+// Gzip-compresses everything written to it, passing the compressed stream on to another sink as it
+// goes. Finish() must be called once all input has been written.
+class GzipSink : public IOutputSink
+{
+public:
+	explicit GzipSink(IOutputSink &out);
+	~GzipSink();
+
+	void Write(const char *pData, size_t len) override;
+	void Finish();
+
+	// zlib couldn't set up or went wrong part way, so the stream is incomplete. Anything written
+	// from then on is dropped.
+	bool Failed() const { return m_bFailed; }
+
+private:
+	GzipSink(const GzipSink &) = delete;
+	GzipSink &operator=(const GzipSink &) = delete;
+
+	void Deflate(int flush);
+
+private:
+	IOutputSink &m_Out;
+	z_stream m_Stream;
+	bool m_bInitialized;
+	bool m_bFinished;
+	bool m_bFailed;
+};
+#endif
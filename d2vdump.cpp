@@ -25,10 +25,14 @@
 
 // Self
 #include "d2vdump.h"
+#include "log.h"
+#include "workerpool.h"
 
 // SDK
+#include <eiface.h>
 #include <filesystem.h>
 #include <icvar.h>
+#include <tier0/icommandline.h>
 #include <tier0/platform.h>
 #include <tier1/fmtstr.h>
 #include <tier1/iconvar.h>
@@ -37,6 +41,40 @@ static D2VDump g_D2VDump;
 
 IFileSystem *filesystem;
 static IScriptManager *scriptmgr;
+static ISource2Server *gamedll;
+
+static const char *kJournalPath = "vdump/journal.bin";
+static const char *kPrevJournalPath = "vdump/journal.prev.bin";
+static const char *kFilterPath = "vdump/filter.txt";
+
+static ConVar vdump_autoflush_interval("vdump_autoflush_interval", "0", 0, "Seconds between background dump writes while anything new is being captured. 0 disables.", true, 0.0f, false, 0.0f);
+
+static ConVar vdump_compress("vdump_compress", "0", 0, "Compression for text dump files. 0 = none, 1 = gzip (.gz).", true, 0.0f, true, 1.0f);
+
+static ConVar vdump_value_history("vdump_value_history", "0", 0, "Previous values to keep for each global, written out as its history in values<vm>.json. Takes effect from the next VM created.", true, 0.0f, true, 64.0f);
+
+static ConVar vdump_filter("vdump_filter", "", 0, "Capture filter rules, added to those in vdump/filter.txt. Space separated globs, optionally prefixed with - to exclude and class:, function:, enum: or value: to narrow them, e.g. \"class:CDOTA_* -value:_*\". Only affects what's captured from then on.");
+
+static ConVar vdump_log_level("vdump_log_level", "0", 0, "Logs script registrations to the console (developer 1) from a background thread. 0 = off, 1 = enum values, 2 = enum values and globals.", true, 0.0f, true, 2.0f);
+
+CON_COMMAND(vdump_write, "Writes out everything captured so far, in the background.")
+{
+	g_D2VDump.QueueWrite();
+}
+
+CON_COMMAND(vdump_stats, "Prints call counts and timings for every hook, model and dumper method.")
+{
+	StatsPrint([](const char *pszLine) { META_CONPRINT(pszLine); });
+}
+
+#if D2V_STATS
+// Times a hook on a script VM, attributed to that VM.
+#define D2V_HOOK_STAT(id) D2V_STAT_SCOPE(id, VMTypeOf(META_IFACEPTR(IScriptVM)))
+#else
+#define D2V_HOOK_STAT(id)
+#endif
+
+SH_DECL_HOOK3_void(ISource2Server, GameFrame, SH_NOATTRIB, 0, bool, bool, bool);
 
 SH_DECL_HOOK1(IScriptManager, CreateVM, SH_NOATTRIB, 0, IScriptVM *, ScriptLanguage_t);
 SH_DECL_HOOK1_void(IScriptManager, DestroyVM, SH_NOATTRIB, 0, IScriptVM *);
@@ -46,6 +84,7 @@ SH_DECL_HOOK1(IScriptVM, RegisterScriptClass, SH_NOATTRIB, 0, bool, ScriptClassD
 SH_DECL_HOOK2(IScriptVM, RegisterInstance, SH_NOATTRIB, 0, HSCRIPT, ScriptClassDesc_t *, void *);
 SH_DECL_HOOK3(IScriptVM, SetValue, SH_NOATTRIB, 0, bool, HSCRIPT, const char *, const char *);
 SH_DECL_HOOK3(IScriptVM, SetValue, SH_NOATTRIB, 1, bool, HSCRIPT, const char *, const ScriptVariant_t &);
+SH_DECL_HOOK3(IScriptVM, SetValue, SH_NOATTRIB, 2, bool, HSCRIPT, int, const ScriptVariant_t &);
 SH_DECL_HOOK5(IScriptVM, SetEnumValue, SH_NOATTRIB, 0, bool, HSCRIPT, const char *, const char *, int, const char *);
 
 
@@ -60,7 +99,7 @@ public:
 
 PLUGIN_EXPOSE(D2VDump, g_D2VDump);
 
-bool D2VDump::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool late)
+bool D2VDump::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool)
 {
 	PLUGIN_SAVEVARS();
 
@@ -70,23 +109,96 @@ bool D2VDump::Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool
 		return false;
 	}
 
-	memset(m_VMs, 0, sizeof(m_VMs));
 	m_Dumpers.push_back(new JSONScriptDumper());
+	m_Dumpers.push_back(new BinaryScriptDumper());
+
+	// Well known VMs always get a dump, even if they never come up.
+	while (m_VMs.size() < VM_FirstExtra)
+	{
+		AddVMSlot();
+	}
 
 	if (!filesystem->IsDirectory("vdump", "DEFAULT_WRITE_PATH"))
 		filesystem->CreateDirHierarchy("vdump", "DEFAULT_WRITE_PATH");
 
+	if (CommandLine()->HasParm("-vdump_journal"))
+		OpenJournal();
+
+	LoadFilter();
+
+	StatsRegisterThread();
+	LogRegisterThread();
+	LogSetLevel(vdump_log_level.GetInt());
+	LogStart([](const char *pszLine) { DevMsg("%s", pszLine); });
+	m_Capture.Start();
+	m_Writer.Start();
 	InitHooks();
 
 	return true;
 }
 
+void D2VDump::OpenJournal()
+{
+	// Still there means the last session never got to Unload. Keep it around for tools/vdumprecover.
+	if (filesystem->FileExists(kJournalPath, "DEFAULT_WRITE_PATH"))
+	{
+		filesystem->RemoveFile(kPrevJournalPath, "DEFAULT_WRITE_PATH");
+		filesystem->RenameFile(kJournalPath, kPrevJournalPath, "DEFAULT_WRITE_PATH");
+		Warning("D2V: Last session didn't unload cleanly, its capture journal is in %s. Recover it with vdumprecover.\n", kPrevJournalPath);
+	}
+
+	if (m_Journal.Open(kJournalPath))
+		m_Model.SetJournal(&m_Journal);
+	else
+		Warning("D2V: Failed to open %s, capturing without a journal\n", kJournalPath);
+}
+
+void D2VDump::LoadFilter()
+{
+	std::string rules;
+	FileHandle_t f = filesystem->Open(kFilterPath, "r", "DEFAULT_WRITE_PATH");
+	if (f != FILESYSTEM_INVALID_HANDLE)
+	{
+		rules.resize(filesystem->Size(f));
+		int len = filesystem->Read(&rules[0], (int)rules.size(), f);
+		rules.resize(len > 0 ? len : 0);
+		filesystem->Close(f);
+	}
+
+	m_FilterConVar = vdump_filter.GetString();
+	rules += '\n';
+	rules += m_FilterConVar;
+
+	std::string error;
+	if (!m_Filter.Compile(rules.c_str(), error))
+	{
+		Warning("D2V: Bad capture filter (%s), keeping the previous one\n", error.c_str());
+		return;
+	}
+
+	// Classes it used to reject get another look the next time they turn up.
+	for (auto &vm : m_VMs)
+		vm->seenClasses.Clear();
+}
+
+void D2VDump::CloseJournal()
+{
+	if (!m_Journal.IsOpen())
+		return;
+
+	m_Model.SetJournal(nullptr);
+	m_Journal.Close();
+	// Everything in it has just been dumped.
+	filesystem->RemoveFile(kJournalPath, "DEFAULT_WRITE_PATH");
+}
+
 bool D2VDump::InitGlobals(char *error, size_t maxlen)
 {
 	ISmmAPI *ismm = g_SMAPI;
 
 	GET_V_IFACE_CURRENT(GetFileSystemFactory, filesystem, IFileSystem, FILESYSTEM_INTERFACE_VERSION);
 	GET_V_IFACE_CURRENT(GetEngineFactory, scriptmgr, IScriptManager, VSCRIPT_INTERFACE_VERSION);
+	GET_V_IFACE_ANY(GetServerFactory, gamedll, ISource2Server, INTERFACEVERSION_SERVERGAMEDLL);
 
 	ICvar *icvar;
 	GET_V_IFACE_CURRENT(GetEngineFactory, icvar, ICvar, CVAR_INTERFACE_VERSION);
@@ -100,126 +212,275 @@ void D2VDump::InitHooks()
 {
 	SH_ADD_HOOK(IScriptManager, CreateVM, scriptmgr, SH_MEMBER(this, &D2VDump::Hook_CreateVM), false);
 	SH_ADD_HOOK(IScriptManager, DestroyVM, scriptmgr, SH_MEMBER(this, &D2VDump::Hook_DestroyVM), false);
+	SH_ADD_HOOK(ISource2Server, GameFrame, gamedll, SH_MEMBER(this, &D2VDump::Hook_GameFrame), true);
 }
 
 void D2VDump::ShutdownHooks()
 {
+	SH_REMOVE_HOOK(ISource2Server, GameFrame, gamedll, SH_MEMBER(this, &D2VDump::Hook_GameFrame), true);
 	SH_REMOVE_HOOK(IScriptManager, DestroyVM, scriptmgr, SH_MEMBER(this, &D2VDump::Hook_DestroyVM), false);
 	SH_REMOVE_HOOK(IScriptManager, CreateVM, scriptmgr, SH_MEMBER(this, &D2VDump::Hook_CreateVM), false);
 }
 
-bool D2VDump::Unload(char *error, size_t maxlen)
+bool D2VDump::Unload(char *, size_t)
 {
 	ShutdownHooks();
+	LogStop();
+	m_Capture.Stop();
+	m_Writer.Stop();
 
-	for (size_t i = 0; i < VM_Count; ++i)
-	{
-		for (auto d : m_Dumpers)
-		{
-			FileHandle_t f;
-			f = filesystem->Open(CFmtStr("vdump/out%u.%s", i, d->GetOutputTypeName()), "w", "DEFAULT_WRITE_PATH");
-			d->SaveFunctionsToDisk(f, VMType(i));
-			filesystem->Close(f);
-
-			f = filesystem->Open(CFmtStr("vdump/values%u.%s", i, d->GetOutputTypeName()), "w", "DEFAULT_WRITE_PATH");
-			d->SaveValuesToDisk(f, VMType(i));
-			filesystem->Close(f);
-		}
-	}
+	if (m_Capture.SyncFallbacks())
+		DevMsg("D2V: %u captures were handed to the model on the game thread\n", (unsigned)m_Capture.SyncFallbacks());
+
+	double flStart = Plat_FloatTime();
+	SaveDumps();
+	DevMsg("D2V: Saved dumps in %.3f ms\n", (Plat_FloatTime() - flStart) * 1000.0);
+
+	StatsWriteJSON("vdump/stats.json");
+	CloseJournal();
 
 	for (auto d : m_Dumpers)
 		delete d;
 
 	m_Dumpers.clear();
+	m_Model.Reset();
+	// Nothing may resolve to a context freed here, should the plugin load again or a VM turn up at the same address.
+	m_VMs.clear();
+	m_VMLookup.Clear();
+	m_pLastVM = nullptr;
+	m_pLastVMContext = nullptr;
 
 	return true;
 }
 
-void D2VDump::Hook_RegisterFunction(ScriptFunctionBinding_t *pScriptFunction)
+std::vector<VMType> D2VDump::GetVMTypes() const
 {
-	VMType v = VMToVMType(META_IFACEPTR(IScriptVM));
-	if (v != VM_Unknown)
+	std::vector<VMType> vms;
+	for (auto &vm : m_VMs)
+		vms.push_back(vm->type);
+
+	return vms;
+}
+
+// Read on the game thread, so a write in the background uses the settings from when it was queued.
+static DumpWriteOptions_t GetDumpWriteOptions()
+{
+	DumpWriteOptions_t options;
+	options.compression = (DumpCompression_t)vdump_compress.GetInt();
+
+	if (!CompressionAvailable(options.compression))
 	{
-		for (auto d : m_Dumpers)
-		{
-			d->AddFunction(pScriptFunction->m_desc, v);
-		}
+		Warning("D2V: vdump_compress %d is not supported by this build, writing uncompressed\n", (int)options.compression);
+		options.compression = Compression_None;
 	}
 
-	RETURN_META(MRES_IGNORED);
+	return options;
 }
 
-bool D2VDump::Hook_RegisterScriptClass(ScriptClassDesc_t *pClassDesc)
+void D2VDump::SaveDumps()
+{
+	m_Capture.Flush();
+	DumpWriter::WriteDumps(m_Model, m_Dumpers, GetVMTypes(), GetDumpWriteOptions());
+}
+
+void D2VDump::QueueWrite()
+{
+	double flStart = Plat_FloatTime();
+
+	m_Capture.Flush();
+
+	DumpSnapshot_t *pSnapshot = new DumpSnapshot_t;
+	pSnapshot->pModel.reset(new ScriptModel(m_Model));
+	pSnapshot->dumpers = m_Dumpers;
+	pSnapshot->vms = GetVMTypes();
+	pSnapshot->options = GetDumpWriteOptions();
+
+	m_Writer.Submit(pSnapshot);
+	m_bDirty = false;
+
+	DevMsg("D2V: Snapshot for background write took %.3f ms\n", (Plat_FloatTime() - flStart) * 1000.0);
+}
+
+void D2VDump::Hook_GameFrame(bool, bool, bool)
 {
-	VMType v = VMToVMType(META_IFACEPTR(IScriptVM));
-	if (v != VM_Unknown)
+	// Picked up here rather than read in every hook.
+	LogSetLevel(vdump_log_level.GetInt());
+	if (m_FilterConVar != vdump_filter.GetString())
+		LoadFilter();
+
+	float flInterval = vdump_autoflush_interval.GetFloat();
+	if (flInterval > 0.0f && m_bDirty)
 	{
-		for (auto d : m_Dumpers)
+		double flNow = Plat_FloatTime();
+		if (flNow >= m_flNextAutoFlush)
 		{
-			d->AddClass(*pClassDesc, v);
+			QueueWrite();
+			m_flNextAutoFlush = flNow + flInterval;
 		}
 	}
 
-	RETURN_META_VALUE(MRES_IGNORED, true);
+	RETURN_META(MRES_IGNORED);
+}
+
+D2VDump::VMContext_t *D2VDump::AddVMSlot()
+{
+	VMContext_t *pContext = new VMContext_t;
+	pContext->type = VMType(m_VMs.size());
+	m_VMs.emplace_back(pContext);
+
+	return pContext;
 }
 
-HSCRIPT D2VDump::Hook_RegisterInstance(ScriptClassDesc_t *pDesc, void *pInstance)
+void D2VDump::OnCreateVM(IScriptVM *pVM)
 {
-	VMType v = VMToVMType(META_IFACEPTR(IScriptVM));
-	if (v != VM_Unknown)
+	// Main VM is always (re)created first, at map start. Bot VM is created after lobby data is received, if lobby uses lua bots.
+	// Anything else takes the first free slot after those, so a VM that keeps being recreated keeps its number.
+	VMContext_t *pContext = nullptr;
+	for (auto &vm : m_VMs)
 	{
-		for (auto d : m_Dumpers)
+		if (!vm->pVM)
 		{
-			d->AddClass(*pDesc, v);
+			pContext = vm.get();
+			break;
 		}
 	}
 
-	RETURN_META_VALUE(MRES_IGNORED, INVALID_HSCRIPT);
+	if (!pContext)
+	{
+		pContext = AddVMSlot();
+	}
+
+	if (pContext->type >= VM_FirstExtra)
+	{
+		DevMsg("D2V: Got new lua VM at 0x%p, dumping as VM %u\n", pVM, (unsigned)pContext->type);
+	}
+
+	pContext->pVM = pVM;
+	m_VMLookup.Set(pVM, pContext);
+	m_pLastVM = nullptr;
+
+	m_Model.SetValueHistory(vdump_value_history.GetInt());
+	m_Capture.Clear(pContext->type);
 }
 
-IScriptVM *D2VDump::Hook_CreateVM(ScriptLanguage_t language)
+void D2VDump::OnDestroyVM(IScriptVM *pVM)
 {
-	IScriptVM *pVM = SH_CALL(scriptmgr, &IScriptManager::CreateVM)(language);
-	VMType vmType = VM_Unknown;
+	VMContext_t *pContext = FindVM(pVM);
+	if (pContext)
+	{
+		// Whatever it registered must reach the model before its descriptors can go away.
+		m_Capture.DestroyVM(pContext->type);
+		m_Capture.Flush();
 
-	// Main VM is always (re)created first, at map start. Bot VM is created after lobby data is received, if lobby uses lua bots.
-	if (!m_VMs[VM_Main])
+		pContext->pVM = nullptr;
+		m_VMLookup.Remove(pVM);
+		m_pLastVM = nullptr;
+	}
+}
+
+void D2VDump::OnRegisterFunction(IScriptVM *pVM, ScriptFunctionBinding_t *pScriptFunction)
+{
+	VMContext_t *pContext = FindVM(pVM);
+	if (pContext && m_Filter.Accepts(Filter_Function, pScriptFunction->m_desc.m_pszScriptName))
 	{
-		vmType = VM_Main;
+		m_Capture.AddFunction(pScriptFunction->m_desc, pContext->type);
+		m_bDirty = true;
 	}
-	else if (!m_VMs[VM_Bot])
+}
+
+void D2VDump::OnRegisterScriptClass(IScriptVM *pVM, ScriptClassDesc_t *pClassDesc)
+{
+	VMContext_t *pContext = FindVM(pVM);
+	if (pContext && pContext->seenClasses.Insert(pClassDesc) && m_Filter.Accepts(Filter_Class, pClassDesc->m_pszScriptName))
 	{
-		vmType = VM_Bot;
+		m_Capture.AddClass(*pClassDesc, pContext->type);
+		m_bDirty = true;
 	}
-	else
+}
+
+void D2VDump::OnRegisterInstance(IScriptVM *pVM, ScriptClassDesc_t *pDesc)
+{
+	// Called once per scripted entity, nearly always with a desc that's been seen before.
+	VMContext_t *pContext = FindVM(pVM);
+	if (pContext && pContext->seenClasses.Insert(pDesc) && m_Filter.Accepts(Filter_Class, pDesc->m_pszScriptName))
 	{
-		DevMsg("D2V: Got new unknown lua VM at 0x%p\n", pVM);
+		m_Capture.AddClass(*pDesc, pContext->type);
+		m_bDirty = true;
 	}
+}
 
-	if (vmType != VM_Unknown)
+void D2VDump::OnSetValue(IScriptVM *pVM, HSCRIPT hScope, const char *pszKey, const ScriptVariant_t &value)
+{
+	VMContext_t *pContext = FindVM(pVM);
+	if (pContext && m_Filter.Accepts(Filter_Value, pszKey))
 	{
-		m_VMs[vmType] = pVM;
-		for (auto d : m_Dumpers)
-		{
-			d->Clear(vmType);
-		}
+		m_Capture.AddValue(hScope, pszKey, value, pContext->type);
+		m_bDirty = true;
+	}
+}
 
-		SH_ADD_HOOK(IScriptVM, RegisterFunction, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterFunction), false);
-		SH_ADD_HOOK(IScriptVM, RegisterScriptClass, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterScriptClass), false);
-		SH_ADD_HOOK(IScriptVM, RegisterInstance, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterInstance), false);
-		SH_ADD_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue1), false);
-		SH_ADD_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue2), false);
-		SH_ADD_HOOK(IScriptVM, SetEnumValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetEnumValue), false);
-		SH_ADD_HOOK(IScriptVM, SetEnumValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetEnumValue_Post), true);
+void D2VDump::OnSetEnumValue(IScriptVM *pVM, HSCRIPT, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription)
+{
+	VMContext_t *pContext = FindVM(pVM);
+	if (pContext && m_Filter.Accepts(Filter_Enum, pszEnumName))
+	{
+		m_Capture.AddEnumValue(pszEnumName, pszValueName, pszDescription, value, pContext->type);
+		m_bDirty = true;
 	}
+}
+
+void D2VDump::Hook_RegisterFunction(ScriptFunctionBinding_t *pScriptFunction)
+{
+	D2V_HOOK_STAT(Stat_RegisterFunction);
+
+	OnRegisterFunction(META_IFACEPTR(IScriptVM), pScriptFunction);
+
+	RETURN_META(MRES_IGNORED);
+}
+
+bool D2VDump::Hook_RegisterScriptClass(ScriptClassDesc_t *pClassDesc)
+{
+	D2V_HOOK_STAT(Stat_RegisterScriptClass);
+
+	OnRegisterScriptClass(META_IFACEPTR(IScriptVM), pClassDesc);
+
+	RETURN_META_VALUE(MRES_IGNORED, true);
+}
+
+HSCRIPT D2VDump::Hook_RegisterInstance(ScriptClassDesc_t *pDesc, void *)
+{
+	D2V_HOOK_STAT(Stat_RegisterInstance);
+
+	OnRegisterInstance(META_IFACEPTR(IScriptVM), pDesc);
+
+	RETURN_META_VALUE(MRES_IGNORED, INVALID_HSCRIPT);
+}
+
+IScriptVM *D2VDump::Hook_CreateVM(ScriptLanguage_t language)
+{
+	IScriptVM *pVM = SH_CALL(scriptmgr, &IScriptManager::CreateVM)(language);
+
+	D2V_STAT_SCOPE(Stat_CreateVM, VM_Unknown);
+	OnCreateVM(pVM);
+	D2V_STAT_SET_VM(VMTypeOf(pVM));
+
+	SH_ADD_HOOK(IScriptVM, RegisterFunction, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterFunction), false);
+	SH_ADD_HOOK(IScriptVM, RegisterScriptClass, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterScriptClass), false);
+	SH_ADD_HOOK(IScriptVM, RegisterInstance, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterInstance), false);
+	SH_ADD_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue1), false);
+	SH_ADD_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue2), false);
+	SH_ADD_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue3), false);
+	SH_ADD_HOOK(IScriptVM, SetEnumValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetEnumValue), false);
+	SH_ADD_HOOK(IScriptVM, SetEnumValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetEnumValue_Post), true);
 
 	RETURN_META_VALUE(MRES_SUPERCEDE, pVM);
 }
 
 void D2VDump::Hook_DestroyVM(IScriptVM *pVM)
 {
-	VMType v = VMToVMType(pVM);
-	if (v != VM_Unknown)
+	D2V_STAT_SCOPE(Stat_DestroyVM, VMTypeOf(pVM));
+
+	if (FindVM(pVM))
 	{
 		SH_REMOVE_HOOK(IScriptVM, RegisterFunction, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterFunction), false);
 		SH_REMOVE_HOOK(IScriptVM, RegisterScriptClass, pVM, SH_MEMBER(this, &D2VDump::Hook_RegisterScriptClass), false);
@@ -227,10 +488,11 @@ void D2VDump::Hook_DestroyVM(IScriptVM *pVM)
 
 		SH_REMOVE_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue1), false);
 		SH_REMOVE_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue2), false);
+		SH_REMOVE_HOOK(IScriptVM, SetValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetValue3), false);
 		SH_REMOVE_HOOK(IScriptVM, SetEnumValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetEnumValue), false);
 		SH_REMOVE_HOOK(IScriptVM, SetEnumValue, pVM, SH_MEMBER(this, &D2VDump::Hook_SetEnumValue_Post), true);
 
-		m_VMs[v] = nullptr;
+		OnDestroyVM(pVM);
 	}
 
 	RETURN_META(MRES_IGNORED);
@@ -238,17 +500,12 @@ void D2VDump::Hook_DestroyVM(IScriptVM *pVM)
 
 bool D2VDump::Hook_SetValue1(HSCRIPT hScope, const char *pszKey, const char *pszValue)
 {
+	D2V_HOOK_STAT(Stat_SetValue1);
+
 	if (!m_bInSetEnumValue)
 	{
-		DevMsg("SV!: (HSCRIPT: %p) (Name: \"%s\")\n", hScope, pszKey);
-		VMType v = VMToVMType(META_IFACEPTR(IScriptVM));
-		if (v != VM_Unknown)
-		{
-			for (auto d : m_Dumpers)
-			{
-				d->AddValue(pszKey, ScriptVariant_t(pszValue), v);
-			}
-		}
+		D2V_LOG_EVENT(LogLevel_Values, Log_SetValue1, hScope, pszKey);
+		OnSetValue(META_IFACEPTR(IScriptVM), hScope, pszKey, ScriptVariant_t(pszValue));
 	}
 
 	RETURN_META_VALUE(MRES_IGNORED, true);
@@ -256,40 +513,47 @@ bool D2VDump::Hook_SetValue1(HSCRIPT hScope, const char *pszKey, const char *psz
 
 bool D2VDump::Hook_SetValue2(HSCRIPT hScope, const char *pszKey, const ScriptVariant_t &value)
 {
+	D2V_HOOK_STAT(Stat_SetValue2);
+
 	if (!m_bInSetEnumValue)
 	{
-		DevMsg("SV2: (HSCRIPT: %p) (Name: \"%s\")\n", hScope, pszKey);
-		VMType v = VMToVMType(META_IFACEPTR(IScriptVM));
-		if (v != VM_Unknown)
-		{
-			for (auto d : m_Dumpers)
-			{
-				d->AddValue(pszKey, value, v);
-			}
-		}
+		D2V_LOG_EVENT(LogLevel_Values, Log_SetValue2, hScope, pszKey);
+		OnSetValue(META_IFACEPTR(IScriptVM), hScope, pszKey, value);
 	}
 
 	RETURN_META_VALUE(MRES_IGNORED, true);
 }
 
-bool D2VDump::Hook_SetEnumValue(HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription)
+bool D2VDump::Hook_SetValue3(HSCRIPT hScope, int nIndex, const ScriptVariant_t &value)
 {
-	DevMsg("SEV: (HSCRIPT: %p) (Name: \"%s\") (Value: (\"%s\")\n", hScope, pszValueName, pszValueName);
-	m_bInSetEnumValue = true;
+	D2V_HOOK_STAT(Stat_SetValue3);
 
-	VMType v = VMToVMType(META_IFACEPTR(IScriptVM));
-	if (v != VM_Unknown)
+	if (!m_bInSetEnumValue)
 	{
-		for (auto d : m_Dumpers)
-		{
-			d->AddEnumValue(pszEnumName, pszValueName, pszDescription, value, v);
-		}
+		// Array slots are captured as keys of their own, written the way they'd be indexed.
+		char szKey[16];
+		Q_snprintf(szKey, sizeof(szKey), "[%d]", nIndex);
+
+		D2V_LOG_EVENT(LogLevel_Values, Log_SetValue3, hScope, szKey);
+		OnSetValue(META_IFACEPTR(IScriptVM), hScope, szKey, value);
 	}
 
 	RETURN_META_VALUE(MRES_IGNORED, true);
 }
 
-bool D2VDump::Hook_SetEnumValue_Post(HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription)
+bool D2VDump::Hook_SetEnumValue(HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription)
+{
+	D2V_HOOK_STAT(Stat_SetEnumValue);
+
+	D2V_LOG_EVENT(LogLevel_Enums, Log_SetEnumValue, hScope, pszEnumName, pszValueName, value);
+	m_bInSetEnumValue = true;
+
+	OnSetEnumValue(META_IFACEPTR(IScriptVM), hScope, pszEnumName, pszValueName, value, pszDescription);
+
+	RETURN_META_VALUE(MRES_IGNORED, true);
+}
+
+bool D2VDump::Hook_SetEnumValue_Post(HSCRIPT, const char *, const char *, int, const char *)
 {
 	m_bInSetEnumValue = false;
 
@@ -28,14 +28,26 @@
 #include <ISmmPlugin.h>
 
 #include "common.h"
+#include "binarydumper.h"
+#include "capturefilter.h"
+#include "capturejournal.h"
+#include "capturequeue.h"
+#include "dumpwriter.h"
+#include "hashmap.h"
 #include "jsondumper.h"
+#include "stats.h"
 
 #include <vscript/ivscript.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 class D2VDump : public ISmmPlugin
 {
+public:
+	D2VDump() : m_Capture(m_Model) {}
+
 public: // ISmmPlugin
 	bool Load(PluginId id, ISmmAPI *ismm, char *error, size_t maxlen, bool late) override;
 	bool Unload(char *error, size_t maxlen) override;
@@ -48,13 +60,47 @@ public: // ISmmPlugin
 	const char *GetDate() override;
 	const char *GetLogTag() override;
 
+public: // Capture entry points. Hooks forward here so a capture can be replayed without SourceHook.
+	void OnCreateVM(IScriptVM *pVM);
+	void OnDestroyVM(IScriptVM *pVM);
+	void OnRegisterFunction(IScriptVM *pVM, ScriptFunctionBinding_t *pScriptFunction);
+	void OnRegisterScriptClass(IScriptVM *pVM, ScriptClassDesc_t *pClassDesc);
+	void OnRegisterInstance(IScriptVM *pVM, ScriptClassDesc_t *pDesc);
+	void OnSetValue(IScriptVM *pVM, HSCRIPT hScope, const char *pszKey, const ScriptVariant_t &value);
+	void OnSetEnumValue(IScriptVM *pVM, HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription);
+	// Waits until the capture worker has handed everything the hooks queued to the model.
+	void FlushCapture() { m_Capture.Flush(); }
+	void SaveDumps();
+	// Snapshots the capture and hands it to the background writer.
+	void QueueWrite();
+
 private:
 	bool InitGlobals(char *error, size_t maxlen);
 	void InitHooks();
+	void OpenJournal();
+	void CloseJournal();
+	// (Re)compiles vdump/filter.txt and vdump_filter into m_Filter.
+	void LoadFilter();
 	void ShutdownHooks();
-	VMType VMToVMType(IScriptVM *pVM);
+
+	struct VMContext_t
+	{
+		VMType type;
+		IScriptVM *pVM = nullptr; // Null once destroyed. The slot, and what was captured in it, is kept until Unload.
+		PointerHashSet seenClasses; // Class descs already captured
+	};
+
+	VMContext_t *AddVMSlot();
+	VMContext_t *FindVM(IScriptVM *pVM);
+	VMType VMTypeOf(IScriptVM *pVM)
+	{
+		VMContext_t *pContext = FindVM(pVM);
+		return pContext ? pContext->type : VM_Unknown;
+	}
+	std::vector<VMType> GetVMTypes() const;
 
 private:
+	void Hook_GameFrame(bool simulating, bool bFirstTick, bool bLastTick);
 	void Hook_RegisterFunction(ScriptFunctionBinding_t *pScriptFunction);
 	bool Hook_RegisterScriptClass(ScriptClassDesc_t *pClassDesc);
 	HSCRIPT Hook_RegisterInstance(ScriptClassDesc_t *pDesc, void *pInstance);
@@ -67,22 +113,34 @@ private:
 	bool Hook_SetEnumValue_Post(HSCRIPT hScope, const char *pszEnumName, const char *pszValueName, int value, const char *pszDescription);
 
 private:
-	IScriptVM *m_VMs[VM_Count];
+	std::vector<std::unique_ptr<VMContext_t>> m_VMs;
+	PointerHashMap<VMContext_t *> m_VMLookup;
+	IScriptVM *m_pLastVM = nullptr;
+	VMContext_t *m_pLastVMContext = nullptr;
 	bool m_bInSetEnumValue = false;
-	std::vector<IScriptDumper *> m_Dumpers;
+	CaptureFilter m_Filter;
+	std::string m_FilterConVar; // vdump_filter as of the last LoadFilter
+	CaptureJournal m_Journal; // Only open with -vdump_journal
+	ScriptModel m_Model;
+	CaptureQueue m_Capture; // The only way to reach m_Model from the hooks
+	std::vector<IScriptDumper *> m_Dumpers; // Render m_Model at save time
+
+	DumpWriter m_Writer;
+	bool m_bDirty = false; // Captured anything since the last snapshot
+	double m_flNextAutoFlush = 0.0;
 };
 
-inline VMType D2VDump::VMToVMType(IScriptVM *pVM)
+inline D2VDump::VMContext_t *D2VDump::FindVM(IScriptVM *pVM)
 {
-	for (size_t i = 0; i < VM_Count; ++i)
+	// Hooks come in long runs from the same VM, so remember the last lookup.
+	if (pVM != m_pLastVM)
 	{
-		if (pVM == m_VMs[i])
-		{
-			return VMType(i);
-		}
+		VMContext_t **ppContext = m_VMLookup.Find(pVM);
+		m_pLastVM = pVM;
+		m_pLastVMContext = ppContext ? *ppContext : nullptr;
 	}
 
-	return VM_Unknown;
+	return m_pLastVMContext;
 }
 
 PLUGIN_GLOBALVARS();
@@ -0,0 +1,304 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumpwriter.h"
+#include "fingerprint.h"
+#include "stats.h"
+#include "workerpool.h"
+
+#include <tier0/platform.h>
+#include <tier1/fmtstr.h>
+
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+void DumpWriter::Start()
+{
+	if (m_Thread.joinable())
+		return;
+
+	m_bStop = false;
+	m_Thread = std::thread(&DumpWriter::ThreadMain, this);
+}
+
+void DumpWriter::Stop()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bStop = true;
+		m_pPending.reset();
+	}
+	m_CV.notify_one();
+	m_Thread.join();
+}
+
+void DumpWriter::Submit(DumpSnapshot_t *pSnapshot)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_pPending.reset(pSnapshot);
+	}
+	m_CV.notify_one();
+}
+
+void DumpWriter::ThreadMain()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_CV.wait(lock, [this]() { return m_bStop || m_pPending; });
+		if (m_bStop)
+			return;
+
+		std::unique_ptr<DumpSnapshot_t> pSnapshot(std::move(m_pPending));
+		lock.unlock();
+
+		double flStart = Plat_FloatTime();
+		WriteDumps(*pSnapshot->pModel, pSnapshot->dumpers, pSnapshot->vms, pSnapshot->options);
+		DevMsg("D2V: Wrote dumps in the background in %.3f ms\n", (Plat_FloatTime() - flStart) * 1000.0);
+
+		pSnapshot.reset();
+		lock.lock();
+	}
+}
+
+// Bump whenever any dumper's output changes for the same captured data, so old files get rewritten.
+static const uint32_t kDumpFormatVersion = 2;
+
+static bool ReadFingerprint(const char *pszPath, uint64_t &fingerprint)
+{
+	FileHandle_t f = filesystem->Open(pszPath, "r", "DEFAULT_WRITE_PATH");
+	if (f == FILESYSTEM_INVALID_HANDLE)
+		return false;
+
+	char szHex[17] = {};
+	int len = filesystem->Read(szHex, sizeof(szHex) - 1, f);
+	filesystem->Close(f);
+	if (len != sizeof(szHex) - 1)
+		return false;
+
+	char *pEnd;
+	fingerprint = strtoull(szHex, &pEnd, 16);
+	return pEnd == &szHex[len];
+}
+
+static void WriteFingerprint(const char *pszPath, uint64_t fingerprint)
+{
+	FileHandle_t f = filesystem->Open(pszPath, "w", "DEFAULT_WRITE_PATH");
+	if (f == FILESYSTEM_INVALID_HANDLE)
+		return;
+
+	char szHex[17];
+	Q_snprintf(szHex, sizeof(szHex), "%016llx", (unsigned long long)fingerprint);
+	filesystem->Write(szHex, sizeof(szHex) - 1, f);
+	filesystem->Close(f);
+}
+
+// Writes a rendered file, then its fingerprint, last, so an interrupted write is never mistaken for a complete one.
+static bool WriteDumpFile(const std::string &path, const char *pszMode, const OutputBuffer &out, uint64_t fingerprint)
+{
+	FileHandle_t f = filesystem->Open(path.c_str(), pszMode, "DEFAULT_WRITE_PATH");
+	if (f == FILESYSTEM_INVALID_HANDLE)
+		return false;
+
+	bool bWritten = filesystem->Write(out.Data(), (int)out.Size(), f) == (int)out.Size();
+	filesystem->Close(f);
+	if (!bWritten)
+		return false;
+
+	WriteFingerprint(CFmtStr("%s.fingerprint", path.c_str()), fingerprint);
+	return true;
+}
+
+#ifdef D2V_ZLIB
+// Passes everything written to it straight on to an open file, remembering whether it all got there.
+class FileSink : public IOutputSink
+{
+public:
+	explicit FileSink(FileHandle_t f) : m_File(f), m_bFailed(false) {}
+
+	void Write(const char *pData, size_t len) override
+	{
+		if (!m_bFailed && filesystem->Write(pData, (int)len, m_File) != (int)len)
+			m_bFailed = true;
+	}
+
+	bool Failed() const { return m_bFailed; }
+
+private:
+	FileHandle_t m_File;
+	bool m_bFailed;
+};
+
+// Renders through the compressor into the file as it goes, so only a chunk of each is held at a
+// time. The fingerprint is written last, as in WriteDumpFile, and a file that didn't come out
+// whole is removed.
+static bool WriteCompressedDumpFile(const std::string &path, const char *pszMode, const std::function<void(OutputBuffer &)> &save, uint64_t fingerprint)
+{
+	FileHandle_t f = filesystem->Open(path.c_str(), pszMode, "DEFAULT_WRITE_PATH");
+	if (f == FILESYSTEM_INVALID_HANDLE)
+		return false;
+
+	FileSink file(f);
+	bool bWritten;
+	{
+		GzipSink gzip(file);
+		if (!gzip.Failed())
+		{
+			OutputBuffer stream(&gzip);
+			save(stream);
+		}
+		gzip.Finish();
+		bWritten = !gzip.Failed() && !file.Failed();
+	}
+	filesystem->Close(f);
+
+	if (!bWritten)
+	{
+		filesystem->RemoveFile(path.c_str(), "DEFAULT_WRITE_PATH");
+		return false;
+	}
+
+	WriteFingerprint(CFmtStr("%s.fingerprint", path.c_str()), fingerprint);
+	return true;
+}
+#endif
+
+void DumpWriter::WriteDumps(const ScriptModel &model, const std::vector<IScriptDumper *> &dumpers, const std::vector<VMType> &vms, const DumpWriteOptions_t &options)
+{
+	struct SaveJob_t
+	{
+		IScriptDumper *pDumper;
+		VMType v;
+		bool bValues;
+		DumpCompression_t compression;
+		uint64_t fingerprint;
+		std::string path;
+		// The file written under the other compression setting, removed so it can't be read as current.
+		std::string stalePath;
+		const char *pszMode;
+		bool bStreamed; // Written from the pool as it rendered, rather than from out
+		bool bWritten;
+		OutputBuffer out;
+	};
+
+	// Files whose fingerprint matches the one saved next to them would come out the same, so they are left alone.
+	std::vector<std::unique_ptr<SaveJob_t>> jobs;
+	size_t unchanged = 0;
+	for (auto v : vms)
+	{
+		// Hashing the values walks all of them, so it's done once for every file of the VM.
+		uint64_t fingerprints[2] = { model.GetFingerprint(v, false), model.GetFingerprint(v, true) };
+		for (auto d : dumpers)
+		{
+			DumpCompression_t fileCompression = d->IsBinaryOutput() ? Compression_None : options.compression;
+			for (int bValues = 0; bValues < (d->HasValuesFile() ? 2 : 1); ++bValues)
+			{
+				Fingerprint fp;
+				fp.AddValue(kDumpFormatVersion);
+				fp.AddString(d->GetOutputTypeName());
+				fp.AddValue(fileCompression);
+				fp.AddValue(fingerprints[bValues]);
+				// Values go into the functions file when there's no values file of its own.
+				if (!d->HasValuesFile())
+					fp.AddValue(fingerprints[1]);
+
+				std::string baseName(CFmtStr("%s%u.%s", bValues ? "values" : "out", (unsigned)v, d->GetOutputTypeName()));
+				std::string path = "vdump/" + baseName + CompressionSuffix(fileCompression);
+				uint64_t onDisk;
+				if (ReadFingerprint(CFmtStr("%s.fingerprint", path.c_str()), onDisk) && onDisk == fp.Get()
+					&& filesystem->FileExists(path.c_str(), "DEFAULT_WRITE_PATH"))
+				{
+					++unchanged;
+					continue;
+				}
+
+				SaveJob_t *pJob = new SaveJob_t;
+				pJob->pDumper = d;
+				pJob->v = v;
+				pJob->bValues = !!bValues;
+				pJob->compression = fileCompression;
+				pJob->fingerprint = fp.Get();
+				pJob->path = path;
+				if (!d->IsBinaryOutput())
+					pJob->stalePath = "vdump/" + baseName + CompressionSuffix(fileCompression == Compression_None ? Compression_Gzip : Compression_None);
+				pJob->pszMode = d->IsBinaryOutput() || fileCompression != Compression_None ? "wb" : "w";
+				pJob->bStreamed = false;
+				pJob->bWritten = false;
+				jobs.emplace_back(pJob);
+			}
+		}
+	}
+
+	if (unchanged)
+		DevMsg("D2V: Skipped %u unchanged dump files\n", (unsigned)unchanged);
+
+	// Render everything in memory across the pool, then write it out from this thread, in order.
+	// Compressed jobs instead stream through the compressor to their file as they render, from the
+	// pool, so they are never held in memory at all.
+	WorkerPool pool;
+	pool.ParallelFor(jobs.size(), [&jobs, &model, &pool](size_t i) {
+		SaveJob_t &job = *jobs[i];
+		auto save = [&job, &model, &pool](OutputBuffer &out) {
+			if (job.bValues)
+			{
+				D2V_STAT_SCOPE(Stat_DumperSaveValues, job.v);
+				job.pDumper->SaveValues(out, model, job.v, pool);
+			}
+			else
+			{
+				D2V_STAT_SCOPE(Stat_DumperSaveFunctions, job.v);
+				job.pDumper->SaveFunctions(out, model, job.v, pool);
+			}
+		};
+
+#ifdef D2V_ZLIB
+		if (job.compression == Compression_Gzip)
+		{
+			job.bStreamed = true;
+			job.bWritten = WriteCompressedDumpFile(job.path, job.pszMode, save, job.fingerprint);
+			return;
+		}
+#endif
+		save(job.out);
+	});
+
+	for (auto &job : jobs)
+	{
+		bool bWritten = job->bStreamed ? job->bWritten : WriteDumpFile(job->path, job->pszMode, job->out, job->fingerprint);
+		if (!bWritten)
+			Warning("D2V: Failed to write %s\n", job->path.c_str());
+
+		if (!job->stalePath.empty() && filesystem->FileExists(job->stalePath.c_str(), "DEFAULT_WRITE_PATH"))
+		{
+			filesystem->RemoveFile(job->stalePath.c_str(), "DEFAULT_WRITE_PATH");
+			filesystem->RemoveFile(CFmtStr("%s.fingerprint", job->stalePath.c_str()), "DEFAULT_WRITE_PATH");
+		}
+	}
+}
@@ -0,0 +1,78 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "compression.h"
+#include "iscriptdumper.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct DumpWriteOptions_t
+{
+	// Applied to text outputs as they render; binary ones are never compressed.
+	DumpCompression_t compression;
+};
+
+// A frozen copy of the model, taken on the game thread so the writer can render it without locking.
+// The dumpers hold no state and are owned by the plugin, which stops the writer before freeing them.
+struct DumpSnapshot_t
+{
+	std::unique_ptr<ScriptModel> pModel;
+	std::vector<IScriptDumper *> dumpers;
+	std::vector<VMType> vms;
+	DumpWriteOptions_t options;
+};
+
+// Renders and writes dump files on a background thread. Only the newest snapshot matters,
+// so a snapshot that is still waiting when another arrives is dropped.
+class DumpWriter
+{
+public:
+	~DumpWriter() { Stop(); }
+
+	void Start();
+	// Waits for a write in progress to finish and drops anything still queued.
+	void Stop();
+
+	void Submit(DumpSnapshot_t *pSnapshot);
+
+	// Renders every (VM, dumper) pair of the model across a worker pool and writes the files out.
+	static void WriteDumps(const ScriptModel &model, const std::vector<IScriptDumper *> &dumpers, const std::vector<VMType> &vms, const DumpWriteOptions_t &options);
+
+private:
+	void ThreadMain();
+
+private:
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_CV;
+	std::unique_ptr<DumpSnapshot_t> m_pPending;
+	bool m_bStop = false;
+};
@@ -0,0 +1,80 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "common.h"
+
+#include <cstring>
+
+// Incremental 64-bit hash (FNV-1a with a final mix) for fingerprinting captured data, so
+// unchanged output can be recognised without rendering it.
+class Fingerprint
+{
+public:
+	static const uint64_t kEmpty = 14695981039346656037ull;
+
+	explicit Fingerprint(uint64_t seed = kEmpty) : m_Hash(seed) {}
+
+	void Add(const void *p, size_t len)
+	{
+		const unsigned char *pBytes = (const unsigned char *)p;
+		for (size_t i = 0; i < len; ++i)
+		{
+			m_Hash ^= pBytes[i];
+			m_Hash *= 1099511628211ull;
+		}
+	}
+
+	// Includes the terminator, so consecutive strings can't run into each other. Null hashes differently from "".
+	void AddString(const char *psz)
+	{
+		if (psz)
+			Add(psz, strlen(psz) + 1);
+		else
+			AddValue(uint8_t(0xFF));
+	}
+
+	template <typename T>
+	void AddValue(const T &value) { Add(&value, sizeof(value)); }
+
+	// Well mixed, so results can also be summed to fingerprint unordered sets.
+	uint64_t Get() const
+	{
+		uint64_t h = m_Hash;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// Raw state, to carry on from later with Fingerprint(seed).
+	uint64_t State() const { return m_Hash; }
+
+private:
+	uint64_t m_Hash;
+};
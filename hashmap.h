@@ -0,0 +1,432 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "stringpool.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Open-addressing hash map keyed by string contents. Hashes are cached next to the slot,
+// so a probe only touches key memory on a likely match, and entries are kept densely in
+// insertion order.
+template <typename T>
+class StringHashMap
+{
+public:
+	struct Entry_t
+	{
+		StringId key;
+		uint32_t hash;
+		T value;
+	};
+
+	typedef typename std::vector<Entry_t>::iterator iterator;
+	typedef typename std::vector<Entry_t>::const_iterator const_iterator;
+
+public:
+	StringHashMap() : m_Slots(kInitialSlots) {}
+
+	T *Find(const char *pszKey)
+	{
+		size_t len = strlen(pszKey);
+		size_t slot = Probe(pszKey, len, HashString(pszKey, len));
+		return m_Slots[slot].entry ? &m_Entries[m_Slots[slot].entry - 1].value : nullptr;
+	}
+
+	// Returns the value for the key, default constructing it first if it was not present.
+	std::pair<T *, bool> Insert(const char *pszKey)
+	{
+		size_t len = strlen(pszKey);
+		uint32_t hash = HashString(pszKey, len);
+		size_t slot = Probe(pszKey, len, hash);
+		if (m_Slots[slot].entry)
+			return std::make_pair(&m_Entries[m_Slots[slot].entry - 1].value, false);
+
+		Entry_t entry;
+		entry.key = m_Keys.Add(pszKey, len);
+		entry.hash = hash;
+		entry.value = T();
+		m_Entries.push_back(std::move(entry));
+
+		m_Slots[slot].hash = hash;
+		m_Slots[slot].entry = uint32_t(m_Entries.size());
+
+		// Keep the load factor under 1/2.
+		if (m_Entries.size() * 2 > m_Slots.size())
+			Grow();
+
+		return std::make_pair(&m_Entries.back().value, true);
+	}
+
+	const char *KeyOf(const Entry_t &entry) const { return m_Keys.Get(entry.key); }
+
+	size_t Count() const { return m_Entries.size(); }
+	size_t MemoryUsage() const { return m_Slots.capacity() * sizeof(Slot_t) + m_Entries.capacity() * sizeof(Entry_t) + m_Keys.MemoryUsage(); }
+
+	void Clear()
+	{
+		m_Entries.clear();
+		m_Keys.Reset();
+		std::fill(m_Slots.begin(), m_Slots.end(), Slot_t());
+	}
+
+	iterator begin() { return m_Entries.begin(); }
+	iterator end() { return m_Entries.end(); }
+	const_iterator begin() const { return m_Entries.begin(); }
+	const_iterator end() const { return m_Entries.end(); }
+
+private:
+	struct Slot_t
+	{
+		Slot_t() : hash(0), entry(0) {}
+
+		uint32_t hash;
+		uint32_t entry; // Index into m_Entries plus one. Zero is an empty slot.
+	};
+
+	size_t Probe(const char *pszKey, size_t len, uint32_t hash) const
+	{
+		size_t mask = m_Slots.size() - 1;
+		size_t i = hash & mask;
+		for (; m_Slots[i].entry; i = (i + 1) & mask)
+		{
+			if (m_Slots[i].hash != hash)
+				continue;
+
+			const char *pszExisting = m_Keys.Get(m_Entries[m_Slots[i].entry - 1].key);
+			if (!strncmp(pszExisting, pszKey, len) && !pszExisting[len])
+				break;
+		}
+		return i;
+	}
+
+	void Grow()
+	{
+		std::vector<Slot_t> slots(m_Slots.size() * 2);
+		size_t mask = slots.size() - 1;
+		for (size_t e = 0; e < m_Entries.size(); ++e)
+		{
+			size_t i = m_Entries[e].hash & mask;
+			while (slots[i].entry)
+				i = (i + 1) & mask;
+
+			slots[i].hash = m_Entries[e].hash;
+			slots[i].entry = uint32_t(e + 1);
+		}
+		m_Slots.swap(slots);
+	}
+
+private:
+	static const size_t kInitialSlots = 64;
+
+	std::vector<Slot_t> m_Slots;
+	std::vector<Entry_t> m_Entries;
+	StringPool m_Keys;
+};
+
+// Open-addressing set of pointers, for identity checks that must be cheaper than any name lookup.
+class PointerHashSet
+{
+public:
+	PointerHashSet() : m_Slots(kInitialSlots, nullptr), m_Count(0) {}
+
+	// Returns true if the pointer was not already in the set.
+	bool Insert(const void *p)
+	{
+		size_t mask = m_Slots.size() - 1;
+		size_t i = Hash(p) & mask;
+		for (; m_Slots[i]; i = (i + 1) & mask)
+		{
+			if (m_Slots[i] == p)
+				return false;
+		}
+
+		m_Slots[i] = p;
+
+		// Keep the load factor under 1/2.
+		if (++m_Count * 2 > m_Slots.size())
+			Grow();
+
+		return true;
+	}
+
+	bool Contains(const void *p) const
+	{
+		size_t mask = m_Slots.size() - 1;
+		for (size_t i = Hash(p) & mask; m_Slots[i]; i = (i + 1) & mask)
+		{
+			if (m_Slots[i] == p)
+				return true;
+		}
+		return false;
+	}
+
+	void Clear()
+	{
+		std::fill(m_Slots.begin(), m_Slots.end(), nullptr);
+		m_Count = 0;
+	}
+
+private:
+	static size_t Hash(const void *p)
+	{
+		// Fibonacci hashing. Low bits of descriptor addresses are mostly alignment.
+		uint64_t x = uint64_t(uintptr_t(p)) * 0x9E3779B97F4A7C15ull;
+		return size_t(x >> 32);
+	}
+
+	void Grow()
+	{
+		std::vector<const void *> slots(m_Slots.size() * 2, nullptr);
+		size_t mask = slots.size() - 1;
+		for (auto p : m_Slots)
+		{
+			if (!p)
+				continue;
+
+			size_t i = Hash(p) & mask;
+			while (slots[i])
+				i = (i + 1) & mask;
+
+			slots[i] = p;
+		}
+		m_Slots.swap(slots);
+	}
+
+private:
+	static const size_t kInitialSlots = 256;
+
+	std::vector<const void *> m_Slots;
+	size_t m_Count;
+};
+
+// Open-addressing map from pointers to small values, with backward shift deletion so
+// removals leave no tombstones behind.
+template <typename T>
+class PointerHashMap
+{
+public:
+	PointerHashMap() : m_Slots(kInitialSlots), m_Count(0) {}
+
+	T *Find(const void *p)
+	{
+		size_t mask = m_Slots.size() - 1;
+		for (size_t i = Hash(p) & mask; m_Slots[i].key; i = (i + 1) & mask)
+		{
+			if (m_Slots[i].key == p)
+				return &m_Slots[i].value;
+		}
+		return nullptr;
+	}
+
+	void Set(const void *p, const T &value)
+	{
+		T *pExisting = Find(p);
+		if (pExisting)
+		{
+			*pExisting = value;
+			return;
+		}
+
+		if ((m_Count + 1) * 2 > m_Slots.size())
+			Grow();
+
+		size_t mask = m_Slots.size() - 1;
+		size_t i = Hash(p) & mask;
+		while (m_Slots[i].key)
+			i = (i + 1) & mask;
+
+		m_Slots[i].key = p;
+		m_Slots[i].value = value;
+		++m_Count;
+	}
+
+	void Remove(const void *p)
+	{
+		size_t mask = m_Slots.size() - 1;
+		size_t i = Hash(p) & mask;
+		for (; m_Slots[i].key != p; i = (i + 1) & mask)
+		{
+			if (!m_Slots[i].key)
+				return;
+		}
+
+		// Pull later members of the probe run back into the hole.
+		for (size_t j = (i + 1) & mask; m_Slots[j].key; j = (j + 1) & mask)
+		{
+			size_t home = Hash(m_Slots[j].key) & mask;
+			if (((j - home) & mask) >= ((j - i) & mask))
+			{
+				m_Slots[i] = m_Slots[j];
+				i = j;
+			}
+		}
+
+		m_Slots[i] = Slot_t();
+		--m_Count;
+	}
+
+	void Clear()
+	{
+		std::fill(m_Slots.begin(), m_Slots.end(), Slot_t());
+		m_Count = 0;
+	}
+
+	size_t Count() const { return m_Count; }
+	size_t MemoryUsage() const { return m_Slots.capacity() * sizeof(Slot_t); }
+
+private:
+	struct Slot_t
+	{
+		Slot_t() : key(nullptr), value() {}
+
+		const void *key;
+		T value;
+	};
+
+	static size_t Hash(const void *p)
+	{
+		uint64_t x = uint64_t(uintptr_t(p)) * 0x9E3779B97F4A7C15ull;
+		return size_t(x >> 32);
+	}
+
+	void Grow()
+	{
+		std::vector<Slot_t> slots(m_Slots.size() * 2);
+		size_t mask = slots.size() - 1;
+		for (auto &slot : m_Slots)
+		{
+			if (!slot.key)
+				continue;
+
+			size_t i = Hash(slot.key) & mask;
+			while (slots[i].key)
+				i = (i + 1) & mask;
+
+			slots[i] = slot;
+		}
+		m_Slots.swap(slots);
+	}
+
+private:
+	static const size_t kInitialSlots = 16;
+
+	std::vector<Slot_t> m_Slots;
+	size_t m_Count;
+};
+
+// Open-addressing map from 64-bit keys to small values, for keys made up of several ids.
+template <typename T>
+class IntegerHashMap
+{
+public:
+	IntegerHashMap() : m_Slots(kInitialSlots), m_Count(0) {}
+
+	T *Find(uint64_t key)
+	{
+		size_t mask = m_Slots.size() - 1;
+		for (size_t i = Hash(key) & mask; m_Slots[i].used; i = (i + 1) & mask)
+		{
+			if (m_Slots[i].key == key)
+				return &m_Slots[i].value;
+		}
+		return nullptr;
+	}
+
+	// Returns the value for the key, default constructing it first if it was not present.
+	std::pair<T *, bool> Insert(uint64_t key)
+	{
+		T *pExisting = Find(key);
+		if (pExisting)
+			return std::make_pair(pExisting, false);
+
+		if ((m_Count + 1) * 2 > m_Slots.size())
+			Grow();
+
+		size_t mask = m_Slots.size() - 1;
+		size_t i = Hash(key) & mask;
+		while (m_Slots[i].used)
+			i = (i + 1) & mask;
+
+		m_Slots[i].key = key;
+		m_Slots[i].value = T();
+		m_Slots[i].used = true;
+		++m_Count;
+
+		return std::make_pair(&m_Slots[i].value, true);
+	}
+
+	size_t Count() const { return m_Count; }
+	size_t MemoryUsage() const { return m_Slots.capacity() * sizeof(Slot_t); }
+
+	void Clear()
+	{
+		std::fill(m_Slots.begin(), m_Slots.end(), Slot_t());
+		m_Count = 0;
+	}
+
+private:
+	struct Slot_t
+	{
+		Slot_t() : key(0), value(), used(false) {}
+
+		uint64_t key;
+		T value;
+		bool used;
+	};
+
+	static size_t Hash(uint64_t key)
+	{
+		uint64_t x = key * 0x9E3779B97F4A7C15ull;
+		return size_t(x >> 32);
+	}
+
+	void Grow()
+	{
+		std::vector<Slot_t> slots(m_Slots.size() * 2);
+		size_t mask = slots.size() - 1;
+		for (auto &slot : m_Slots)
+		{
+			if (!slot.used)
+				continue;
+
+			size_t i = Hash(slot.key) & mask;
+			while (slots[i].used)
+				i = (i + 1) & mask;
+
+			slots[i] = slot;
+		}
+		m_Slots.swap(slots);
+	}
+
+private:
+	static const size_t kInitialSlots = 64;
+
+	std::vector<Slot_t> m_Slots;
+	size_t m_Count;
+};
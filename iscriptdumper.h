@@ -26,22 +26,35 @@
 #pragma once
 
 #include "common.h"
+#include "outputbuffer.h"
+#include "scriptmodel.h"
 #include <filesystem.h>
 
-#undef strdup
-#include <vscript/ivscript.h>
+class WorkerPool;
 
+// Renders a ScriptModel in one output format. Dumpers keep no capture state of their own, so adding
+// a format adds nothing to the hooks. Save methods may be called concurrently for different VMs
+// and models, and may use the pool for their own work.
 class IScriptDumper
 {
 public:
-	virtual void Clear(VMType v) = 0;
+	virtual ~IScriptDumper() {}
 	virtual const char *GetOutputTypeName() const = 0;
-	virtual void AddClass(ScriptClassDesc_t &classDesc, VMType v) = 0;
-	virtual void AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v) = 0;
-	virtual void SaveFunctionsToDisk(FileHandle_t f, VMType v) = 0;
-	virtual void AddValue(const char *pszName, const ScriptVariant_t &value, VMType v) = 0;
-	virtual void AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v) = 0;
-	virtual void SaveValuesToDisk(FileHandle_t f, VMType v) = 0;
+	// Dumpers that write everything from SaveFunctions have no separate values file.
+	virtual bool HasValuesFile() const { return true; }
+	virtual bool IsBinaryOutput() const { return false; }
+	virtual void SaveFunctions(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &pool) const = 0;
+	virtual void SaveValues(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &pool) const = 0;
+
+protected:
+	typedef ScriptModel::VMCapture_t VMCapture_t;
+	typedef ScriptModel::ScriptClass_t ScriptClass_t;
+	typedef ScriptModel::ScriptFunction_t ScriptFunction_t;
+	typedef ScriptModel::ScriptValueData_t ScriptValueData_t;
+	typedef ScriptModel::ConstantTable_t ConstantTable_t;
+	typedef ScriptModel::RowRange_t RowRange_t;
+	typedef ScriptModel::ScriptEnum_t ScriptEnum_t;
+	typedef ScriptModel::ValueHistory_t ValueHistory_t;
 };
 
 // Not using ScriptFieldTypeName because we have some custom type names
@@ -0,0 +1,84 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "binaryformat.h"
+
+#include <cstdint>
+
+// Layout of the capture journal (vdump/journal.bin), which D2VDump appends everything it captures
+// to when started with -vdump_journal. Like binaryformat.h, this has no SDK dependencies.
+//
+// The file is a VDJHeader_t followed by records back to back, each a VDJRecord_t and then `size`
+// bytes of payload. Records are only ever appended, so a session that died mid-write leaves at
+// most its last record cut short, and readers stop there.
+//
+// Payloads are sequences of fields. Integers are little endian uint32. A string is its length in
+// bytes followed by that many bytes, or just kVDBNoString if it was never set. A value is a
+// VDBValueKind_t followed by a string for VDBValue_String, or else the 12 bytes of VDBConstant_t's
+// value union. A function is its name, description, return type name, VDBFunction_t flags and
+// param count, then each param's type name and name.
+//
+//   VDJRecord_ClearVM, VDJRecord_DestroyVM: empty.
+//   VDJRecord_Class: name, description, base, function count, then that many functions.
+//   VDJRecord_Function: a global function.
+//   VDJRecord_Value: scope, name, value, and for a VDBValue_Handle the table's handle. Handles are
+//     uint64, 0 for the root table (or for no table), and only compared for equality. A value for a
+//     scope and name seen before replaces the earlier one. A table set as a value becomes a child
+//     of the scope it was set in, unless it already has a parent or that would make a cycle.
+//   VDJRecord_EnumValue: enum name, name, description, value.
+//
+// Replaying the records in order, the same way D2VDump treats the events they stand for, gives
+// back what it would have dumped.
+
+static const uint32_t kVDJMagic = 0x314A4456; // "VDJ1"
+static const uint32_t kVDJVersion = 3;
+
+struct VDJHeader_t
+{
+	uint32_t magic;
+	uint32_t version;
+};
+
+enum VDJRecordKind_t : uint8_t
+{
+	VDJRecord_ClearVM = 1, // The VM was (re)created; its globals and enums start over
+	VDJRecord_DestroyVM,
+	VDJRecord_Class,
+	VDJRecord_Function,
+	VDJRecord_Value,
+	VDJRecord_EnumValue,
+};
+
+struct VDJRecord_t
+{
+	uint32_t size; // Of the payload that follows
+	uint8_t kind;  // VDJRecordKind_t
+	uint8_t reserved;
+	uint16_t vm;   // VMType
+};
+
+static_assert(sizeof(VDJRecord_t) == 8, "VDJRecord_t layout changed");
@@ -24,222 +24,265 @@
 */
 
 #include "jsondumper.h"
+#include "jsonwriter.h"
+#include "workerpool.h"
 #include <tier1/fmtstr.h>
 
-JSONScriptDumper::JSONScriptDumper()
+#include <algorithm>
+#include <cstring>
+
+void JSONScriptDumper::WriteFunction(JSONStreamWriter &writer, const VMCapture_t &vm, const ScriptFunction_t &func)
 {
-	for (size_t i = 0; i < VM_Count; ++i)
+	writer.BeginObject();
+
+	if (func.hasParamNames)
 	{
-		m_Json[i] = json_object();
-		m_GlobalFuncs[i] = json_object();
+		writer.Key("arg_names");
+		writer.BeginArray();
+		for (size_t i = 0; i < func.paramCount; ++i)
+			writer.String(vm.strings.Get(vm.paramNames[func.firstParam + i]));
+		writer.EndArray();
 	}
-}
 
-JSONScriptDumper::~JSONScriptDumper()
-{
-	for (size_t i = 0; i < VM_Count; ++i)
+	writer.Key("args");
+	writer.BeginArray();
+	for (size_t i = 0; i < func.paramCount; ++i)
+		writer.String(NameForType(vm.params[func.firstParam + i]));
+	writer.EndArray();
+
+	if (func.desc != kEmptyString)
 	{
-		json_decref(m_Json[i]);
+		writer.Key("description");
+		writer.String(vm.strings.Get(func.desc));
 	}
-}
 
-void JSONScriptDumper::Clear(VMType v)
-{
-	// Only need to clear out globals and enums. Class defs are already protected against dupes.
-	m_GlobalConstants[v].clear();
-	m_Enums[v].clear();
+	writer.Key("return");
+	writer.String(NameForType(func.returnType));
+
+	writer.EndObject();
 }
 
-void JSONScriptDumper::SaveFunctionsToDisk(FileHandle_t f, VMType v)
+void JSONScriptDumper::WriteFunctions(JSONStreamWriter &writer, const VMCapture_t &vm, const ScriptFunction_t *pFuncs, size_t count)
 {
-	auto *pGlobal = json_object();
-
-	json_object_set_new(pGlobal, "functions", m_GlobalFuncs[v]);
-
-	json_object_set_new(m_Json[v], "Global", pGlobal);
-
-	json_dump_callback(m_Json[v],
-		[](const char *buffer, size_t size, void *data) -> int {
-			filesystem->Write(buffer, size, (FileHandle_t)data);
-			return 0;
-		},
-		f, JSON_INDENT(4) | JSON_SORT_KEYS);
+	writer.BeginObject();
+	for (auto *i : ScriptModel::SortByName(pFuncs, count, vm.strings))
+	{
+		writer.Key(vm.strings.Get(i->name));
+		WriteFunction(writer, vm, *i);
+	}
+	writer.EndObject();
 }
 
-inline json_t *VariantToJSON(const ScriptVariant_t &value)
+void JSONScriptDumper::WriteClass(JSONStreamWriter &writer, const VMCapture_t &vm, const ScriptClass_t &scriptClass)
 {
-	switch (value.m_type)
+	writer.BeginObject();
+	if (scriptClass.hasDesc)
 	{
-	case FIELD_CSTRING:
-		return json_string(value.m_pszString);
-	case FIELD_INTEGER:
-		return json_integer(value.m_int);
-	case FIELD_FLOAT:
-		return json_real(value.m_float);
-	case FIELD_HSCRIPT:
-		return json_string("<handle>");
-	case FIELD_UINT:
-		return json_integer(value.m_uint);
-	case FIELD_VECTOR:
-	{
-		auto *pValues = json_array();
-		json_array_append_new(pValues, json_real(value.m_pVector->x));
-		json_array_append_new(pValues, json_real(value.m_pVector->y));
-		json_array_append_new(pValues, json_real(value.m_pVector->z));
-		return pValues;
+		writer.Key("description");
+		writer.String(vm.strings.Get(scriptClass.desc));
 	}
+	if (scriptClass.hasBase)
+	{
+		writer.Key("extends");
+		writer.String(vm.strings.Get(scriptClass.base));
 	}
-
-	return json_string(CFmtStr("<unhandled_variant_type_%d>", value.m_type));
+	writer.Key("functions");
+	WriteFunctions(writer, vm, &vm.classFuncs[scriptClass.firstFunc], scriptClass.funcCount);
+	writer.EndObject();
 }
 
-void JSONScriptDumper::SaveValuesToDisk(FileHandle_t f, VMType v)
+void JSONScriptDumper::SaveFunctions(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &pool) const
 {
-	auto *pJson = json_object();
+	static const char szGlobal[] = "Global";
+	static const size_t kMinClassesPerShard = 64;
 
-	auto *pLooseGlobals = json_array();
-	for (auto &i : m_GlobalConstants[v])
-	{
-		auto *j = json_object();
-		json_object_set_new(j, "key", json_string(i.name.c_str()));
-		json_object_set_new(j, "value", VariantToJSON(i.value));
-		if (i.desc.length())
-			json_object_set_new(j, "description", json_string(i.desc.c_str()));
+	const VMCapture_t &vm = model.FindVM(v);
 
-		json_array_append_new(pLooseGlobals, j);
-	}
-	json_object_set_new(pJson, "_Unscoped", pLooseGlobals);
+	// Top level members in output order. Null stands for the global function table, which replaces any class of the same name.
+	std::vector<const ScriptClass_t *> members;
+	members.reserve(vm.classDefs.size() + 1);
 
-	for (auto &i : m_Enums[v])
+	bool bPlacedGlobal = false;
+	for (auto *i : ScriptModel::SortByName(vm.classDefs.data(), vm.classDefs.size(), vm.strings))
 	{
-		auto *pEnum = json_array();
-		
-		for (auto &j : i.second)
+		int cmp = strcmp(vm.strings.Get(i->name), szGlobal);
+		if (!bPlacedGlobal && cmp >= 0)
 		{
-			auto *pEnumValue = json_object();
-			json_object_set_new(pEnumValue, "key", json_string(j.name.c_str()));
-			json_object_set_new(pEnumValue, "value", VariantToJSON(j.value));
-			if (j.desc.length()	)
-				json_object_set_new(pEnumValue, "description", json_string(j.desc.c_str()));
-
-			json_array_append_new(pEnum, pEnumValue);
+			members.push_back(nullptr);
+			bPlacedGlobal = true;
 		}
 
-		json_object_set_new(pJson, i.first, pEnum);
+		if (cmp != 0)
+			members.push_back(i);
 	}
 
-	json_dump_callback(pJson,
-		[](const char *buffer, size_t size, void *data) -> int {
-			filesystem->Write(buffer, size, (FileHandle_t)data);
-			return 0;
-		},
-		f, JSON_INDENT(4) | JSON_SORT_KEYS);
-
-	json_decref(pJson);
-}
-
-json_t *JSONScriptDumper::FuncDescToJSON(ScriptFuncDescriptor_t &scriptFunc)
-{
-	auto *pFunc = json_object();
-
-	if (scriptFunc.m_pszDescription && scriptFunc.m_pszDescription[0])
+	if (!bPlacedGlobal)
 	{
-		json_object_set_new(pFunc, "description", json_string(scriptFunc.m_pszDescription));
+		members.push_back(nullptr);
 	}
 
-	json_object_set_new(pFunc, "return", json_string(NameForType(scriptFunc.m_ReturnType)));
-
-	auto *pArgs = json_array();
-	for (size_t i = 0; i < scriptFunc.m_iParamCount; ++i)
-	{
-		json_array_append_new(pArgs, json_string(NameForType(scriptFunc.m_Parameters[i])));
-	}
-	json_object_set_new(pFunc, "args", pArgs);
-
-	if (scriptFunc.m_pszParameterNames)
-	{
-		auto *pArgNames = json_array();
-		size_t iParamNameStart = 0;
-		for (size_t i = 0; i < scriptFunc.m_iParamCount; ++i)
+	auto writeMembers = [&](JSONStreamWriter &writer, size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i)
 		{
-			static char szParamName[64];
-			if (scriptFunc.m_pszParameterNames)
+			if (members[i])
 			{
-				iParamNameStart += (1 + Q_snprintf(szParamName, sizeof(szParamName), "%s", &scriptFunc.m_pszParameterNames[iParamNameStart]));
+				writer.Key(vm.strings.Get(members[i]->name));
+				WriteClass(writer, vm, *members[i]);
 			}
 			else
 			{
-				szParamName[0] = 0;
+				writer.Key(szGlobal);
+				writer.BeginObject();
+				writer.Key("functions");
+				WriteFunctions(writer, vm, vm.globalFuncs.data(), vm.globalFuncs.size());
+				writer.EndObject();
 			}
-			json_array_append_new(pArgNames, json_string(szParamName));
 		}
-		json_object_set_new(pFunc, "arg_names", pArgNames);
+	};
+
+	// A streaming destination (e.g. a compressor) only ever holds a chunk, so render straight into it
+	// instead of building the whole text up in shards.
+	if (out.IsStreaming())
+	{
+		JSONStreamWriter writer(out);
+		writer.BeginObject();
+		writeMembers(writer, 0, members.size());
+		writer.EndObject();
+		return;
 	}
 
-	return pFunc;
-}
+	// Classes render independently, so split them into contiguous shards across the pool and splice them back in order.
+	size_t shardCount = std::min(pool.ThreadCount() * 2, (members.size() + kMinClassesPerShard - 1) / kMinClassesPerShard);
+	std::vector<OutputBuffer> shards(shardCount);
 
-void JSONScriptDumper::AddClass(ScriptClassDesc_t &classDesc, VMType v)
-{
-	if (m_Classes[v].find(classDesc.m_pszScriptName) != m_Classes[v].end())
-		return;
+	pool.ParallelFor(shardCount, [&](size_t shard) {
+		size_t first = members.size() * shard / shardCount;
+		size_t last = members.size() * (shard + 1) / shardCount;
 
-	if (classDesc.m_pBaseDesc)
-	{
-		AddClass(*classDesc.m_pBaseDesc, v);
-	}
+		JSONStreamWriter writer(shards[shard]);
+		writer.BeginFragment(1, first > 0);
+		writeMembers(writer, first, last);
+	});
 
-	auto *pClass = json_object();
-	if (classDesc.m_pBaseDesc)
+	JSONStreamWriter writer(out);
+	writer.BeginObject();
+	for (size_t shard = 0; shard < shardCount; ++shard)
 	{
-		json_object_set_new(pClass, "extends", json_string(classDesc.m_pBaseDesc->m_pszScriptName));
+		size_t first = members.size() * shard / shardCount;
+		size_t last = members.size() * (shard + 1) / shardCount;
+		writer.Fragment(shards[shard], last - first);
 	}
-	if (classDesc.m_pszDescription)
+	writer.EndObject();
+}
+
+void JSONScriptDumper::WriteValue(JSONStreamWriter &writer, const VMCapture_t &vm, int16_t type, const ScriptValueData_t &value)
+{
+	switch (type)
 	{
-		json_object_set_new(pClass, "description", json_string(classDesc.m_pszDescription));
+	case FIELD_CSTRING:
+		writer.String(vm.valueStrings.Get(value.s));
+		return;
+	case FIELD_INTEGER:
+		writer.Integer(value.i);
+		return;
+	case FIELD_FLOAT:
+		writer.Real(value.f);
+		return;
+	case FIELD_HSCRIPT:
+		writer.String("<handle>");
+		return;
+	case FIELD_UINT:
+		writer.Integer(value.u);
+		return;
+	case FIELD_VECTOR:
+		writer.BeginArray();
+		writer.Real(value.vec[0]);
+		writer.Real(value.vec[1]);
+		writer.Real(value.vec[2]);
+		writer.EndArray();
+		return;
 	}
 
-	auto *pFuncs = json_object();
+	writer.String(CFmtStr("<unhandled_variant_type_%d>", type));
+}
 
-	FOR_EACH_VEC(classDesc.m_FunctionBindings, i)
+void JSONScriptDumper::WriteConstants(JSONStreamWriter &writer, const VMCapture_t &vm, const ConstantTable_t &table, const RowRange_t *pRanges, size_t rangeCount, const std::vector<uint32_t> *pHistory, const std::vector<std::string> *pScopePaths)
+{
+	writer.BeginArray();
+	for (size_t r = 0; r < rangeCount; ++r)
 	{
-		json_object_set_new(pFuncs, classDesc.m_FunctionBindings[i].m_desc.m_pszScriptName, FuncDescToJSON(classDesc.m_FunctionBindings[i].m_desc));
+		for (uint32_t i = pRanges[r].first, end = pRanges[r].first + pRanges[r].count; i < end; ++i)
+		{
+			writer.BeginObject();
+			if (table.descs[i] != kEmptyString)
+			{
+				writer.Key("description");
+				writer.String(vm.valueStrings.Get(table.descs[i]));
+			}
+			if (pHistory && (*pHistory)[i])
+			{
+				// Values it had before, oldest first.
+				const ValueHistory_t &history = vm.histories[(*pHistory)[i] - 1];
+				writer.Key("history");
+				writer.BeginArray();
+				for (uint32_t h = 0; h < history.Count(); ++h)
+					WriteValue(writer, vm, history.types[history.Slot(h)], history.values[history.Slot(h)]);
+				writer.EndArray();
+			}
+			writer.Key("key");
+			writer.String(vm.valueStrings.Get(table.names[i]));
+			if (pScopePaths && vm.globalScopes[i] != ScriptModel::kRootScope)
+			{
+				writer.Key("scope");
+				writer.String((*pScopePaths)[vm.globalScopes[i]].c_str());
+			}
+			writer.Key("value");
+			WriteValue(writer, vm, table.types[i], table.values[i]);
+			writer.EndObject();
+		}
 	}
+	writer.EndArray();
+}
 
-	json_object_set_new(pClass, "functions", pFuncs);
+void JSONScriptDumper::SaveValues(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &) const
+{
+	static const char szUnscoped[] = "_Unscoped";
 
-	json_object_set_new(m_Json[v], classDesc.m_pszScriptName, pClass);
+	const VMCapture_t &vm = model.FindVM(v);
 
-	m_Classes[v].insert(classDesc.m_pszScriptName);
-}
+	RowRange_t globals = { 0, vm.globalConstants.Count() };
+	std::vector<std::string> scopePaths;
+	ScriptModel::ScopePaths(vm, scopePaths);
 
-void JSONScriptDumper::AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v)
-{
-	if (m_Funcs[v].find(funcDesc.m_pszScriptName) != m_Funcs[v].end())
-		return;
+	JSONStreamWriter writer(out);
+	writer.BeginObject();
 
-	json_object_set_new(m_GlobalFuncs[v], funcDesc.m_pszScriptName, FuncDescToJSON(funcDesc));
-	m_Funcs[v].insert(funcDesc.m_pszScriptName);
-}
+	bool bWroteUnscoped = false;
+	for (auto *i : ScriptModel::SortByName(vm.enums.data(), vm.enums.size(), vm.valueStrings))
+	{
+		const char *pszEnumName = vm.valueStrings.Get(i->name);
+		int cmp = strcmp(pszEnumName, szUnscoped);
+		if (!bWroteUnscoped && cmp > 0)
+		{
+			writer.Key(szUnscoped);
+			WriteConstants(writer, vm, vm.globalConstants, &globals, 1, &vm.globalHistory, &scopePaths);
+			bWroteUnscoped = true;
+		}
+		else if (cmp == 0)
+		{
+			bWroteUnscoped = true;
+		}
 
-void JSONScriptDumper::AddValue(const char *pszName, const ScriptVariant_t &value, VMType v)
-{
-	ScriptConstant_t sc;
-	sc.name = pszName;
-	sc.desc = "";
-	sc.value = value;
+		writer.Key(pszEnumName);
+		WriteConstants(writer, vm, vm.enumValues, i->rows.data(), i->rows.size(), nullptr, nullptr);
+	}
 
-	m_GlobalConstants[v].push_back(sc);
-}
+	if (!bWroteUnscoped)
+	{
+		writer.Key(szUnscoped);
+		WriteConstants(writer, vm, vm.globalConstants, &globals, 1, &vm.globalHistory, &scopePaths);
+	}
 
-void JSONScriptDumper::AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v)
-{
-	ScriptConstant_t sc;
-	sc.name = pszName;
-	if (pszDesc)
-		sc.desc = pszDesc;
-	else
-		sc.desc = "";
-	sc.value = ScriptVariant_t(value);
-	m_Enums[v][pszEnumName].push_back(sc);
+	writer.EndObject();
 }
+
@@ -26,55 +26,21 @@
 #pragma once
 
 #include "iscriptdumper.h"
-#include <jansson.h>
 
-#include <map>
-#include <set>
-#include <string>
-#include <vector>
+class JSONStreamWriter;
 
 class JSONScriptDumper : public IScriptDumper
 {
-public:
-	JSONScriptDumper();
-	~JSONScriptDumper();
 public: // IScriptDumper
-	void Clear(VMType v) override;
 	const char *GetOutputTypeName() const override { return "json"; }
-	void AddClass(ScriptClassDesc_t &classDesc, VMType v) override;
-	void AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v) override;
-	void SaveFunctionsToDisk(FileHandle_t f, VMType v) override;
-	void AddValue(const char *pszName, const ScriptVariant_t &value, VMType v) override;
-	void AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v) override;
-	void SaveValuesToDisk(FileHandle_t f, VMType v) override;
-private:
-	json_t *FuncDescToJSON(ScriptFuncDescriptor_t &scriptFunc);
-private:
-	json_t *m_Json[VM_Count];
-	json_t *m_GlobalFuncs[VM_Count];
-
-	typedef std::set<const char *> StringSet_t;
-	StringSet_t m_Classes[VM_Count];
-	StringSet_t m_Funcs[VM_Count];
-
-	struct ScriptConstant_t
-	{
-		std::string name;
-		std::string desc;
-		ScriptVariant_t value;
+	void SaveFunctions(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &pool) const override;
+	void SaveValues(OutputBuffer &out, const ScriptModel &model, VMType v, WorkerPool &pool) const override;
 
-		~ScriptConstant_t()
-		{
-			if (value.m_flags & SV_FREE)
-			{
-				//free((void *)value.m_pszString);				
-			}
-		}
-	};
-
-	typedef std::vector<ScriptConstant_t> ScriptConstantList_t;
-	typedef std::map<const char *, ScriptConstantList_t> ScriptEnumList_t;
-
-	ScriptEnumList_t m_Enums[VM_Count];
-	ScriptConstantList_t m_GlobalConstants[VM_Count];
+private:
+	static void WriteFunctions(JSONStreamWriter &writer, const VMCapture_t &vm, const ScriptFunction_t *pFuncs, size_t count);
+	static void WriteFunction(JSONStreamWriter &writer, const VMCapture_t &vm, const ScriptFunction_t &func);
+	static void WriteValue(JSONStreamWriter &writer, const VMCapture_t &vm, int16_t type, const ScriptValueData_t &value);
+	// pHistory is VMCapture_t::globalHistory when writing globals, null otherwise.
+	static void WriteConstants(JSONStreamWriter &writer, const VMCapture_t &vm, const ConstantTable_t &table, const RowRange_t *pRanges, size_t rangeCount, const std::vector<uint32_t> *pHistory, const std::vector<std::string> *pScopePaths);
+	static void WriteClass(JSONStreamWriter &writer, const VMCapture_t &vm, const ScriptClass_t &scriptClass);
 };
@@ -0,0 +1,201 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "jsonwriter.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+JSONStreamWriter::JSONStreamWriter(OutputBuffer &out)
+	: m_Out(out)
+{
+	m_Count[0] = 0;
+}
+
+void JSONStreamWriter::BeginFragment(int depth, bool bHasPrecedingMembers)
+{
+	m_Depth = depth;
+	m_Count[depth] = bHasPrecedingMembers ? 1 : 0;
+}
+
+void JSONStreamWriter::Fragment(const OutputBuffer &fragment, size_t memberCount)
+{
+	m_Out.Append(fragment);
+	m_Count[m_Depth] += uint32_t(memberCount);
+}
+
+void JSONStreamWriter::Indent(int depth)
+{
+	static const char szSpaces[] = "                                ";
+
+	m_Out.WriteChar('\n');
+	for (size_t n = size_t(depth) * kIndent; n > 0;)
+	{
+		size_t chunk = n < sizeof(szSpaces) - 1 ? n : sizeof(szSpaces) - 1;
+		m_Out.Write(szSpaces, chunk);
+		n -= chunk;
+	}
+}
+
+// Emits the separator preceding a value in the current container, unless the value follows a key.
+void JSONStreamWriter::BeginValue()
+{
+	if (m_bAfterKey)
+	{
+		m_bAfterKey = false;
+		return;
+	}
+
+	if (m_Depth > 0)
+	{
+		if (m_Count[m_Depth]++)
+			m_Out.WriteChar(',');
+		Indent(m_Depth);
+	}
+}
+
+void JSONStreamWriter::BeginObject()
+{
+	BeginValue();
+	m_Out.WriteChar('{');
+	m_Count[++m_Depth] = 0;
+}
+
+void JSONStreamWriter::EndObject()
+{
+	if (m_Count[m_Depth--])
+		Indent(m_Depth);
+	m_Out.WriteChar('}');
+}
+
+void JSONStreamWriter::BeginArray()
+{
+	BeginValue();
+	m_Out.WriteChar('[');
+	m_Count[++m_Depth] = 0;
+}
+
+void JSONStreamWriter::EndArray()
+{
+	if (m_Count[m_Depth--])
+		Indent(m_Depth);
+	m_Out.WriteChar(']');
+}
+
+void JSONStreamWriter::Key(const char *pszKey)
+{
+	BeginValue();
+	WriteEscaped(m_Out, pszKey);
+	m_Out.Write(": ", 2);
+	m_bAfterKey = true;
+}
+
+void JSONStreamWriter::String(const char *pszValue)
+{
+	BeginValue();
+	WriteEscaped(m_Out, pszValue);
+}
+
+void JSONStreamWriter::Integer(int64_t value)
+{
+	BeginValue();
+
+	char szValue[32];
+	int len = snprintf(szValue, sizeof(szValue), "%" PRId64, value);
+	m_Out.Write(szValue, len);
+}
+
+// Mirrors jansson's jsonp_dtostr: "%.17g", forced ".0" for integral values, and a trimmed exponent.
+void JSONStreamWriter::Real(double value)
+{
+	BeginValue();
+
+	char szValue[64];
+	int len = snprintf(szValue, sizeof(szValue), "%.17g", value);
+
+	if (!strchr(szValue, '.') && !strchr(szValue, 'e'))
+	{
+		szValue[len++] = '.';
+		szValue[len++] = '0';
+		szValue[len] = 0;
+	}
+
+	char *pStart = strchr(szValue, 'e');
+	if (pStart)
+	{
+		++pStart;
+		char *pEnd = pStart + 1;
+		if (*pStart == '-')
+			++pStart;
+		while (*pEnd == '0')
+			++pEnd;
+		if (pEnd != pStart)
+		{
+			memmove(pStart, pEnd, len - (pEnd - szValue) + 1);
+			len -= int(pEnd - pStart);
+		}
+	}
+
+	m_Out.Write(szValue, len);
+}
+
+void JSONStreamWriter::WriteEscaped(OutputBuffer &out, const char *psz)
+{
+	out.WriteChar('"');
+
+	const char *pRun = psz;
+	const char *p = psz;
+	for (; *p; ++p)
+	{
+		unsigned char c = (unsigned char)*p;
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		out.Write(pRun, p - pRun);
+		pRun = p + 1;
+
+		switch (c)
+		{
+		case '\\': out.Write("\\\\", 2); break;
+		case '"': out.Write("\\\"", 2); break;
+		case '\b': out.Write("\\b", 2); break;
+		case '\f': out.Write("\\f", 2); break;
+		case '\n': out.Write("\\n", 2); break;
+		case '\r': out.Write("\\r", 2); break;
+		case '\t': out.Write("\\t", 2); break;
+		default:
+		{
+			char szSeq[8];
+			snprintf(szSeq, sizeof(szSeq), "\\u%04X", c);
+			out.Write(szSeq, 6);
+			break;
+		}
+		}
+	}
+
+	out.Write(pRun, p - pRun);
+	out.WriteChar('"');
+}
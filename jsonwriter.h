@@ -0,0 +1,71 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "outputbuffer.h"
+
+#include <cstdint>
+
+// Writes JSON straight into an OutputBuffer, formatted exactly as jansson's
+// json_dump_callback with JSON_INDENT(4). Keys are written in the order given,
+// so callers are responsible for sorting them.
+class JSONStreamWriter
+{
+public:
+	JSONStreamWriter(OutputBuffer &out);
+
+	void BeginObject();
+	void EndObject();
+	void BeginArray();
+	void EndArray();
+
+	void Key(const char *pszKey);
+	void String(const char *pszValue);
+	void Integer(int64_t value);
+	void Real(double value);
+
+	// For rendering part of a container's members separately, e.g. on another thread.
+	// Starts this writer as though already inside a container at the given depth.
+	void BeginFragment(int depth, bool bHasPrecedingMembers);
+	// Splices in a fragment rendered by another writer as members of the current container.
+	void Fragment(const OutputBuffer &fragment, size_t memberCount);
+
+	// Writes a quoted string, escaped exactly as jansson escapes it.
+	static void WriteEscaped(OutputBuffer &out, const char *psz);
+
+private:
+	void BeginValue();
+	void Indent(int depth);
+
+private:
+	static const int kIndent = 4;
+	static const int kMaxDepth = 32;
+
+	OutputBuffer &m_Out;
+	int m_Depth = 0;
+	bool m_bAfterKey = false;
+	uint32_t m_Count[kMaxDepth];
+};
@@ -0,0 +1,289 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "log.h"
+
+#if D2V_LOG
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef _MSC_VER
+#define D2V_THREAD_LOCAL __declspec(thread)
+#else
+#define D2V_THREAD_LOCAL __thread
+#endif
+
+// Every format takes its arguments in this order, using as many as it needs: p, a, b, i.
+static const char *s_LogFormats[Log_Count] = {
+	"SV1: (HSCRIPT: %p) (Name: \"%s\")\n",
+	"SV2: (HSCRIPT: %p) (Name: \"%s\")\n",
+	"SV3: (HSCRIPT: %p) (Index: \"%s\")\n",
+	"SEV: (HSCRIPT: %p) (Enum: \"%s\") (Name: \"%s\") (Value: %d)\n",
+};
+
+struct LogEntry_t
+{
+	static const size_t kTextSize = 112;
+
+	LogFormat_t format;
+	uint8_t lenA; // Bytes of text used by a, including its null
+	int32_t i;
+	const void *p;
+	char text[kTextSize]; // a and b, each null terminated, cut short if they don't fit
+};
+
+// Single producer (the owning thread), single consumer (the log thread).
+struct ThreadLog_t
+{
+	static const uint32_t kCapacity = 1024; // Power of two
+
+	ThreadLog_t() : entries(new LogEntry_t[kCapacity]), head(0), tail(0), dropped(0), pNext(nullptr) {}
+
+	std::unique_ptr<LogEntry_t[]> entries;
+	std::atomic<uint32_t> head; // Next slot to write. Only the producer stores it.
+	char pad[64];
+	std::atomic<uint32_t> tail; // Next slot to format. Only the log thread stores it.
+	std::atomic<uint32_t> dropped;
+	ThreadLog_t *pNext;
+};
+
+std::atomic<int> g_LogLevel(LogLevel_Off);
+
+static std::mutex s_Mutex; // Guards the thread list and producers on the shared ring
+static ThreadLog_t *s_pThreads = nullptr;
+static ThreadLog_t s_Shared;
+static D2V_THREAD_LOCAL ThreadLog_t *t_pLog = nullptr;
+// Bumped when LogStop frees the rings, so a thread's t_pLog from before then is known to be stale.
+static std::atomic<uint32_t> s_Generation(0);
+static D2V_THREAD_LOCAL uint32_t t_Generation = 0;
+
+static std::thread s_Thread;
+static std::mutex s_WakeMutex; // Never taken while holding s_Mutex
+static std::condition_variable s_WakeCV;
+static std::atomic<bool> s_bWaiting(false);
+static bool s_bStop = false;
+static void (*s_pfnLine)(const char *pszLine) = nullptr;
+
+static size_t CopyString(char *pDest, size_t space, const char *psz)
+{
+	if (!space)
+		return 0;
+
+	size_t len = psz ? strlen(psz) : 0;
+	if (len >= space)
+		len = space - 1;
+
+	memcpy(pDest, psz ? psz : "", len);
+	pDest[len] = '\0';
+	return len + 1;
+}
+
+static void Push(ThreadLog_t &log, LogFormat_t format, const void *p, const char *pszA, const char *pszB, int32_t i)
+{
+	uint32_t head = log.head.load(std::memory_order_relaxed);
+	if (head - log.tail.load(std::memory_order_acquire) == ThreadLog_t::kCapacity)
+	{
+		log.dropped.fetch_add(1);
+		return;
+	}
+
+	LogEntry_t &entry = log.entries[head & (ThreadLog_t::kCapacity - 1)];
+	entry.format = format;
+	entry.i = i;
+	entry.p = p;
+	entry.lenA = uint8_t(CopyString(entry.text, LogEntry_t::kTextSize, pszA));
+	CopyString(entry.text + entry.lenA, LogEntry_t::kTextSize - entry.lenA, pszB);
+
+	// Sequentially consistent against s_bWaiting, as is counting a drop, so either the log thread
+	// sees the new entry before sleeping or the caller of Push sees it waiting and wakes it.
+	log.head.store(head + 1);
+}
+
+// Only takes a lock when the log thread is asleep, which it only is once it has caught up.
+static void Wake()
+{
+	if (s_bWaiting.load())
+	{
+		std::lock_guard<std::mutex> lock(s_WakeMutex);
+		s_WakeCV.notify_one();
+	}
+}
+
+static ThreadLog_t *ThreadLog()
+{
+	return t_pLog && t_Generation == s_Generation.load(std::memory_order_relaxed) ? t_pLog : nullptr;
+}
+
+void LogRegisterThread()
+{
+	if (ThreadLog())
+		return;
+
+	ThreadLog_t *pLog = new ThreadLog_t;
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	pLog->pNext = s_pThreads;
+	s_pThreads = pLog;
+	t_pLog = pLog;
+	t_Generation = s_Generation.load(std::memory_order_relaxed);
+}
+
+void LogRecord(LogFormat_t format, const void *p, const char *pszA, const char *pszB, int32_t i)
+{
+	if (ThreadLog_t *pLog = ThreadLog())
+	{
+		Push(*pLog, format, p, pszA, pszB, i);
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		Push(s_Shared, format, p, pszA, pszB, i);
+	}
+
+	Wake();
+}
+
+void LogSetLevel(int level)
+{
+	g_LogLevel.store(level, std::memory_order_relaxed);
+}
+
+// Formats everything currently in the ring.
+static void Drain(ThreadLog_t &log)
+{
+	char szLine[512];
+
+	uint32_t dropped = log.dropped.exchange(0, std::memory_order_relaxed);
+	if (dropped)
+	{
+		snprintf(szLine, sizeof(szLine), "D2V: Log fell behind, dropped %u entries\n", dropped);
+		s_pfnLine(szLine);
+	}
+
+	uint32_t tail = log.tail.load(std::memory_order_relaxed);
+	uint32_t head = log.head.load();
+	for (; tail != head; ++tail)
+	{
+		const LogEntry_t &entry = log.entries[tail & (ThreadLog_t::kCapacity - 1)];
+		snprintf(szLine, sizeof(szLine), s_LogFormats[entry.format], entry.p, entry.text, entry.text + entry.lenA, entry.i);
+		s_pfnLine(szLine);
+
+		// Handed back entry by entry, so a long backlog frees room as it goes.
+		log.tail.store(tail + 1, std::memory_order_release);
+	}
+}
+
+static void DrainAll()
+{
+	// Rings are only ever added to the front of the list, and only freed once the log thread has
+	// stopped, so it can be walked unlocked. The log thread is the only consumer of every ring, the
+	// shared one included.
+	ThreadLog_t *pThreads;
+	{
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		pThreads = s_pThreads;
+	}
+
+	Drain(s_Shared);
+	for (ThreadLog_t *p = pThreads; p; p = p->pNext)
+		Drain(*p);
+}
+
+static bool Pending(const ThreadLog_t &log)
+{
+	return log.head.load() != log.tail.load(std::memory_order_relaxed) || log.dropped.load();
+}
+
+static bool AnyPending()
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	if (Pending(s_Shared))
+		return true;
+
+	for (ThreadLog_t *p = s_pThreads; p; p = p->pNext)
+	{
+		if (Pending(*p))
+			return true;
+	}
+
+	return false;
+}
+
+static void ThreadMain()
+{
+	std::unique_lock<std::mutex> lock(s_WakeMutex);
+	while (!s_bStop)
+	{
+		lock.unlock();
+		DrainAll();
+		lock.lock();
+
+		// Sleeps until a producer or LogStop wakes it.
+		s_bWaiting = true;
+		s_WakeCV.wait(lock, []() { return s_bStop || AnyPending(); });
+		s_bWaiting = false;
+	}
+}
+
+void LogStart(void (*pfnLine)(const char *pszLine))
+{
+	if (s_Thread.joinable())
+		return;
+
+	s_pfnLine = pfnLine;
+	s_bStop = false;
+	s_Thread = std::thread(ThreadMain);
+}
+
+void LogStop()
+{
+	if (!s_Thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(s_WakeMutex);
+		s_bStop = true;
+	}
+	s_WakeCV.notify_one();
+	s_Thread.join();
+
+	DrainAll();
+
+	// Every thread is done recording by now, hooks having been removed first.
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	while (s_pThreads)
+	{
+		ThreadLog_t *pNext = s_pThreads->pNext;
+		delete s_pThreads;
+		s_pThreads = pNext;
+	}
+	s_Generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif
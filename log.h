@@ -0,0 +1,91 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "common.h"
+
+// Hook logging. Build with D2V_LOG=0 to compile it out entirely.
+#ifndef D2V_LOG
+#define D2V_LOG 1
+#endif
+
+// Each entry's format is fixed, so hooks only store an id and the raw arguments.
+enum LogFormat_t : uint8_t
+{
+	Log_SetValue1,    // scope, key
+	Log_SetValue2,    // scope, key
+	Log_SetValue3,    // scope, index as a key
+	Log_SetEnumValue, // scope, enum name, value name, value
+
+	Log_Count
+};
+
+// vdump_log_level. Each level includes the ones below it.
+enum LogLevel_t
+{
+	LogLevel_Off,
+	LogLevel_Enums,  // SetEnumValue
+	LogLevel_Values, // SetValue too
+};
+
+#if D2V_LOG
+
+#include <atomic>
+
+extern std::atomic<int> g_LogLevel;
+
+inline bool LogEnabled(LogLevel_t level)
+{
+	return g_LogLevel.load(std::memory_order_relaxed) >= level;
+}
+
+// Starts the thread that formats entries and passes each line on.
+void LogStart(void (*pfnLine)(const char *pszLine));
+// Stops the thread, formats whatever is left and frees every thread's ring. Recording must have
+// stopped first; threads register again after the next LogStart.
+void LogStop();
+void LogSetLevel(int level);
+
+// Gives the calling thread its own ring, so recording never takes a lock. Any other thread
+// records into a shared, locked ring.
+void LogRegisterThread();
+// Copies the entry into the thread's ring, or drops it (and counts the drop) if the ring is full.
+void LogRecord(LogFormat_t format, const void *p, const char *pszA, const char *pszB = nullptr, int32_t i = 0);
+
+// The level check comes first, so a disabled entry costs one relaxed load.
+#define D2V_LOG_EVENT(level, format, ...) \
+	do { if (LogEnabled(level)) LogRecord(format, __VA_ARGS__); } while (0)
+
+#else
+
+inline void LogStart(void (*pfnLine)(const char *pszLine)) {}
+inline void LogStop() {}
+inline void LogSetLevel(int level) {}
+inline void LogRegisterThread() {}
+
+#define D2V_LOG_EVENT(level, format, ...)
+
+#endif
@@ -0,0 +1,133 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+// Where a bound OutputBuffer sends its data as it fills, e.g. a compressor.
+class IOutputSink
+{
+public:
+	virtual ~IOutputSink() {}
+	virtual void Write(const char *pData, size_t len) = 0;
+};
+
+// Growable byte buffer that dumpers render into. Bound to a sink, it passes its data on in large
+// chunks as it fills. Unbound, it keeps everything in memory, so output can be rendered off the
+// main thread and written out later. Needs nothing from the SDK, so tools/ can use it too.
+class OutputBuffer
+{
+public:
+	OutputBuffer() : m_pSink(nullptr), m_pData(nullptr), m_Used(0), m_Capacity(0) {}
+	explicit OutputBuffer(IOutputSink *pSink) : m_pSink(pSink), m_pData(nullptr), m_Used(0), m_Capacity(0) {}
+	OutputBuffer(OutputBuffer &&other)
+		: m_pSink(other.m_pSink), m_pData(other.m_pData), m_Used(other.m_Used), m_Capacity(other.m_Capacity)
+	{
+		other.m_pSink = nullptr;
+		other.m_pData = nullptr;
+		other.m_Used = other.m_Capacity = 0;
+	}
+	~OutputBuffer()
+	{
+		Flush();
+		free(m_pData);
+	}
+
+	void Write(const char *pData, size_t len)
+	{
+		if (m_Used + len > m_Capacity)
+			Reserve(len);
+
+		memcpy(&m_pData[m_Used], pData, len);
+		m_Used += len;
+	}
+
+	void WriteChar(char c)
+	{
+		if (m_Used == m_Capacity)
+			Reserve(1);
+
+		m_pData[m_Used++] = c;
+	}
+
+	void Append(const OutputBuffer &other) { Write(other.m_pData, other.m_Used); }
+
+	// Passes any pending data on to the bound sink. Does nothing for memory buffers.
+	void Flush()
+	{
+		if (m_Used && m_pSink)
+		{
+			m_pSink->Write(m_pData, m_Used);
+			m_Used = 0;
+		}
+	}
+
+	// Drops the contents, keeping the memory for reuse.
+	void Clear() { m_Used = 0; }
+
+	// Bound buffers only ever hold the latest chunk, so renderers should write into them directly
+	// rather than building pieces up in memory first.
+	bool IsStreaming() const { return m_pSink != nullptr; }
+
+	const char *Data() const { return m_pData; }
+	size_t Size() const { return m_Used; }
+
+private:
+	OutputBuffer(const OutputBuffer &) = delete;
+	OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+	void Reserve(size_t len)
+	{
+		if (IsStreaming())
+		{
+			Flush();
+			if (!m_Capacity)
+			{
+				m_Capacity = kFileChunkSize;
+				m_pData = (char *)malloc(m_Capacity);
+			}
+			if (len <= m_Capacity)
+				return;
+		}
+
+		size_t capacity = m_Capacity ? m_Capacity : kFileChunkSize;
+		while (m_Used + len > capacity)
+			capacity *= 2;
+
+		m_pData = (char *)realloc(m_pData, capacity);
+		m_Capacity = capacity;
+	}
+
+private:
+	static const size_t kFileChunkSize = 32 * 1024;
+
+	IOutputSink *m_pSink;
+	char *m_pData;
+	size_t m_Used;
+	size_t m_Capacity;
+};
@@ -0,0 +1,599 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "scriptmodel.h"
+#include "capturejournal.h"
+
+#include <cstring>
+
+const uint32_t ScriptModel::kNoRow;
+
+ScriptModel::ScriptModel(const ScriptModel &other) : m_pJournal(nullptr), m_HistoryLimit(other.m_HistoryLimit.load())
+{
+	m_VMs.reserve(other.m_VMs.size());
+	for (auto &vm : other.m_VMs)
+		m_VMs.emplace_back(new VMCapture_t(*vm));
+}
+
+ScriptModel::VMCapture_t &ScriptModel::GetVM(VMType v)
+{
+	while (m_VMs.size() <= v)
+		m_VMs.emplace_back(new VMCapture_t);
+
+	return *m_VMs[v];
+}
+
+const ScriptModel::VMCapture_t &ScriptModel::FindVM(VMType v) const
+{
+	return v < m_VMs.size() ? *m_VMs[v] : m_EmptyVM;
+}
+
+void ScriptModel::Clear(VMType v)
+{
+	// Only need to clear out globals and enums. Class defs are already protected against dupes.
+	VMCapture_t &vm = GetVM(v);
+	vm.globalConstants.Clear();
+	vm.globalNameIds.Clear();
+	vm.globalRows.Clear();
+	vm.globalScopes.clear();
+	vm.globalHistory.clear();
+	vm.globalTables.clear();
+	vm.histories.clear();
+	vm.ResetScopes();
+	vm.enums.clear();
+	vm.enumIndex.Clear();
+	vm.enumValues.Clear();
+	vm.valueStrings.Reset();
+	vm.compactedValueStrings = 0;
+
+	if (m_pJournal)
+		m_pJournal->ClearVM(v);
+}
+
+void ScriptModel::DestroyVM(VMType v)
+{
+	if (m_pJournal)
+		m_pJournal->DestroyVM(v);
+}
+
+void ScriptModel::FlushJournal()
+{
+	if (m_pJournal)
+		m_pJournal->Flush();
+}
+
+void ScriptModel::CaptureFunction(VMCapture_t &vm, ScriptFuncDescriptor_t &funcDesc, ScriptFunction_t &func)
+{
+	func.name = vm.strings.Intern(funcDesc.m_pszScriptName);
+	func.desc = vm.strings.Intern(funcDesc.m_pszDescription);
+	func.returnType = funcDesc.m_ReturnType;
+	func.firstParam = uint32_t(vm.params.size());
+	func.paramCount = uint32_t(funcDesc.m_iParamCount);
+	func.hasParamNames = funcDesc.m_pszParameterNames != nullptr;
+
+	// Names are packed back to back, each null terminated. Long names are cut to the 63 chars the old dump kept.
+	size_t iParamNameStart = 0;
+	for (int i = 0; i < funcDesc.m_iParamCount; ++i)
+	{
+		vm.params.push_back(funcDesc.m_Parameters[i]);
+
+		StringId paramName = kEmptyString;
+		if (func.hasParamNames)
+		{
+			const char *pszParamName = &funcDesc.m_pszParameterNames[iParamNameStart];
+			size_t len = strlen(pszParamName);
+			paramName = vm.strings.Intern(pszParamName, len < 63 ? len : 63);
+			iParamNameStart += len + 1;
+		}
+		vm.paramNames.push_back(paramName);
+	}
+}
+
+void ScriptModel::ConstantTable_t::Clear()
+{
+	names.clear();
+	descs.clear();
+	types.clear();
+	values.clear();
+}
+
+template <typename T>
+static size_t VectorBytes(const std::vector<T> &v)
+{
+	return v.capacity() * sizeof(T);
+}
+
+size_t ScriptModel::ConstantTable_t::MemoryUsage() const
+{
+	return VectorBytes(names) + VectorBytes(descs) + VectorBytes(types) + VectorBytes(values);
+}
+
+ScriptModel::ScriptValueData_t ScriptModel::CaptureValue(VMCapture_t &vm, const ScriptVariant_t &value)
+{
+	ScriptValueData_t data;
+	memset(&data, 0, sizeof(data));
+
+	switch (value.m_type)
+	{
+	case FIELD_CSTRING:
+		data.s = vm.valueStrings.Intern(value.m_pszString);
+		break;
+	case FIELD_INTEGER:
+		data.i = value.m_int;
+		break;
+	case FIELD_FLOAT:
+		data.f = value.m_float;
+		break;
+	case FIELD_UINT:
+		data.u = value.m_uint;
+		break;
+	case FIELD_VECTOR:
+		data.vec[0] = value.m_pVector->x;
+		data.vec[1] = value.m_pVector->y;
+		data.vec[2] = value.m_pVector->z;
+		break;
+	case FIELD_HSCRIPT:
+		data.u = value.m_hScript && value.m_hScript != INVALID_HSCRIPT ? FindScope(vm, value.m_hScript) : kNoRow;
+		break;
+	}
+
+	return data;
+}
+
+void ScriptModel::AddConstant(VMCapture_t &vm, ConstantTable_t &table, const char *pszName, const char *pszDesc, const ScriptVariant_t &value)
+{
+	ScriptValueData_t data = CaptureValue(vm, value);
+
+	table.names.push_back(vm.valueStrings.Intern(pszName));
+	table.descs.push_back(vm.valueStrings.Intern(pszDesc));
+	table.types.push_back(value.m_type);
+	table.values.push_back(data);
+}
+
+void ScriptModel::VMCapture_t::ResetScopes()
+{
+	Scope_t root = { nullptr, kNoRow, kEmptyString };
+	scopes.assign(1, root);
+	scopeIds = PointerHashMap<uint32_t>();
+	pendingTables = PointerHashMap<uint32_t>();
+}
+
+uint32_t ScriptModel::ScopeId(VMCapture_t &vm, HSCRIPT hScope)
+{
+	if (!hScope)
+		return kRootScope;
+
+	uint32_t *pId = vm.scopeIds.Find(hScope);
+	if (pId)
+		return *pId;
+
+	uint32_t id = uint32_t(vm.scopes.size());
+	Scope_t scope = { hScope, kNoRow, kEmptyString };
+	vm.scopes.push_back(scope);
+	vm.scopeIds.Set(hScope, id);
+
+	// Set as a value before anything was set in it, so that's where it lives.
+	uint32_t *pRow = vm.pendingTables.Find(hScope);
+	if (pRow)
+	{
+		uint32_t row = *pRow;
+		vm.pendingTables.Remove(hScope);
+		vm.globalConstants.values[row].u = id;
+		LinkScope(vm, id, vm.globalScopes[row], vm.globalConstants.names[row]);
+	}
+
+	return id;
+}
+
+uint32_t ScriptModel::FindScope(VMCapture_t &vm, HSCRIPT hScope)
+{
+	uint32_t *pId = vm.scopeIds.Find(hScope);
+	return pId ? *pId : kNoRow;
+}
+
+void ScriptModel::ForgetTable(VMCapture_t &vm, uint32_t row)
+{
+	HSCRIPT hTable = vm.globalTables[row];
+	if (!hTable)
+		return;
+
+	uint32_t *pRow = vm.pendingTables.Find(hTable);
+	if (pRow && *pRow == row)
+		vm.pendingTables.Remove(hTable);
+	vm.globalTables[row] = nullptr;
+}
+
+void ScriptModel::LinkScope(VMCapture_t &vm, uint32_t scope, uint32_t parent, StringId name)
+{
+	// A table set in more than one place stays where it was first set.
+	if (scope == kNoRow || scope == kRootScope || vm.scopes[scope].parent != kNoRow)
+		return;
+
+	for (uint32_t i = parent; i != kNoRow; i = vm.scopes[i].parent)
+	{
+		if (i == scope)
+			return;
+	}
+
+	vm.scopes[scope].parent = parent;
+	vm.scopes[scope].name = name;
+}
+
+void ScriptModel::ScopePaths(const VMCapture_t &vm, std::vector<std::string> &paths)
+{
+	paths.assign(vm.scopes.size(), std::string());
+	std::vector<bool> done(vm.scopes.size(), false);
+	done[kRootScope] = true;
+
+	std::vector<uint32_t> chain;
+	for (uint32_t i = 0; i < vm.scopes.size(); ++i)
+	{
+		// Walk up to the nearest scope with a path, then fill in paths on the way back down.
+		for (uint32_t j = i; !done[j]; j = vm.scopes[j].parent)
+		{
+			chain.push_back(j);
+			if (vm.scopes[j].parent == kNoRow)
+			{
+				paths[j] = "<table " + std::to_string(j) + ">";
+				done[j] = true;
+				chain.pop_back();
+				break;
+			}
+		}
+
+		while (!chain.empty())
+		{
+			uint32_t j = chain.back();
+			chain.pop_back();
+
+			const char *pszName = vm.valueStrings.Get(vm.scopes[j].name);
+			const std::string &parent = paths[vm.scopes[j].parent];
+			paths[j] = parent;
+			if (!parent.empty() && pszName[0] != '[')
+				paths[j] += '.';
+			paths[j] += pszName;
+			done[j] = true;
+		}
+	}
+}
+
+void ScriptModel::CompactValueStrings(VMCapture_t &vm)
+{
+	// Replaced string values stay in the pool, so copy out only what is still referenced.
+	StringPool strings;
+	auto move = [&vm, &strings](StringId &id) { id = strings.Intern(vm.valueStrings.Get(id)); };
+	auto moveTable = [&move](ConstantTable_t &table, size_t i) {
+		move(table.names[i]);
+		move(table.descs[i]);
+		if (table.types[i] == FIELD_CSTRING)
+			move(table.values[i].s);
+	};
+
+	for (auto &scriptEnum : vm.enums)
+		move(scriptEnum.name);
+	for (size_t i = 0; i < vm.enumValues.Count(); ++i)
+		moveTable(vm.enumValues, i);
+	for (size_t i = 0; i < vm.globalConstants.Count(); ++i)
+		moveTable(vm.globalConstants, i);
+	for (auto &scope : vm.scopes)
+		move(scope.name);
+	for (auto &history : vm.histories)
+	{
+		for (size_t i = 0; i < history.values.size(); ++i)
+		{
+			if (history.types[i] == FIELD_CSTRING)
+				move(history.values[i].s);
+		}
+	}
+
+	vm.valueStrings = strings;
+	vm.compactedValueStrings = vm.valueStrings.Size();
+}
+
+uint64_t ScriptModel::HashFunction(const VMCapture_t &vm, const ScriptFunction_t &func)
+{
+	Fingerprint fp;
+	fp.AddString(vm.strings.Get(func.name));
+	fp.AddString(vm.strings.Get(func.desc));
+	fp.AddValue(func.returnType);
+	fp.AddValue(func.hasParamNames);
+	fp.AddValue(func.paramCount);
+	for (size_t i = 0; i < func.paramCount; ++i)
+	{
+		fp.AddValue(vm.params[func.firstParam + i]);
+		fp.AddString(vm.strings.Get(vm.paramNames[func.firstParam + i]));
+	}
+	return fp.Get();
+}
+
+void ScriptModel::HashValue(Fingerprint &fp, const VMCapture_t &vm, int16_t type, const ScriptValueData_t &value)
+{
+	fp.AddValue(type);
+
+	switch (type)
+	{
+	case FIELD_CSTRING:
+		fp.AddString(vm.valueStrings.Get(value.s));
+		break;
+	case FIELD_VECTOR:
+		fp.AddValue(value.vec);
+		break;
+	default:
+		fp.AddValue(value.u);
+		break;
+	}
+}
+
+void ScriptModel::HashRow(Fingerprint &fp, const VMCapture_t &vm, const ConstantTable_t &table, uint32_t row)
+{
+	fp.AddString(vm.valueStrings.Get(table.names[row]));
+	fp.AddString(vm.valueStrings.Get(table.descs[row]));
+	HashValue(fp, vm, table.types[row], table.values[row]);
+}
+
+// Strings are hashed by content, so compacting the pool doesn't change the result.
+uint64_t ScriptModel::HashValues(const VMCapture_t &vm)
+{
+	Fingerprint fp;
+
+	fp.AddValue(vm.enums.size());
+	for (auto &scriptEnum : vm.enums)
+	{
+		fp.AddString(vm.valueStrings.Get(scriptEnum.name));
+		fp.AddValue(scriptEnum.rows.size());
+		for (auto &range : scriptEnum.rows)
+		{
+			fp.AddValue(range.count);
+			for (uint32_t i = range.first; i < range.first + range.count; ++i)
+				HashRow(fp, vm, vm.enumValues, i);
+		}
+	}
+
+	const ConstantTable_t &globals = vm.globalConstants;
+	fp.AddValue(globals.Count());
+	for (uint32_t i = 0; i < globals.Count(); ++i)
+	{
+		HashRow(fp, vm, globals, i);
+		fp.AddValue(vm.globalScopes[i]);
+
+		// Oldest first, as written out, so where the ring happens to start doesn't matter.
+		const ValueHistory_t *pHistory = vm.globalHistory[i] ? &vm.histories[vm.globalHistory[i] - 1] : nullptr;
+		uint32_t count = pHistory ? pHistory->Count() : 0;
+		fp.AddValue(count);
+		for (uint32_t h = 0; h < count; ++h)
+			HashValue(fp, vm, pHistory->types[pHistory->Slot(h)], pHistory->values[pHistory->Slot(h)]);
+	}
+
+	// Where each scope sits, which is what the scope paths are made from.
+	fp.AddValue(vm.scopes.size());
+	for (auto &scope : vm.scopes)
+	{
+		fp.AddValue(scope.parent);
+		fp.AddString(vm.valueStrings.Get(scope.name));
+	}
+
+	return fp.Get();
+}
+
+uint64_t ScriptModel::GetFingerprint(VMType v, bool bValues) const
+{
+	const VMCapture_t &vm = FindVM(v);
+	return bValues ? HashValues(vm) : vm.functionsFingerprint;
+}
+
+size_t ScriptModel::MemoryUsage(VMType v) const
+{
+	const VMCapture_t &vm = FindVM(v);
+
+	size_t bytes = vm.strings.MemoryUsage() + vm.valueStrings.MemoryUsage();
+	bytes += vm.classes.MemoryUsage() + vm.funcs.MemoryUsage();
+	bytes += VectorBytes(vm.classDefs) + VectorBytes(vm.classFuncs) + VectorBytes(vm.globalFuncs) + VectorBytes(vm.params) + VectorBytes(vm.paramNames);
+
+	bytes += VectorBytes(vm.enums) + vm.enumIndex.MemoryUsage() + vm.enumValues.MemoryUsage();
+	for (auto &scriptEnum : vm.enums)
+		bytes += VectorBytes(scriptEnum.rows);
+
+	bytes += vm.globalConstants.MemoryUsage() + vm.globalNameIds.MemoryUsage() + vm.globalRows.MemoryUsage();
+	bytes += VectorBytes(vm.globalScopes) + VectorBytes(vm.globalHistory) + VectorBytes(vm.globalTables) + VectorBytes(vm.histories);
+	for (auto &history : vm.histories)
+		bytes += VectorBytes(history.types) + VectorBytes(history.values);
+
+	bytes += VectorBytes(vm.scopes) + vm.scopeIds.MemoryUsage() + vm.pendingTables.MemoryUsage();
+	return bytes;
+}
+
+void ScriptModel::AddClass(ScriptClassDesc_t &classDesc, VMType v)
+{
+	VMCapture_t &vm = GetVM(v);
+
+	// Marked up front, so the base chain recursion below can't revisit it.
+	if (!vm.classes.Insert(classDesc.m_pszScriptName).second)
+		return;
+
+	if (classDesc.m_pBaseDesc)
+	{
+		AddClass(*classDesc.m_pBaseDesc, v);
+	}
+
+	ScriptClass_t scriptClass;
+	scriptClass.name = vm.strings.Intern(classDesc.m_pszScriptName);
+	scriptClass.hasBase = classDesc.m_pBaseDesc != nullptr;
+	scriptClass.base = scriptClass.hasBase ? vm.strings.Intern(classDesc.m_pBaseDesc->m_pszScriptName) : kEmptyString;
+	scriptClass.hasDesc = classDesc.m_pszDescription != nullptr;
+	scriptClass.desc = vm.strings.Intern(classDesc.m_pszDescription);
+	scriptClass.firstFunc = uint32_t(vm.classFuncs.size());
+	scriptClass.funcCount = uint32_t(classDesc.m_FunctionBindings.Count());
+
+	vm.classFuncs.resize(scriptClass.firstFunc + scriptClass.funcCount);
+	uint64_t funcsFingerprint = 0;
+	FOR_EACH_VEC(classDesc.m_FunctionBindings, i)
+	{
+		ScriptFunction_t &func = vm.classFuncs[scriptClass.firstFunc + i];
+		CaptureFunction(vm, classDesc.m_FunctionBindings[i].m_desc, func);
+		funcsFingerprint += HashFunction(vm, func);
+	}
+
+	vm.classDefs.push_back(scriptClass);
+	if (m_pJournal)
+		m_pJournal->AddClass(vm, v, scriptClass);
+
+	Fingerprint fp;
+	fp.AddValue('c');
+	fp.AddString(classDesc.m_pszScriptName);
+	fp.AddString(classDesc.m_pszDescription);
+	fp.AddString(scriptClass.hasBase ? classDesc.m_pBaseDesc->m_pszScriptName : nullptr);
+	fp.AddValue(funcsFingerprint);
+	vm.functionsFingerprint += fp.Get();
+}
+
+void ScriptModel::AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v)
+{
+	VMCapture_t &vm = GetVM(v);
+
+	if (!vm.funcs.Insert(funcDesc.m_pszScriptName).second)
+		return;
+
+	ScriptFunction_t func;
+	CaptureFunction(vm, funcDesc, func);
+	vm.globalFuncs.push_back(func);
+	if (m_pJournal)
+		m_pJournal->AddFunction(vm, v, func);
+
+	Fingerprint fp;
+	fp.AddValue('g');
+	fp.AddValue(HashFunction(vm, func));
+	vm.functionsFingerprint += fp.Get();
+}
+
+void ScriptModel::AddValue(HSCRIPT hScope, const char *pszName, const ScriptVariant_t &value, VMType v)
+{
+	static const size_t kCompactSlack = 64 * 1024;
+
+	VMCapture_t &vm = GetVM(v);
+	ConstantTable_t &globals = vm.globalConstants;
+
+	uint32_t scope = ScopeId(vm, hScope);
+	auto nameId = vm.globalNameIds.Insert(pszName);
+	if (nameId.second)
+		*nameId.first = uint32_t(vm.globalNameIds.Count() - 1);
+
+	auto inserted = vm.globalRows.Insert(GlobalKey(scope, *nameId.first));
+	uint32_t row;
+	if (inserted.second)
+	{
+		row = globals.Count();
+		*inserted.first = row;
+		AddConstant(vm, globals, pszName, nullptr, value);
+		vm.globalScopes.push_back(scope);
+		vm.globalHistory.push_back(0);
+		vm.globalTables.push_back(nullptr);
+	}
+	else
+	{
+		row = *inserted.first;
+
+		// Setting the same value again changes nothing, so it doesn't count as a change to save.
+		ScriptValueData_t data = CaptureValue(vm, value);
+		if (globals.types[row] == value.m_type && !memcmp(&globals.values[row], &data, sizeof(data)) && vm.globalTables[row] == TableHandle(value))
+			return;
+
+		uint32_t limit = m_HistoryLimit.load(std::memory_order_relaxed);
+		if (limit)
+		{
+			if (!vm.globalHistory[row])
+			{
+				vm.histories.emplace_back();
+				vm.globalHistory[row] = uint32_t(vm.histories.size());
+			}
+
+			ValueHistory_t &history = vm.histories[vm.globalHistory[row] - 1];
+			if (history.Count() < limit)
+			{
+				history.types.push_back(globals.types[row]);
+				history.values.push_back(globals.values[row]);
+			}
+			else
+			{
+				history.types[history.next] = globals.types[row];
+				history.values[history.next] = globals.values[row];
+				history.next = (history.next + 1) % history.Count();
+			}
+		}
+
+		globals.types[row] = value.m_type;
+		globals.values[row] = data;
+		ForgetTable(vm, row);
+
+		if (vm.valueStrings.Size() > 2 * vm.compactedValueStrings + kCompactSlack)
+			CompactValueStrings(vm);
+	}
+
+	// A table set as a value is where the values later set in it live. One nothing was set in
+	// yet is linked once something is.
+	HSCRIPT hTable = TableHandle(value);
+	if (hTable)
+	{
+		vm.globalTables[row] = hTable;
+		if (globals.values[row].u != kNoRow)
+			LinkScope(vm, globals.values[row].u, scope, globals.names[row]);
+		else if (!vm.pendingTables.Find(hTable))
+			vm.pendingTables.Set(hTable, row);
+	}
+
+	if (m_pJournal)
+		m_pJournal->AddValue(vm, v, row);
+}
+
+void ScriptModel::AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v)
+{
+	VMCapture_t &vm = GetVM(v);
+
+	auto inserted = vm.enumIndex.Insert(pszEnumName);
+	if (inserted.second)
+	{
+		*inserted.first = uint32_t(vm.enums.size());
+
+		ScriptEnum_t scriptEnum;
+		scriptEnum.name = vm.valueStrings.Intern(pszEnumName);
+		vm.enums.push_back(scriptEnum);
+	}
+
+	// Extends the enum's last run when it was also the last enum added to.
+	uint32_t row = vm.enumValues.Count();
+	std::vector<RowRange_t> &rows = vm.enums[*inserted.first].rows;
+	if (!rows.empty() && rows.back().first + rows.back().count == row)
+	{
+		++rows.back().count;
+	}
+	else
+	{
+		RowRange_t range = { row, 1 };
+		rows.push_back(range);
+	}
+
+	AddConstant(vm, vm.enumValues, pszName, pszDesc, ScriptVariant_t(value));
+	if (m_pJournal)
+		m_pJournal->AddEnumValue(vm, v, pszEnumName, row);
+}
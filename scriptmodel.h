@@ -0,0 +1,275 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "common.h"
+#include "fingerprint.h"
+#include "hashmap.h"
+#include "stringpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#undef strdup
+#include <vscript/ivscript.h>
+
+class CaptureJournal;
+
+// Compact copy of every class, function, enum and global captured, per VM. The hooks fill it once,
+// and every dumper renders from it at save time.
+//
+// Const methods may be called concurrently, but never concurrently with Clear or the Add methods.
+class ScriptModel
+{
+public:
+	struct ScriptFunction_t
+	{
+		StringId name;
+		StringId desc;
+		ScriptDataType_t returnType;
+		uint32_t firstParam; // Index into VMCapture_t::params and paramNames
+		uint32_t paramCount;
+		bool hasParamNames;
+	};
+
+	struct ScriptClass_t
+	{
+		StringId name;
+		StringId base;
+		StringId desc;
+		bool hasBase;
+		bool hasDesc;
+		uint32_t firstFunc; // Index into VMCapture_t::classFuncs
+		uint32_t funcCount;
+	};
+
+	// Own copy of a ScriptVariant_t's data, read according to its type. Strings and vectors are
+	// copied out, as the engine's can be temporaries.
+	union ScriptValueData_t
+	{
+		int32_t i;
+		uint32_t u;
+		float f;
+		StringId s;
+		float vec[3];
+	};
+
+	// Globals or enum values, one column per field, so they are appended and walked without
+	// chasing pointers. Rows keep capture order.
+	struct ConstantTable_t
+	{
+		std::vector<StringId> names;
+		std::vector<StringId> descs;
+		std::vector<int16_t> types;
+		std::vector<ScriptValueData_t> values;
+
+		uint32_t Count() const { return uint32_t(names.size()); }
+		void Clear();
+		size_t MemoryUsage() const;
+	};
+
+	struct RowRange_t
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	// An enum's values, as runs of consecutive rows in VMCapture_t::enumValues. The game registers
+	// an enum's values together, so this is nearly always a single run.
+	struct ScriptEnum_t
+	{
+		StringId name;
+		std::vector<RowRange_t> rows;
+	};
+
+	// Bounded ring of a global's previous values. Oldest first, Get(i) is slot (next + i) % Count().
+	struct ValueHistory_t
+	{
+		ValueHistory_t() : next(0) {}
+
+		std::vector<int16_t> types;
+		std::vector<ScriptValueData_t> values;
+		uint32_t next; // Oldest slot once the ring is full, otherwise 0
+
+		uint32_t Count() const { return uint32_t(values.size()); }
+		uint32_t Slot(uint32_t i) const { return (next + i) % Count(); }
+	};
+
+	// A script table values were set in, or that was set as a value. Scope 0 is the root table.
+	struct Scope_t
+	{
+		HSCRIPT handle;
+		uint32_t parent; // Scope it was first set in, or kNoRow if that was never seen
+		StringId name;   // Key it was set under there
+	};
+
+	static const uint32_t kNoRow = 0xFFFFFFFF;
+	static const uint32_t kRootScope = 0;
+
+	typedef StringHashMap<bool> StringSet_t;
+
+	struct VMCapture_t
+	{
+		VMCapture_t() : compactedValueStrings(0), functionsFingerprint(0) { ResetScopes(); }
+
+		void ResetScopes();
+
+		StringPool strings;      // Class and function data. Lives as long as the model.
+		StringPool valueStrings; // Globals and enums. Reset whenever the VM is recreated.
+
+		StringSet_t classes;
+		StringSet_t funcs;
+
+		std::vector<ScriptClass_t> classDefs;
+		std::vector<ScriptFunction_t> classFuncs;
+		std::vector<ScriptFunction_t> globalFuncs;
+		std::vector<ScriptDataType_t> params;
+		std::vector<StringId> paramNames;
+
+		std::vector<ScriptEnum_t> enums;   // Capture order
+		StringHashMap<uint32_t> enumIndex; // Name to index into enums
+		ConstantTable_t enumValues;
+
+		// One row per scope and name, updated in place, so globals take as much room as there are
+		// distinct ones, however often scripts set them. Rows keep the order they were first set in.
+		// A value holding a table keeps the table's scope in its u.
+		ConstantTable_t globalConstants;
+		StringHashMap<uint32_t> globalNameIds; // Name to a dense id
+		IntegerHashMap<uint32_t> globalRows;   // GlobalKey() to row
+		std::vector<uint32_t> globalScopes;    // Per row
+		std::vector<uint32_t> globalHistory;   // Per row, index into histories plus one, or 0
+		std::vector<HSCRIPT> globalTables;     // Per row, the table it holds, or null
+		std::vector<ValueHistory_t> histories;
+		size_t compactedValueStrings;          // Size of valueStrings after it was last compacted
+
+		std::vector<Scope_t> scopes;
+		PointerHashMap<uint32_t> scopeIds; // Handle to index into scopes, except for the root
+		// A table held by a row that nothing was set in yet, to the first such row. Only tables
+		// values are set in become scopes, so handles passed around as values don't pile up.
+		PointerHashMap<uint32_t> pendingTables;
+
+		// Classes and functions are only ever added and are written out sorted, so their
+		// fingerprints are summed and capture order doesn't matter. Values are hashed as they stand
+		// when asked for, as they are updated in place.
+		uint64_t functionsFingerprint;
+	};
+
+public:
+	ScriptModel() : m_pJournal(nullptr), m_HistoryLimit(0) {}
+	// Deep copy, for saving off the game thread. The copy doesn't journal.
+	ScriptModel(const ScriptModel &other);
+
+	// Everything added from here on is also appended to the journal, if one is set.
+	void SetJournal(CaptureJournal *pJournal) { m_pJournal = pJournal; }
+	void FlushJournal();
+
+	// Previous values kept per global from now on. Safe to call from any thread.
+	void SetValueHistory(uint32_t limit) { m_HistoryLimit = limit; }
+
+	// Drops every VM.
+	void Reset() { m_VMs.clear(); }
+	void Clear(VMType v);
+	// Nothing to drop, as the VM's capture is dumped at unload, but the journal records it.
+	void DestroyVM(VMType v);
+	void AddClass(ScriptClassDesc_t &classDesc, VMType v);
+	void AddFunction(ScriptFuncDescriptor_t &funcDesc, VMType v);
+	// The last value set for a name in a scope wins.
+	void AddValue(HSCRIPT hScope, const char *pszName, const ScriptVariant_t &value, VMType v);
+	void AddEnumValue(const char *pszEnumName, const char *pszName, const char *pszDesc, int value, VMType v);
+
+	// Never grows the VM list, so it is safe to use while saving.
+	const VMCapture_t &FindVM(VMType v) const;
+	// Changes whenever the VM's classes and functions (or, with bValues, its globals and enums) change.
+	// Values that were changed and then set back fingerprint as they did before. With bValues this
+	// walks every value, so take it once per save.
+	uint64_t GetFingerprint(VMType v, bool bValues) const;
+	// Bytes the VM's capture holds on to, pools, tables and indexes included.
+	size_t MemoryUsage(VMType v) const;
+
+	// Where each scope sits, e.g. "GameRules.Settings[2]". Empty for the root. Scopes that were never
+	// seen set in another are named by index, as "<table 7>".
+	static void ScopePaths(const VMCapture_t &vm, std::vector<std::string> &paths);
+
+	// Sorted by name. When a name was captured more than once, only the last one is kept,
+	// as with keys set repeatedly on a JSON object.
+	template <typename T>
+	static std::vector<const T *> SortByName(const T *pList, size_t count, const StringPool &strings);
+
+private:
+	ScriptModel &operator=(const ScriptModel &) = delete;
+
+	VMCapture_t &GetVM(VMType v);
+
+	static void CaptureFunction(VMCapture_t &vm, ScriptFuncDescriptor_t &funcDesc, ScriptFunction_t &func);
+	static ScriptValueData_t CaptureValue(VMCapture_t &vm, const ScriptVariant_t &value);
+	static HSCRIPT TableHandle(const ScriptVariant_t &value) { return value.m_type == FIELD_HSCRIPT && value.m_hScript != INVALID_HSCRIPT ? value.m_hScript : nullptr; }
+	static void AddConstant(VMCapture_t &vm, ConstantTable_t &table, const char *pszName, const char *pszDesc, const ScriptVariant_t &value);
+	static uint32_t ScopeId(VMCapture_t &vm, HSCRIPT hScope);
+	// kNoRow if nothing was set in the table yet.
+	static uint32_t FindScope(VMCapture_t &vm, HSCRIPT hScope);
+	static void ForgetTable(VMCapture_t &vm, uint32_t row);
+	static void LinkScope(VMCapture_t &vm, uint32_t scope, uint32_t parent, StringId name);
+	static uint64_t GlobalKey(uint32_t scope, uint32_t nameId) { return (uint64_t(scope) << 32) | nameId; }
+	static void CompactValueStrings(VMCapture_t &vm);
+	static uint64_t HashFunction(const VMCapture_t &vm, const ScriptFunction_t &func);
+	static void HashValue(Fingerprint &fp, const VMCapture_t &vm, int16_t type, const ScriptValueData_t &value);
+	static void HashRow(Fingerprint &fp, const VMCapture_t &vm, const ConstantTable_t &table, uint32_t row);
+	static uint64_t HashValues(const VMCapture_t &vm);
+
+private:
+	std::vector<std::unique_ptr<VMCapture_t>> m_VMs;
+	VMCapture_t m_EmptyVM;
+	CaptureJournal *m_pJournal;
+	std::atomic<uint32_t> m_HistoryLimit;
+};
+
+template <typename T>
+std::vector<const T *> ScriptModel::SortByName(const T *pList, size_t count, const StringPool &strings)
+{
+	std::vector<const T *> sorted(count);
+	for (size_t i = 0; i < count; ++i)
+		sorted[i] = &pList[i];
+
+	std::stable_sort(sorted.begin(), sorted.end(), [&strings](const T *a, const T *b) {
+		return strcmp(strings.Get(a->name), strings.Get(b->name)) < 0;
+	});
+
+	// Interned, so equal names have equal ids.
+	size_t out = 0;
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		if (i + 1 < sorted.size() && sorted[i]->name == sorted[i + 1]->name)
+			continue;
+
+		sorted[out++] = sorted[i];
+	}
+	sorted.resize(out);
+
+	return sorted;
+}
@@ -0,0 +1,339 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "stats.h"
+
+#if D2V_STATS
+
+#include "jsonwriter.h"
+#include "outputbuffer.h"
+#include <filesystem.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef _MSC_VER
+#define D2V_THREAD_LOCAL __declspec(thread)
+#else
+#define D2V_THREAD_LOCAL __thread
+#endif
+
+static const char *s_StatNames[Stat_Count] = {
+	"CreateVM",
+	"DestroyVM",
+	"RegisterFunction",
+	"RegisterScriptClass",
+	"RegisterInstance",
+	"SetValue1",
+	"SetValue2",
+	"SetValue3",
+	"SetEnumValue",
+	"Model::Clear",
+	"Model::AddClass",
+	"Model::AddFunction",
+	"Model::AddValue",
+	"Model::AddEnumValue",
+	"Dumper::SaveFunctions",
+	"Dumper::SaveValues",
+};
+
+// Stats are kept for the main and bot VMs, all other VMs together, and calls without a VM.
+static const size_t kVMSlots = 4;
+static const char *s_VMSlotNames[kVMSlots] = { "main", "bot", "extra", "none" };
+
+static size_t VMSlot(VMType v)
+{
+	if (v == VM_Unknown)
+		return 3;
+	return v < VM_FirstExtra ? size_t(v) : 2;
+}
+
+// Log-linear: exact below 4 cycles, then four buckets per power of two, up to 2^41 cycles.
+static const size_t kMaxExponent = 41;
+static const size_t kBuckets = 4 * kMaxExponent;
+
+static size_t BucketFor(uint64_t cycles)
+{
+	if (cycles < 4)
+		return size_t(cycles);
+
+	size_t e = 63;
+	while (!(cycles >> e))
+		--e;
+	if (e > kMaxExponent)
+		return kBuckets - 1;
+
+	return 4 * (e - 1) + size_t((cycles >> (e - 2)) & 3);
+}
+
+static uint64_t BucketLowerBound(size_t bucket)
+{
+	if (bucket < 4)
+		return bucket;
+
+	return uint64_t(4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+// Only the owning thread writes these, so updates are plain relaxed load/store pairs with no
+// locked instructions. Atomics just keep concurrent readers well defined.
+struct StatCounters_t
+{
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> cycles;
+	std::atomic<uint64_t> maxCycles;
+	std::atomic<uint64_t> buckets[kBuckets];
+};
+
+struct ThreadStats_t
+{
+	ThreadStats_t() : pNext(nullptr)
+	{
+		for (auto &vm : stats)
+		{
+			for (auto &s : vm)
+			{
+				s.count.store(0, std::memory_order_relaxed);
+				s.cycles.store(0, std::memory_order_relaxed);
+				s.maxCycles.store(0, std::memory_order_relaxed);
+				for (auto &b : s.buckets)
+					b.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	StatCounters_t stats[kVMSlots][Stat_Count];
+	ThreadStats_t *pNext;
+};
+
+static void Bump(std::atomic<uint64_t> &counter, uint64_t by)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+static void Record(StatCounters_t &s, uint64_t cycles)
+{
+	Bump(s.count, 1);
+	Bump(s.cycles, cycles);
+	if (cycles > s.maxCycles.load(std::memory_order_relaxed))
+		s.maxCycles.store(cycles, std::memory_order_relaxed);
+	Bump(s.buckets[BucketFor(cycles)], 1);
+}
+
+static std::mutex s_Mutex; // Guards the thread list and the shared stats
+static ThreadStats_t *s_pThreads = nullptr;
+static ThreadStats_t s_Shared;
+static D2V_THREAD_LOCAL ThreadStats_t *t_pStats = nullptr;
+
+// For turning cycles into time. The TSC is invariant on anything that runs Dota.
+static const uint64_t s_StartCycles = __rdtsc();
+static const std::chrono::steady_clock::time_point s_StartTime = std::chrono::steady_clock::now();
+
+void StatsRegisterThread()
+{
+	if (t_pStats)
+		return;
+
+	ThreadStats_t *pStats = new ThreadStats_t;
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	pStats->pNext = s_pThreads;
+	s_pThreads = pStats;
+	t_pStats = pStats;
+}
+
+void StatsRecord(StatId_t id, VMType v, uint64_t cycles)
+{
+	if (t_pStats)
+	{
+		Record(t_pStats->stats[VMSlot(v)][id], cycles);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	Record(s_Shared.stats[VMSlot(v)][id], cycles);
+}
+
+struct StatSummary_t
+{
+	uint64_t count;
+	uint64_t cycles;
+	uint64_t maxCycles;
+	uint64_t buckets[kBuckets];
+
+	// Lower bound of the bucket holding the given fraction of calls.
+	uint64_t Percentile(double fraction) const
+	{
+		uint64_t target = uint64_t(fraction * double(count));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < kBuckets; ++i)
+		{
+			seen += buckets[i];
+			if (seen > target)
+				return BucketLowerBound(i);
+		}
+		return maxCycles;
+	}
+};
+
+static void Summarize(StatSummary_t summary[kVMSlots][Stat_Count])
+{
+	memset(summary, 0, sizeof(StatSummary_t) * kVMSlots * Stat_Count);
+
+	auto add = [summary](const ThreadStats_t &t) {
+		for (size_t vm = 0; vm < kVMSlots; ++vm)
+		{
+			for (size_t id = 0; id < Stat_Count; ++id)
+			{
+				const StatCounters_t &s = t.stats[vm][id];
+				StatSummary_t &out = summary[vm][id];
+				out.count += s.count.load(std::memory_order_relaxed);
+				out.cycles += s.cycles.load(std::memory_order_relaxed);
+				uint64_t maxCycles = s.maxCycles.load(std::memory_order_relaxed);
+				if (maxCycles > out.maxCycles)
+					out.maxCycles = maxCycles;
+				for (size_t b = 0; b < kBuckets; ++b)
+					out.buckets[b] += s.buckets[b].load(std::memory_order_relaxed);
+			}
+		}
+	};
+
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	add(s_Shared);
+	for (ThreadStats_t *p = s_pThreads; p; p = p->pNext)
+		add(*p);
+}
+
+static double CyclesPerMicrosecond()
+{
+	double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - s_StartTime).count();
+	return us > 0.0 ? double(__rdtsc() - s_StartCycles) / us : 1.0;
+}
+
+void StatsPrint(void (*pfnLine)(const char *pszLine))
+{
+	static StatSummary_t summary[kVMSlots][Stat_Count];
+	Summarize(summary);
+	double perUs = CyclesPerMicrosecond();
+
+	char szLine[256];
+	snprintf(szLine, sizeof(szLine), "%-22s %-5s %10s %12s %10s %10s %10s %10s\n", "stat", "vm", "calls", "total ms", "p50 us", "p90 us", "p99 us", "max us");
+	pfnLine(szLine);
+
+	for (size_t id = 0; id < Stat_Count; ++id)
+	{
+		for (size_t vm = 0; vm < kVMSlots; ++vm)
+		{
+			const StatSummary_t &s = summary[vm][id];
+			if (!s.count)
+				continue;
+
+			snprintf(szLine, sizeof(szLine), "%-22s %-5s %10llu %12.3f %10.3f %10.3f %10.3f %10.3f\n",
+				s_StatNames[id], s_VMSlotNames[vm], (unsigned long long)s.count, s.cycles / perUs / 1000.0,
+				s.Percentile(0.5) / perUs, s.Percentile(0.9) / perUs, s.Percentile(0.99) / perUs, s.maxCycles / perUs);
+			pfnLine(szLine);
+		}
+	}
+}
+
+void StatsWriteJSON(const char *pszPath)
+{
+	static StatSummary_t summary[kVMSlots][Stat_Count];
+	Summarize(summary);
+	double perUs = CyclesPerMicrosecond();
+
+	OutputBuffer out;
+	JSONStreamWriter writer(out);
+	writer.BeginObject();
+	writer.Key("cycles_per_us");
+	writer.Real(perUs);
+	writer.Key("stats");
+	writer.BeginObject();
+	for (size_t id = 0; id < Stat_Count; ++id)
+	{
+		writer.Key(s_StatNames[id]);
+		writer.BeginObject();
+		for (size_t vm = 0; vm < kVMSlots; ++vm)
+		{
+			const StatSummary_t &s = summary[vm][id];
+			if (!s.count)
+				continue;
+
+			writer.Key(s_VMSlotNames[vm]);
+			writer.BeginObject();
+			writer.Key("calls");
+			writer.Integer(int64_t(s.count));
+			writer.Key("total_us");
+			writer.Real(s.cycles / perUs);
+			writer.Key("p50_us");
+			writer.Real(s.Percentile(0.5) / perUs);
+			writer.Key("p90_us");
+			writer.Real(s.Percentile(0.9) / perUs);
+			writer.Key("p99_us");
+			writer.Real(s.Percentile(0.99) / perUs);
+			writer.Key("max_us");
+			writer.Real(s.maxCycles / perUs);
+			writer.Key("histogram_cycles");
+			writer.BeginArray();
+			for (size_t b = 0; b < kBuckets; ++b)
+			{
+				if (!s.buckets[b])
+					continue;
+
+				// [lower bound, calls]
+				writer.BeginArray();
+				writer.Integer(int64_t(BucketLowerBound(b)));
+				writer.Integer(int64_t(s.buckets[b]));
+				writer.EndArray();
+			}
+			writer.EndArray();
+			writer.EndObject();
+		}
+		writer.EndObject();
+	}
+	writer.EndObject();
+	writer.EndObject();
+
+	FileHandle_t f = filesystem->Open(pszPath, "w", "DEFAULT_WRITE_PATH");
+	if (f == FILESYSTEM_INVALID_HANDLE)
+		return;
+
+	filesystem->Write(out.Data(), (int)out.Size(), f);
+	filesystem->Close(f);
+}
+
+#else
+
+void StatsPrint(void (*pfnLine)(const char *pszLine))
+{
+	pfnLine("D2V: Stats were compiled out (D2V_STATS=0)\n");
+}
+
+void StatsWriteJSON(const char *pszPath)
+{
+}
+
+#endif
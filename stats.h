@@ -0,0 +1,100 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "common.h"
+
+// Hook, model and dumper instrumentation. Build with D2V_STATS=0 to compile it out entirely.
+#ifndef D2V_STATS
+#define D2V_STATS 1
+#endif
+
+enum StatId_t
+{
+	Stat_CreateVM,
+	Stat_DestroyVM,
+	Stat_RegisterFunction,
+	Stat_RegisterScriptClass,
+	Stat_RegisterInstance,
+	Stat_SetValue1,
+	Stat_SetValue2,
+	Stat_SetValue3,
+	Stat_SetEnumValue,
+
+	Stat_ModelClear,
+	Stat_ModelAddClass,
+	Stat_ModelAddFunction,
+	Stat_ModelAddValue,
+	Stat_ModelAddEnumValue,
+	Stat_DumperSaveFunctions,
+	Stat_DumperSaveValues,
+
+	Stat_Count
+};
+
+#if D2V_STATS
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Gives the calling thread its own counters, so recording never contends. Meant for the long
+// lived threads doing the hot work; any other thread records into a shared, locked set.
+void StatsRegisterThread();
+void StatsRecord(StatId_t id, VMType v, uint64_t cycles);
+
+// Times its scope in TSC cycles. The VM can be filled in later, once it's known.
+class StatScope
+{
+public:
+	StatScope(StatId_t id, VMType v = VM_Unknown) : m_Id(id), m_VM(v), m_Start(__rdtsc()) {}
+	~StatScope() { StatsRecord(m_Id, m_VM, __rdtsc() - m_Start); }
+
+	void SetVM(VMType v) { m_VM = v; }
+
+private:
+	StatId_t m_Id;
+	VMType m_VM;
+	uint64_t m_Start;
+};
+
+#define D2V_STAT_SCOPE(id, v) StatScope d2vStatScope(id, v)
+#define D2V_STAT_SET_VM(v) d2vStatScope.SetVM(v)
+
+#else
+
+inline void StatsRegisterThread() {}
+
+#define D2V_STAT_SCOPE(id, v)
+#define D2V_STAT_SET_VM(v)
+
+#endif
+
+// Both are no-ops, bar a note, when stats are compiled out.
+void StatsPrint(void (*pfnLine)(const char *pszLine));
+void StatsWriteJSON(const char *pszPath);
@@ -0,0 +1,152 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "stringpool.h"
+
+#include <cstdlib>
+#include <utility>
+
+static const size_t kInitialDataSize = 16 * 1024;
+static const size_t kInitialSlotCount = 1024;
+
+StringPool::StringPool()
+	: m_Used(1), m_Capacity(kInitialDataSize), m_SlotCount(kInitialSlotCount), m_Count(0), m_Generation(1)
+{
+	m_pData = (char *)malloc(m_Capacity);
+	m_pData[0] = 0;
+	m_pSlots = (Slot_t *)calloc(m_SlotCount, sizeof(Slot_t));
+}
+
+StringPool::StringPool(const StringPool &other)
+	: m_Used(other.m_Used), m_Capacity(other.m_Capacity), m_SlotCount(other.m_SlotCount), m_Count(other.m_Count), m_Generation(other.m_Generation)
+{
+	m_pData = (char *)malloc(m_Capacity);
+	memcpy(m_pData, other.m_pData, m_Used);
+	m_pSlots = (Slot_t *)malloc(m_SlotCount * sizeof(Slot_t));
+	memcpy(m_pSlots, other.m_pSlots, m_SlotCount * sizeof(Slot_t));
+}
+
+StringPool &StringPool::operator=(const StringPool &other)
+{
+	if (this != &other)
+	{
+		StringPool copy(other);
+		std::swap(m_pData, copy.m_pData);
+		std::swap(m_Used, copy.m_Used);
+		std::swap(m_Capacity, copy.m_Capacity);
+		std::swap(m_pSlots, copy.m_pSlots);
+		std::swap(m_SlotCount, copy.m_SlotCount);
+		std::swap(m_Count, copy.m_Count);
+		std::swap(m_Generation, copy.m_Generation);
+	}
+	return *this;
+}
+
+StringPool::~StringPool()
+{
+	free(m_pData);
+	free(m_pSlots);
+}
+
+void StringPool::Reset()
+{
+	m_Used = 1;
+	m_Count = 0;
+
+	if (++m_Generation == 0)
+	{
+		memset(m_pSlots, 0, m_SlotCount * sizeof(Slot_t));
+		m_Generation = 1;
+	}
+}
+
+StringId StringPool::Append(const char *psz, size_t len)
+{
+	if (m_Used + len + 1 > m_Capacity)
+	{
+		while (m_Used + len + 1 > m_Capacity)
+			m_Capacity *= 2;
+
+		m_pData = (char *)realloc(m_pData, m_Capacity);
+	}
+
+	StringId id = StringId(m_Used);
+	memcpy(&m_pData[m_Used], psz, len);
+	m_pData[m_Used + len] = 0;
+	m_Used += len + 1;
+
+	return id;
+}
+
+void StringPool::GrowSlots()
+{
+	size_t newCount = m_SlotCount * 2;
+	Slot_t *pNewSlots = (Slot_t *)calloc(newCount, sizeof(Slot_t));
+
+	for (size_t i = 0; i < m_SlotCount; ++i)
+	{
+		const Slot_t &slot = m_pSlots[i];
+		if (slot.generation != m_Generation)
+			continue;
+
+		size_t j = slot.hash & (newCount - 1);
+		while (pNewSlots[j].generation == m_Generation)
+			j = (j + 1) & (newCount - 1);
+
+		pNewSlots[j] = slot;
+	}
+
+	free(m_pSlots);
+	m_pSlots = pNewSlots;
+	m_SlotCount = newCount;
+}
+
+StringId StringPool::Intern(const char *psz, size_t len)
+{
+	if (!len)
+		return kEmptyString;
+
+	uint32_t hash = HashString(psz, len);
+	size_t mask = m_SlotCount - 1;
+
+	size_t i = hash & mask;
+	for (; m_pSlots[i].generation == m_Generation; i = (i + 1) & mask)
+	{
+		const Slot_t &slot = m_pSlots[i];
+		if (slot.hash == hash && !strncmp(Get(slot.id), psz, len) && !Get(slot.id)[len])
+			return slot.id;
+	}
+
+	StringId id = Append(psz, len);
+	m_pSlots[i].hash = hash;
+	m_pSlots[i].generation = m_Generation;
+	m_pSlots[i].id = id;
+
+	// Keep the load factor under 3/4.
+	if (++m_Count * 4 > m_SlotCount * 3)
+		GrowSlots();
+
+	return id;
+}
@@ -0,0 +1,96 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "common.h"
+
+#include <cstring>
+
+// Offset of a string inside a StringPool. Stays valid across pool growth, but not across Reset().
+typedef uint32_t StringId;
+
+// Id 0 always refers to the empty string.
+static const StringId kEmptyString = 0;
+
+// FNV-1a
+inline uint32_t HashString(const char *psz, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i)
+	{
+		hash ^= (unsigned char)psz[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Bump-allocated, null terminated string storage with an interning table, so each distinct
+// string is stored exactly once. Reset() drops everything in O(1) and keeps the memory for reuse.
+class StringPool
+{
+public:
+	StringPool();
+	StringPool(const StringPool &other);
+	StringPool &operator=(const StringPool &other);
+	~StringPool();
+
+	StringId Intern(const char *psz) { return psz ? Intern(psz, strlen(psz)) : kEmptyString; }
+	StringId Intern(const char *psz, size_t len);
+	// Stores a copy without interning it, for callers that do their own deduplication.
+	StringId Add(const char *psz, size_t len) { return len ? Append(psz, len) : kEmptyString; }
+	const char *Get(StringId id) const { return &m_pData[id]; }
+
+	void Reset();
+
+	// Raw storage, for dumpers that write the pool out as a string table.
+	const char *Data() const { return m_pData; }
+	size_t Size() const { return m_Used; }
+	// Bytes allocated, including room not yet used.
+	size_t MemoryUsage() const { return m_Capacity + m_SlotCount * sizeof(Slot_t); }
+
+private:
+	struct Slot_t
+	{
+		uint32_t hash;
+		uint32_t generation;
+		StringId id;
+	};
+
+	StringId Append(const char *psz, size_t len);
+	void GrowSlots();
+
+private:
+	char *m_pData;
+	size_t m_Used;
+	size_t m_Capacity;
+
+	Slot_t *m_pSlots;
+	size_t m_SlotCount;
+	size_t m_Count;
+
+	// Slots stamped with an older generation are empty, which is what makes Reset() O(1).
+	uint32_t m_Generation;
+};
@@ -0,0 +1,143 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumphash.h"
+
+#include <cstring>
+
+namespace
+{
+	// FNV-1a, run over each field in turn with a separator so field boundaries count.
+	class Hasher
+	{
+	public:
+		Hasher() : m_Hash(14695981039346656037ull) {}
+
+		void Bytes(const void *p, size_t len)
+		{
+			const unsigned char *pBytes = (const unsigned char *)p;
+			for (size_t i = 0; i < len; ++i)
+			{
+				m_Hash ^= pBytes[i];
+				m_Hash *= 1099511628211ull;
+			}
+		}
+
+		// Null (kVDBNoString) hashes differently from the empty string.
+		void String(const char *psz)
+		{
+			if (psz)
+				Bytes(psz, strlen(psz) + 1);
+			else
+				Value(uint8_t(0xFF));
+		}
+
+		template <typename T>
+		void Value(T value) { Bytes(&value, sizeof(value)); }
+
+		uint64_t Get() const { return m_Hash; }
+
+	private:
+		uint64_t m_Hash;
+	};
+
+	// Combines the hashes of a run of records, in order.
+	uint64_t HashRange(const std::vector<uint64_t> &hashes, const VDBRange_t &range)
+	{
+		Hasher h;
+		for (uint32_t i = 0; i < range.count; ++i)
+			h.Value(hashes[range.first + i]);
+		h.Value(range.count);
+		return h.Get();
+	}
+}
+
+void DumpHashes::Compute(const DumpReader &reader)
+{
+	const VDBHeader_t &header = reader.Header();
+
+	m_Functions.resize(header.functions.count);
+	for (uint32_t i = 0; i < header.functions.count; ++i)
+	{
+		const VDBFunction_t &func = reader.Functions()[i];
+
+		Hasher h;
+		h.String(reader.String(func.name));
+		h.String(reader.String(func.description));
+		h.String(reader.String(func.returnType));
+		h.Value(func.flags);
+		h.Value(func.params.count);
+		for (uint32_t p = 0; p < func.params.count; ++p)
+		{
+			const VDBParam_t &param = reader.Params()[func.params.first + p];
+			h.String(reader.String(param.name));
+			h.String(reader.String(param.type));
+		}
+		m_Functions[i] = h.Get();
+	}
+
+	m_Classes.resize(header.classes.count);
+	for (uint32_t i = 0; i < header.classes.count; ++i)
+	{
+		const VDBClass_t &scriptClass = reader.Classes()[i];
+
+		Hasher h;
+		h.String(reader.String(scriptClass.name));
+		h.String(reader.String(scriptClass.description));
+		h.String(reader.String(scriptClass.base));
+		h.Value(HashRange(m_Functions, scriptClass.functions));
+		m_Classes[i] = h.Get();
+	}
+	m_GlobalFunctions = HashRange(m_Functions, header.globalFunctions);
+
+	m_Constants.resize(header.constants.count);
+	for (uint32_t i = 0; i < header.constants.count; ++i)
+	{
+		const VDBConstant_t &k = reader.Constants()[i];
+
+		Hasher h;
+		h.String(reader.String(k.name));
+		h.String(reader.String(k.description));
+		h.String(reader.String(k.scope));
+		h.Value(uint32_t(k.kind));
+		if (k.kind == VDBValue_String)
+			h.String(reader.String(k.str));
+		else
+			h.Bytes(k.vec, sizeof(k.vec));
+		m_Constants[i] = h.Get();
+	}
+
+	m_Enums.resize(header.enums.count);
+	for (uint32_t i = 0; i < header.enums.count; ++i)
+	{
+		const VDBEnum_t &e = reader.Enums()[i];
+
+		Hasher h;
+		h.String(reader.String(e.name));
+		h.Value(HashRange(m_Constants, e.constants));
+		m_Enums[i] = h.Get();
+	}
+	m_GlobalConstants = HashRange(m_Constants, header.globalConstants);
+}
@@ -0,0 +1,57 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "dumpreader.h"
+
+#include <cstdint>
+#include <vector>
+
+// 64-bit content hashes of every entity in a dump. They only depend on the contents, not on
+// where things sit in the file, so equal hashes across two dumps mean equal entities and
+// whole classes or enums can be compared at once.
+class DumpHashes
+{
+public:
+	void Compute(const DumpReader &reader);
+
+	// Indexed like the reader's records.
+	uint64_t Class(uint32_t i) const { return m_Classes[i]; }
+	uint64_t Function(uint32_t i) const { return m_Functions[i]; }
+	uint64_t Enum(uint32_t i) const { return m_Enums[i]; }
+	uint64_t Constant(uint32_t i) const { return m_Constants[i]; }
+
+	uint64_t GlobalFunctions() const { return m_GlobalFunctions; }
+	uint64_t GlobalConstants() const { return m_GlobalConstants; }
+
+private:
+	std::vector<uint64_t> m_Classes;
+	std::vector<uint64_t> m_Functions;
+	std::vector<uint64_t> m_Enums;
+	std::vector<uint64_t> m_Constants;
+	uint64_t m_GlobalFunctions;
+	uint64_t m_GlobalConstants;
+};
@@ -0,0 +1,433 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumpreader.h"
+#include "jsonparser.h"
+#include "vdbbuilder.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef D2V_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+DumpReader::DumpReader()
+	: m_pMapping(nullptr), m_MappingSize(0), m_pData(nullptr), m_Size(0), m_pHeader(nullptr), m_pClasses(nullptr),
+	m_pFunctions(nullptr), m_pParams(nullptr), m_pEnums(nullptr), m_pConstants(nullptr), m_pStrings(nullptr)
+{
+}
+
+DumpReader::~DumpReader()
+{
+	Close();
+}
+
+bool DumpReader::Fail(const std::string &what)
+{
+	m_Error = what;
+	Close();
+	return false;
+}
+
+void DumpReader::Close()
+{
+	if (m_pMapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pMapping);
+#else
+		munmap(m_pMapping, m_MappingSize);
+#endif
+		m_pMapping = nullptr;
+		m_MappingSize = 0;
+	}
+
+	std::vector<char>().swap(m_Built);
+	m_pData = nullptr;
+	m_Size = 0;
+	m_pHeader = nullptr;
+}
+
+bool DumpReader::Open(const char *pszPath, const char *pszValuesPath)
+{
+	Close();
+	m_Error.clear();
+
+	size_t len = strlen(pszPath);
+	bool bJSON = (len >= 5 && !strcmp(pszPath + len - 5, ".json")) || (len >= 8 && !strcmp(pszPath + len - 8, ".json.gz"));
+	if (!(bJSON ? OpenJSON(pszPath, pszValuesPath) : OpenBinary(pszPath)))
+		return false;
+
+	if (!Validate())
+	{
+		m_Error = std::string(pszPath) + ": " + m_Error;
+		return false;
+	}
+
+	return true;
+}
+
+bool DumpReader::Open(const VDBBuilder &builder)
+{
+	Close();
+	m_Error.clear();
+
+	builder.Build(m_Built);
+	m_pData = m_Built.data();
+	m_Size = m_Built.size();
+	return Validate();
+}
+
+bool DumpReader::OpenBinary(const char *pszPath)
+{
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(pszPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return Fail(std::string("cannot open ") + pszPath);
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(hFile, &size);
+	HANDLE hMapping = size.QuadPart ? CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	CloseHandle(hFile);
+	if (!hMapping)
+		return Fail(std::string("cannot map ") + pszPath);
+
+	// The view keeps the mapping alive on its own.
+	m_pMapping = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(hMapping);
+	m_MappingSize = size_t(size.QuadPart);
+#else
+	int fd = open(pszPath, O_RDONLY);
+	if (fd < 0)
+		return Fail(std::string("cannot open ") + pszPath);
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return Fail(std::string("cannot map ") + pszPath);
+	}
+
+	void *p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	m_pMapping = p == MAP_FAILED ? nullptr : p;
+	m_MappingSize = size_t(st.st_size);
+#endif
+
+	if (!m_pMapping)
+		return Fail(std::string("cannot map ") + pszPath);
+
+	m_pData = (const char *)m_pMapping;
+	m_Size = m_MappingSize;
+	return true;
+}
+
+static bool ReadWholeFile(const char *pszPath, std::vector<char> &out)
+{
+	FILE *f = fopen(pszPath, "rb");
+	if (!f)
+		return false;
+
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	// One spare byte for the parser to terminate with.
+	out.resize(size_t(size < 0 ? 0 : size) + 1);
+	bool bOK = size >= 0 && fread(out.data(), 1, size_t(size), f) == size_t(size);
+	fclose(f);
+
+	out.back() = 0;
+	return bOK;
+}
+
+static bool IsGzipPath(const char *pszPath)
+{
+	size_t len = strlen(pszPath);
+	return len >= 3 && !strcmp(pszPath + len - 3, ".gz");
+}
+
+#ifdef D2V_ZLIB
+// As ReadWholeFile, for the .json.gz files vdump_compress writes.
+static bool ReadGzipFile(const char *pszPath, std::vector<char> &out)
+{
+	gzFile f = gzopen(pszPath, "rb");
+	if (!f)
+		return false;
+
+	out.clear();
+	bool bOK = true;
+	char buffer[64 * 1024];
+	for (;;)
+	{
+		int n = gzread(f, buffer, sizeof(buffer));
+		if (n <= 0)
+		{
+			bOK = n == 0;
+			break;
+		}
+		out.insert(out.end(), buffer, buffer + n);
+	}
+	bOK = gzclose(f) == Z_OK && bOK;
+
+	out.push_back(0);
+	return bOK;
+}
+#endif
+
+bool DumpReader::OpenJSON(const char *pszPath, const char *pszValuesPath)
+{
+	VDBBuilder builder;
+
+	// Dumps are named out<vm>.json(.gz), so the VM can be recovered from the name.
+	const char *pszBase = strrchr(pszPath, '/');
+	const char *pszBase2 = strrchr(pszPath, '\\');
+	pszBase = pszBase2 > pszBase ? pszBase2 : pszBase;
+	pszBase = pszBase ? pszBase + 1 : pszPath;
+	unsigned vm;
+	if (sscanf(pszBase, "out%u", &vm) == 1)
+		builder.m_VM = vm;
+
+	const char *paths[] = { pszPath, pszValuesPath };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (!paths[i])
+			continue;
+
+		std::vector<char> text;
+		if (IsGzipPath(paths[i]))
+		{
+#ifdef D2V_ZLIB
+			if (!ReadGzipFile(paths[i], text))
+				return Fail(std::string("cannot read ") + paths[i]);
+#else
+			return Fail(std::string("cannot read ") + paths[i] + ": built without zlib");
+#endif
+		}
+		else if (!ReadWholeFile(paths[i], text))
+			return Fail(std::string("cannot read ") + paths[i]);
+
+		JSONDocument doc;
+		if (!doc.Parse(text.data(), text.size() - 1))
+			return Fail(std::string(paths[i]) + ": " + doc.Error());
+
+		if (!(i == 0 ? builder.AddFunctionsJSON(doc) : builder.AddValuesJSON(doc)))
+			return Fail(std::string(paths[i]) + ": " + builder.Error());
+	}
+
+	builder.Build(m_Built);
+	m_pData = m_Built.data();
+	m_Size = m_Built.size();
+	return true;
+}
+
+bool DumpReader::Validate()
+{
+	// Checked once up front, so lookups can trust every offset and range.
+	if (m_Size < sizeof(VDBHeader_t))
+		return Fail("file is too small for a dump");
+
+	const VDBHeader_t &header = *(const VDBHeader_t *)m_pData;
+	if (header.magic != kVDBMagic)
+		return Fail("not a binary dump");
+	if (header.version != kVDBVersion)
+		return Fail("unsupported binary dump version");
+	if (header.fileSize != m_Size)
+		return Fail("dump is truncated or has trailing data");
+
+	auto sectionOK = [&header](const VDBSection_t &section, size_t recordSize) {
+		return section.offset % 4 == 0 && section.offset >= sizeof(VDBHeader_t) && section.offset <= header.fileSize
+			&& section.count <= (header.fileSize - section.offset) / recordSize;
+	};
+	if (!sectionOK(header.classes, sizeof(VDBClass_t)) || !sectionOK(header.functions, sizeof(VDBFunction_t))
+		|| !sectionOK(header.params, sizeof(VDBParam_t)) || !sectionOK(header.enums, sizeof(VDBEnum_t))
+		|| !sectionOK(header.constants, sizeof(VDBConstant_t)) || !sectionOK(header.strings, 1))
+	{
+		return Fail("dump has a section outside of the file");
+	}
+
+	const char *pStrings = m_pData + header.strings.offset;
+	uint32_t stringsSize = header.strings.count;
+	if (!stringsSize || pStrings[stringsSize - 1] != 0)
+		return Fail("dump string table is not terminated");
+
+	auto stringOK = [stringsSize](uint32_t offset, bool bOptional) {
+		return offset < stringsSize || (bOptional && offset == kVDBNoString);
+	};
+	auto rangeOK = [](const VDBRange_t &range, uint32_t count) {
+		return range.first <= count && range.count <= count - range.first;
+	};
+
+	m_pHeader = &header;
+	m_pClasses = (const VDBClass_t *)(m_pData + header.classes.offset);
+	m_pFunctions = (const VDBFunction_t *)(m_pData + header.functions.offset);
+	m_pParams = (const VDBParam_t *)(m_pData + header.params.offset);
+	m_pEnums = (const VDBEnum_t *)(m_pData + header.enums.offset);
+	m_pConstants = (const VDBConstant_t *)(m_pData + header.constants.offset);
+	m_pStrings = pStrings;
+
+	for (uint32_t i = 0; i < header.classes.count; ++i)
+	{
+		const VDBClass_t &c = m_pClasses[i];
+		if (!stringOK(c.name, false) || !stringOK(c.description, true) || !stringOK(c.base, true)
+			|| !rangeOK(c.functions, header.functions.count))
+			return Fail("dump has a malformed class");
+	}
+	if (!rangeOK(header.globalFunctions, header.functions.count))
+		return Fail("dump has malformed global functions");
+
+	for (uint32_t i = 0; i < header.functions.count; ++i)
+	{
+		const VDBFunction_t &f = m_pFunctions[i];
+		if (!stringOK(f.name, false) || !stringOK(f.description, false) || !stringOK(f.returnType, false)
+			|| !rangeOK(f.params, header.params.count))
+			return Fail("dump has a malformed function");
+	}
+
+	for (uint32_t i = 0; i < header.params.count; ++i)
+	{
+		if (!stringOK(m_pParams[i].name, true) || !stringOK(m_pParams[i].type, false))
+			return Fail("dump has a malformed parameter");
+	}
+
+	for (uint32_t i = 0; i < header.enums.count; ++i)
+	{
+		if (!stringOK(m_pEnums[i].name, false) || !rangeOK(m_pEnums[i].constants, header.constants.count))
+			return Fail("dump has a malformed enum");
+	}
+	if (!rangeOK(header.globalConstants, header.constants.count))
+		return Fail("dump has malformed global constants");
+
+	for (uint32_t i = 0; i < header.constants.count; ++i)
+	{
+		const VDBConstant_t &k = m_pConstants[i];
+		if (!stringOK(k.name, false) || !stringOK(k.description, false) || !stringOK(k.scope, true) || (k.kind == VDBValue_String && !stringOK(k.str, false)))
+			return Fail("dump has a malformed constant");
+	}
+
+	return true;
+}
+
+std::string DumpReader::ConstantPath(const VDBConstant_t &constant) const
+{
+	const char *pszName = String(constant.name);
+	if (constant.scope == kVDBNoString)
+		return pszName;
+
+	std::string path = String(constant.scope);
+	if (pszName[0] != '[')
+		path += '.';
+	return path + pszName;
+}
+
+// First record in [first, first + count) whose name is not less than pszName.
+template <typename T>
+static uint32_t LowerBound(const T *pRecords, const VDBRange_t &range, const char *pStrings, const char *pszName)
+{
+	uint32_t lo = range.first;
+	uint32_t hi = range.first + range.count;
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (strcmp(pStrings + pRecords[mid].name, pszName) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+template <typename T>
+static const T *Find(const T *pRecords, const VDBRange_t &range, const char *pStrings, const char *pszName)
+{
+	uint32_t i = LowerBound(pRecords, range, pStrings, pszName);
+	if (i < range.first + range.count && !strcmp(pStrings + pRecords[i].name, pszName))
+		return &pRecords[i];
+
+	return nullptr;
+}
+
+template <typename T>
+static VDBRange_t PrefixRange(const T *pRecords, const VDBRange_t &range, const char *pStrings, const char *pszPrefix)
+{
+	size_t len = strlen(pszPrefix);
+	uint32_t first = LowerBound(pRecords, range, pStrings, pszPrefix);
+
+	// Names with the prefix are contiguous from first on, and everything after them compares greater.
+	uint32_t lo = first;
+	uint32_t hi = range.first + range.count;
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (strncmp(pStrings + pRecords[mid].name, pszPrefix, len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	VDBRange_t result = { first, lo - first };
+	return result;
+}
+
+const VDBClass_t *DumpReader::FindClass(const char *pszName) const
+{
+	return Find(m_pClasses, AllClasses(), m_pStrings, pszName);
+}
+
+const VDBEnum_t *DumpReader::FindEnum(const char *pszName) const
+{
+	return Find(m_pEnums, AllEnums(), m_pStrings, pszName);
+}
+
+const VDBFunction_t *DumpReader::FindFunction(const VDBRange_t &functions, const char *pszName) const
+{
+	return Find(m_pFunctions, functions, m_pStrings, pszName);
+}
+
+VDBRange_t DumpReader::ClassesWithPrefix(const char *pszPrefix) const
+{
+	return PrefixRange(m_pClasses, AllClasses(), m_pStrings, pszPrefix);
+}
+
+VDBRange_t DumpReader::EnumsWithPrefix(const char *pszPrefix) const
+{
+	return PrefixRange(m_pEnums, AllEnums(), m_pStrings, pszPrefix);
+}
+
+VDBRange_t DumpReader::FunctionsWithPrefix(const VDBRange_t &functions, const char *pszPrefix) const
+{
+	return PrefixRange(m_pFunctions, functions, m_pStrings, pszPrefix);
+}
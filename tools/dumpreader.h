@@ -0,0 +1,101 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "../binaryformat.h"
+
+#include <string>
+#include <vector>
+
+class VDBBuilder;
+
+// Read-only view of one VM's dump in the layout from binaryformat.h. A .vdb file is mapped
+// and used in place; JSON dumps are converted into the same layout in memory first. Either
+// way every lookup is a binary search straight over the records.
+class DumpReader
+{
+public:
+	DumpReader();
+	~DumpReader();
+
+	// pszValuesPath is only used with JSON dumps, whose values live in a file of their own.
+	bool Open(const char *pszPath, const char *pszValuesPath = nullptr);
+	// A dump that only exists in memory, e.g. one recovered from a journal.
+	bool Open(const VDBBuilder &builder);
+	void Close();
+	const char *Error() const { return m_Error.c_str(); }
+
+	const VDBHeader_t &Header() const { return *m_pHeader; }
+
+	// Null for kVDBNoString.
+	const char *String(uint32_t offset) const { return offset == kVDBNoString ? nullptr : m_pStrings + offset; }
+	// The constant's name, after its scope if it has one: "name", "Scope.name" or "Scope[2]".
+	std::string ConstantPath(const VDBConstant_t &constant) const;
+
+	const VDBClass_t *Classes() const { return m_pClasses; }
+	const VDBFunction_t *Functions() const { return m_pFunctions; }
+	const VDBParam_t *Params() const { return m_pParams; }
+	const VDBEnum_t *Enums() const { return m_pEnums; }
+	const VDBConstant_t *Constants() const { return m_pConstants; }
+
+	VDBRange_t AllClasses() const { return { 0, m_pHeader->classes.count }; }
+	VDBRange_t AllEnums() const { return { 0, m_pHeader->enums.count }; }
+
+	const VDBClass_t *FindClass(const char *pszName) const;
+	const VDBEnum_t *FindEnum(const char *pszName) const;
+	// Within a class's functions or Header().globalFunctions.
+	const VDBFunction_t *FindFunction(const VDBRange_t &functions, const char *pszName) const;
+
+	// The run of entries whose names start with pszPrefix.
+	VDBRange_t ClassesWithPrefix(const char *pszPrefix) const;
+	VDBRange_t EnumsWithPrefix(const char *pszPrefix) const;
+	VDBRange_t FunctionsWithPrefix(const VDBRange_t &functions, const char *pszPrefix) const;
+
+private:
+	bool OpenBinary(const char *pszPath);
+	bool OpenJSON(const char *pszPath, const char *pszValuesPath);
+	bool Validate();
+	bool Fail(const std::string &what);
+
+private:
+	std::string m_Error;
+
+	// Exactly one of these backs the view.
+	void *m_pMapping;
+	size_t m_MappingSize;
+	std::vector<char> m_Built;
+
+	const char *m_pData;
+	size_t m_Size;
+
+	const VDBHeader_t *m_pHeader;
+	const VDBClass_t *m_pClasses;
+	const VDBFunction_t *m_pFunctions;
+	const VDBParam_t *m_pParams;
+	const VDBEnum_t *m_pEnums;
+	const VDBConstant_t *m_pConstants;
+	const char *m_pStrings;
+};
@@ -0,0 +1,354 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "jsonparser.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool JSONDocument::Parse(char *pData, size_t len)
+{
+	m_Nodes.clear();
+	m_Nodes.reserve(len / 16);
+	m_pCur = pData;
+	m_pEnd = pData + len;
+	m_szError[0] = 0;
+
+	SkipSpace();
+	if (!ParseValue(0))
+		return false;
+
+	SkipSpace();
+	if (m_pCur != m_pEnd)
+		return Fail("trailing data after the document");
+
+	return true;
+}
+
+const JSONNode_t *JSONDocument::Member(const JSONNode_t &object, const char *pszKey) const
+{
+	if (object.type != JSONNode_t::Object)
+		return nullptr;
+
+	const JSONNode_t *pFound = nullptr;
+	for (const JSONNode_t *pChild = FirstChild(object); pChild; pChild = NextSibling(*pChild, object))
+	{
+		if (!strcmp(pChild->pszKey, pszKey))
+			pFound = pChild;
+	}
+	return pFound;
+}
+
+void JSONDocument::SkipSpace()
+{
+	while (m_pCur < m_pEnd && (*m_pCur == ' ' || *m_pCur == '\t' || *m_pCur == '\n' || *m_pCur == '\r'))
+		++m_pCur;
+}
+
+bool JSONDocument::Fail(const char *pszWhat)
+{
+	if (!m_szError[0])
+		snprintf(m_szError, sizeof(m_szError), "%s", pszWhat);
+	return false;
+}
+
+bool JSONDocument::ParseValue(uint32_t depth)
+{
+	if (depth > kMaxDepth)
+		return Fail("document nested too deeply");
+	if (m_pCur == m_pEnd)
+		return Fail("unexpected end of document");
+
+	uint32_t index = uint32_t(m_Nodes.size());
+	m_Nodes.push_back(JSONNode_t());
+	m_Nodes[index].pszKey = "";
+
+	char c = *m_pCur;
+	if (c == '{' || c == '[')
+	{
+		bool bObject = c == '{';
+		char close = bObject ? '}' : ']';
+		uint32_t count = 0;
+
+		++m_pCur;
+		SkipSpace();
+		if (m_pCur < m_pEnd && *m_pCur == close)
+		{
+			++m_pCur;
+		}
+		else
+		{
+			for (;;)
+			{
+				const char *pszKey = "";
+				uint32_t keyLen = 0;
+				if (bObject)
+				{
+					if (m_pCur == m_pEnd || *m_pCur != '"')
+						return Fail("expected an object key");
+					if (!ParseString(pszKey, keyLen))
+						return false;
+
+					SkipSpace();
+					if (m_pCur == m_pEnd || *m_pCur != ':')
+						return Fail("expected ':' after an object key");
+					++m_pCur;
+					SkipSpace();
+				}
+
+				uint32_t child = uint32_t(m_Nodes.size());
+				if (!ParseValue(depth + 1))
+					return false;
+
+				m_Nodes[child].pszKey = pszKey;
+				m_Nodes[child].keyLen = keyLen;
+				++count;
+
+				SkipSpace();
+				if (m_pCur == m_pEnd)
+					return Fail("unexpected end of document");
+				if (*m_pCur == close)
+				{
+					++m_pCur;
+					break;
+				}
+				if (*m_pCur != ',')
+					return Fail(bObject ? "expected ',' or '}'" : "expected ',' or ']'");
+				++m_pCur;
+				SkipSpace();
+			}
+		}
+
+		m_Nodes[index].type = bObject ? JSONNode_t::Object : JSONNode_t::Array;
+		m_Nodes[index].count = count;
+	}
+	else if (c == '"')
+	{
+		const char *psz;
+		uint32_t len;
+		if (!ParseString(psz, len))
+			return false;
+
+		m_Nodes[index].type = JSONNode_t::String;
+		m_Nodes[index].psz = psz;
+		m_Nodes[index].len = len;
+	}
+	else if (c == '-' || (c >= '0' && c <= '9'))
+	{
+		if (!ParseNumber(m_Nodes[index]))
+			return false;
+	}
+	else
+	{
+		static const struct
+		{
+			const char *psz;
+			JSONNode_t::Type_t type;
+		} literals[] = {
+			{ "null", JSONNode_t::Null },
+			{ "true", JSONNode_t::True },
+			{ "false", JSONNode_t::False },
+		};
+
+		bool bFound = false;
+		for (auto &l : literals)
+		{
+			size_t len = strlen(l.psz);
+			if (size_t(m_pEnd - m_pCur) >= len && !memcmp(m_pCur, l.psz, len))
+			{
+				m_Nodes[index].type = l.type;
+				m_pCur += len;
+				bFound = true;
+				break;
+			}
+		}
+		if (!bFound)
+			return Fail("unexpected character");
+	}
+
+	m_Nodes[index].next = uint32_t(m_Nodes.size());
+	return true;
+}
+
+static int HexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static bool ReadHex4(const char *p, const char *pEnd, uint32_t &value)
+{
+	if (pEnd - p < 4)
+		return false;
+
+	value = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		int digit = HexDigit(p[i]);
+		if (digit < 0)
+			return false;
+		value = (value << 4) | uint32_t(digit);
+	}
+	return true;
+}
+
+bool JSONDocument::ParseString(const char *&psz, uint32_t &len)
+{
+	// Unescaped output never outgrows its input, so it is written back over it.
+	++m_pCur;
+	char *pOut = m_pCur;
+	psz = pOut;
+
+	for (;;)
+	{
+		if (m_pCur == m_pEnd)
+			return Fail("unterminated string");
+
+		char c = *m_pCur;
+		if (c == '"')
+		{
+			++m_pCur;
+			break;
+		}
+		if ((unsigned char)c < 0x20)
+			return Fail("control character in string");
+		if (c != '\\')
+		{
+			*pOut++ = *m_pCur++;
+			continue;
+		}
+
+		if (m_pEnd - m_pCur < 2)
+			return Fail("unterminated string");
+
+		char e = m_pCur[1];
+		m_pCur += 2;
+		switch (e)
+		{
+		case '"': *pOut++ = '"'; break;
+		case '\\': *pOut++ = '\\'; break;
+		case '/': *pOut++ = '/'; break;
+		case 'b': *pOut++ = '\b'; break;
+		case 'f': *pOut++ = '\f'; break;
+		case 'n': *pOut++ = '\n'; break;
+		case 'r': *pOut++ = '\r'; break;
+		case 't': *pOut++ = '\t'; break;
+		case 'u':
+		{
+			uint32_t cp;
+			if (!ReadHex4(m_pCur, m_pEnd, cp))
+				return Fail("bad \\u escape");
+			m_pCur += 4;
+
+			uint32_t low;
+			if (cp >= 0xD800 && cp <= 0xDBFF && m_pEnd - m_pCur >= 6 && m_pCur[0] == '\\' && m_pCur[1] == 'u'
+				&& ReadHex4(m_pCur + 2, m_pEnd, low) && low >= 0xDC00 && low <= 0xDFFF)
+			{
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+				m_pCur += 6;
+			}
+
+			if (cp < 0x80)
+			{
+				*pOut++ = char(cp);
+			}
+			else if (cp < 0x800)
+			{
+				*pOut++ = char(0xC0 | (cp >> 6));
+				*pOut++ = char(0x80 | (cp & 0x3F));
+			}
+			else if (cp < 0x10000)
+			{
+				*pOut++ = char(0xE0 | (cp >> 12));
+				*pOut++ = char(0x80 | ((cp >> 6) & 0x3F));
+				*pOut++ = char(0x80 | (cp & 0x3F));
+			}
+			else
+			{
+				*pOut++ = char(0xF0 | (cp >> 18));
+				*pOut++ = char(0x80 | ((cp >> 12) & 0x3F));
+				*pOut++ = char(0x80 | ((cp >> 6) & 0x3F));
+				*pOut++ = char(0x80 | (cp & 0x3F));
+			}
+			break;
+		}
+		default:
+			return Fail("bad escape in string");
+		}
+	}
+
+	len = uint32_t(pOut - psz);
+	*pOut = 0;
+	return true;
+}
+
+bool JSONDocument::ParseNumber(JSONNode_t &node)
+{
+	char *pStart = m_pCur;
+	bool bReal = false;
+	while (m_pCur < m_pEnd)
+	{
+		char c = *m_pCur;
+		if (c == '.' || c == 'e' || c == 'E')
+			bReal = true;
+		else if (!(c == '-' || c == '+' || (c >= '0' && c <= '9')))
+			break;
+		++m_pCur;
+	}
+
+	// strtod and strtoll need a terminator, so borrow the character after the number.
+	char saved = *m_pCur;
+	*m_pCur = 0;
+
+	char *pParsed;
+	errno = 0;
+	if (!bReal)
+	{
+		node.type = JSONNode_t::Integer;
+		node.i = strtoll(pStart, &pParsed, 10);
+		// Out of range for 64 bits, so keep it as a real like other parsers do.
+		if (errno == ERANGE)
+			bReal = true;
+	}
+	if (bReal)
+	{
+		node.type = JSONNode_t::Real;
+		node.d = strtod(pStart, &pParsed);
+	}
+
+	*m_pCur = saved;
+
+	if (pParsed != m_pCur)
+		return Fail("malformed number");
+
+	return true;
+}
@@ -0,0 +1,100 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A JSON value in a parsed document. Nodes are stored depth first in one array, so a
+// container's first child directly follows it and "next" skips over its whole subtree.
+struct JSONNode_t
+{
+	enum Type_t : uint8_t
+	{
+		Null,
+		False,
+		True,
+		Integer,
+		Real,
+		String,
+		Array,
+		Object,
+	};
+
+	Type_t type;
+	uint32_t count; // Members of an array or object
+	uint32_t next;  // Index of the next sibling, one past the subtree
+
+	// Object members only. Points into the parsed buffer.
+	const char *pszKey;
+	uint32_t keyLen;
+
+	// Strings point into the parsed buffer, and are null terminated.
+	uint32_t len;
+	union
+	{
+		const char *psz;
+		int64_t i;
+		double d;
+	};
+};
+
+// Parses in place: strings are unescaped and terminated inside the caller's buffer, which
+// must outlive the document, and nothing is copied out of it. pData[len] must be writable.
+class JSONDocument
+{
+public:
+	bool Parse(char *pData, size_t len);
+	const char *Error() const { return m_szError; }
+
+	const JSONNode_t *Root() const { return m_Nodes.empty() ? nullptr : &m_Nodes[0]; }
+
+	// Children of an array or object, in document order.
+	const JSONNode_t *FirstChild(const JSONNode_t &node) const { return node.count ? &node + 1 : nullptr; }
+	const JSONNode_t *NextSibling(const JSONNode_t &node, const JSONNode_t &parent) const
+	{
+		return node.next < parent.next ? &m_Nodes[node.next] : nullptr;
+	}
+
+	// Last member with this key, as duplicate keys override earlier ones.
+	const JSONNode_t *Member(const JSONNode_t &object, const char *pszKey) const;
+
+private:
+	bool ParseValue(uint32_t depth);
+	bool ParseString(const char *&psz, uint32_t &len);
+	bool ParseNumber(JSONNode_t &node);
+	void SkipSpace();
+	bool Fail(const char *pszWhat);
+
+private:
+	static const uint32_t kMaxDepth = 64;
+
+	std::vector<JSONNode_t> m_Nodes;
+	char *m_pCur;
+	char *m_pEnd;
+	char m_szError[128];
+};
@@ -0,0 +1,226 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "jsonrender.h"
+#include "../jsonwriter.h"
+
+#include <cstdio>
+#include <cstring>
+
+static void WriteFunction(JSONStreamWriter &writer, const DumpReader &reader, const VDBFunction_t &func)
+{
+	writer.BeginObject();
+
+	if (func.flags & VDBFunction_HasParamNames)
+	{
+		writer.Key("arg_names");
+		writer.BeginArray();
+		for (uint32_t i = 0; i < func.params.count; ++i)
+			writer.String(reader.String(reader.Params()[func.params.first + i].name));
+		writer.EndArray();
+	}
+
+	writer.Key("args");
+	writer.BeginArray();
+	for (uint32_t i = 0; i < func.params.count; ++i)
+		writer.String(reader.String(reader.Params()[func.params.first + i].type));
+	writer.EndArray();
+
+	if (*reader.String(func.description))
+	{
+		writer.Key("description");
+		writer.String(reader.String(func.description));
+	}
+
+	writer.Key("return");
+	writer.String(reader.String(func.returnType));
+
+	writer.EndObject();
+}
+
+static void WriteFunctions(JSONStreamWriter &writer, const DumpReader &reader, const VDBRange_t &functions)
+{
+	// Already sorted and deduplicated by name.
+	writer.BeginObject();
+	for (uint32_t i = functions.first; i < functions.first + functions.count; ++i)
+	{
+		writer.Key(reader.String(reader.Functions()[i].name));
+		WriteFunction(writer, reader, reader.Functions()[i]);
+	}
+	writer.EndObject();
+}
+
+void RenderFunctionsJSON(const DumpReader &reader, OutputBuffer &out)
+{
+	static const char szGlobal[] = "Global";
+
+	JSONStreamWriter writer(out);
+	writer.BeginObject();
+
+	auto writeGlobal = [&]() {
+		writer.Key(szGlobal);
+		writer.BeginObject();
+		writer.Key("functions");
+		WriteFunctions(writer, reader, reader.Header().globalFunctions);
+		writer.EndObject();
+	};
+
+	// The global function table sits at its sorted position and replaces any class of the same name.
+	bool bWroteGlobal = false;
+	for (uint32_t i = 0; i < reader.Header().classes.count; ++i)
+	{
+		const VDBClass_t &scriptClass = reader.Classes()[i];
+		int cmp = strcmp(reader.String(scriptClass.name), szGlobal);
+		if (!bWroteGlobal && cmp >= 0)
+		{
+			writeGlobal();
+			bWroteGlobal = true;
+		}
+
+		if (cmp == 0)
+			continue;
+
+		writer.Key(reader.String(scriptClass.name));
+		writer.BeginObject();
+		if (scriptClass.description != kVDBNoString)
+		{
+			writer.Key("description");
+			writer.String(reader.String(scriptClass.description));
+		}
+		if (scriptClass.base != kVDBNoString)
+		{
+			writer.Key("extends");
+			writer.String(reader.String(scriptClass.base));
+		}
+		writer.Key("functions");
+		WriteFunctions(writer, reader, scriptClass.functions);
+		writer.EndObject();
+	}
+
+	if (!bWroteGlobal)
+		writeGlobal();
+
+	writer.EndObject();
+	out.Flush();
+}
+
+static void WriteValue(JSONStreamWriter &writer, const DumpReader &reader, const VDBConstant_t &constant)
+{
+	switch (constant.kind)
+	{
+	case VDBValue_Int:
+		writer.Integer(constant.i);
+		return;
+	case VDBValue_UInt:
+		writer.Integer(constant.u);
+		return;
+	case VDBValue_Float:
+		writer.Real(constant.f);
+		return;
+	case VDBValue_String:
+		writer.String(reader.String(constant.str));
+		return;
+	case VDBValue_Vector:
+		writer.BeginArray();
+		writer.Real(constant.vec[0]);
+		writer.Real(constant.vec[1]);
+		writer.Real(constant.vec[2]);
+		writer.EndArray();
+		return;
+	case VDBValue_Handle:
+		writer.String("<handle>");
+		return;
+	default:
+		break;
+	}
+
+	char szUnhandled[64];
+	snprintf(szUnhandled, sizeof(szUnhandled), "<unhandled_variant_type_%d>", constant.i);
+	writer.String(szUnhandled);
+}
+
+static void WriteConstants(JSONStreamWriter &writer, const DumpReader &reader, const VDBRange_t &constants)
+{
+	writer.BeginArray();
+	for (uint32_t i = constants.first; i < constants.first + constants.count; ++i)
+	{
+		const VDBConstant_t &constant = reader.Constants()[i];
+		writer.BeginObject();
+		if (*reader.String(constant.description))
+		{
+			writer.Key("description");
+			writer.String(reader.String(constant.description));
+		}
+		writer.Key("key");
+		writer.String(reader.String(constant.name));
+		if (constant.scope != kVDBNoString)
+		{
+			writer.Key("scope");
+			writer.String(reader.String(constant.scope));
+		}
+		writer.Key("value");
+		WriteValue(writer, reader, constant);
+		writer.EndObject();
+	}
+	writer.EndArray();
+}
+
+void RenderValuesJSON(const DumpReader &reader, OutputBuffer &out)
+{
+	static const char szUnscoped[] = "_Unscoped";
+
+	JSONStreamWriter writer(out);
+	writer.BeginObject();
+
+	// Globals go under _Unscoped, unless an enum already took that name.
+	bool bWroteUnscoped = false;
+	for (uint32_t i = 0; i < reader.Header().enums.count; ++i)
+	{
+		const VDBEnum_t &scriptEnum = reader.Enums()[i];
+		int cmp = strcmp(reader.String(scriptEnum.name), szUnscoped);
+		if (!bWroteUnscoped && cmp > 0)
+		{
+			writer.Key(szUnscoped);
+			WriteConstants(writer, reader, reader.Header().globalConstants);
+			bWroteUnscoped = true;
+		}
+		else if (cmp == 0)
+		{
+			bWroteUnscoped = true;
+		}
+
+		writer.Key(reader.String(scriptEnum.name));
+		WriteConstants(writer, reader, scriptEnum.constants);
+	}
+
+	if (!bWroteUnscoped)
+	{
+		writer.Key(szUnscoped);
+		WriteConstants(writer, reader, reader.Header().globalConstants);
+	}
+
+	writer.EndObject();
+	out.Flush();
+}
@@ -0,0 +1,421 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "vdbbuilder.h"
+#include "jsonparser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+bool VDBBuilder::Fail(const std::string &what)
+{
+	if (m_Error.empty())
+		m_Error = what;
+	return false;
+}
+
+bool VDBBuilder::ReadFunctions(const JSONDocument &doc, const JSONNode_t &object, std::vector<Function_t> &out)
+{
+	if (object.type != JSONNode_t::Object)
+		return Fail("\"functions\" is not an object");
+
+	for (const JSONNode_t *pNode = doc.FirstChild(object); pNode; pNode = doc.NextSibling(*pNode, object))
+	{
+		const JSONNode_t *pArgs = doc.Member(*pNode, "args");
+		const JSONNode_t *pReturn = doc.Member(*pNode, "return");
+		if (!pArgs || pArgs->type != JSONNode_t::Array || !pReturn || pReturn->type != JSONNode_t::String)
+			return Fail(std::string("function \"") + pNode->pszKey + "\" has no args or return type");
+
+		const JSONNode_t *pNames = doc.Member(*pNode, "arg_names");
+		const JSONNode_t *pDesc = doc.Member(*pNode, "description");
+
+		Function_t func;
+		func.name = pNode->pszKey;
+		func.returnType = pReturn->psz;
+		func.hasParamNames = pNames && pNames->type == JSONNode_t::Array;
+		if (pDesc && pDesc->type == JSONNode_t::String)
+			func.desc = pDesc->psz;
+
+		const JSONNode_t *pName = func.hasParamNames ? doc.FirstChild(*pNames) : nullptr;
+		for (const JSONNode_t *pArg = doc.FirstChild(*pArgs); pArg; pArg = doc.NextSibling(*pArg, *pArgs))
+		{
+			Param_t param;
+			if (pArg->type == JSONNode_t::String)
+				param.type = pArg->psz;
+			if (pName)
+			{
+				if (pName->type == JSONNode_t::String)
+					param.name = pName->psz;
+				pName = doc.NextSibling(*pName, *pNames);
+			}
+			func.params.push_back(param);
+		}
+
+		out.push_back(func);
+	}
+
+	return true;
+}
+
+bool VDBBuilder::AddFunctionsJSON(const JSONDocument &doc)
+{
+	const JSONNode_t *pRoot = doc.Root();
+	if (!pRoot || pRoot->type != JSONNode_t::Object)
+		return Fail("functions dump is not an object");
+
+	for (const JSONNode_t *pNode = doc.FirstChild(*pRoot); pNode; pNode = doc.NextSibling(*pNode, *pRoot))
+	{
+		const JSONNode_t *pFuncs = doc.Member(*pNode, "functions");
+		if (!pFuncs)
+			return Fail(std::string("class \"") + pNode->pszKey + "\" has no functions");
+
+		// The dumper writes global functions out as a class of their own.
+		if (!strcmp(pNode->pszKey, "Global"))
+		{
+			if (!ReadFunctions(doc, *pFuncs, m_GlobalFunctions))
+				return false;
+			continue;
+		}
+
+		const JSONNode_t *pDesc = doc.Member(*pNode, "description");
+		const JSONNode_t *pBase = doc.Member(*pNode, "extends");
+
+		Class_t scriptClass;
+		scriptClass.name = pNode->pszKey;
+		scriptClass.hasDesc = pDesc && pDesc->type == JSONNode_t::String;
+		scriptClass.hasBase = pBase && pBase->type == JSONNode_t::String;
+		if (scriptClass.hasDesc)
+			scriptClass.desc = pDesc->psz;
+		if (scriptClass.hasBase)
+			scriptClass.base = pBase->psz;
+
+		if (!ReadFunctions(doc, *pFuncs, scriptClass.functions))
+			return false;
+
+		m_Classes.push_back(scriptClass);
+	}
+
+	return true;
+}
+
+bool VDBBuilder::ReadConstants(const JSONDocument &doc, const JSONNode_t &array, std::vector<Constant_t> &out)
+{
+	if (array.type != JSONNode_t::Array)
+		return Fail("enum is not an array");
+
+	for (const JSONNode_t *pNode = doc.FirstChild(array); pNode; pNode = doc.NextSibling(*pNode, array))
+	{
+		const JSONNode_t *pKey = doc.Member(*pNode, "key");
+		const JSONNode_t *pValue = doc.Member(*pNode, "value");
+		if (!pKey || pKey->type != JSONNode_t::String || !pValue)
+			return Fail("constant has no key or value");
+
+		const JSONNode_t *pDesc = doc.Member(*pNode, "description");
+		const JSONNode_t *pScope = doc.Member(*pNode, "scope");
+
+		Constant_t constant;
+		memset(constant.vec, 0, sizeof(constant.vec));
+		constant.name = pKey->psz;
+		if (pDesc && pDesc->type == JSONNode_t::String)
+			constant.desc = pDesc->psz;
+		if (pScope && pScope->type == JSONNode_t::String)
+			constant.scope = pScope->psz;
+
+		// Mirrors how the dumper writes each variant type out.
+		static const char szUnhandled[] = "<unhandled_variant_type_";
+		switch (pValue->type)
+		{
+		case JSONNode_t::Integer:
+			if (pValue->i >= INT_MIN && pValue->i <= INT_MAX)
+			{
+				constant.kind = VDBValue_Int;
+				constant.i = int32_t(pValue->i);
+			}
+			else if (pValue->i >= 0 && pValue->i <= UINT_MAX)
+			{
+				constant.kind = VDBValue_UInt;
+				constant.u = uint32_t(pValue->i);
+			}
+			else
+			{
+				constant.kind = VDBValue_Float;
+				constant.f = float(pValue->i);
+			}
+			break;
+		case JSONNode_t::Real:
+			constant.kind = VDBValue_Float;
+			constant.f = float(pValue->d);
+			break;
+		case JSONNode_t::String:
+			if (!strcmp(pValue->psz, "<handle>"))
+			{
+				constant.kind = VDBValue_Handle;
+			}
+			else if (!strncmp(pValue->psz, szUnhandled, sizeof(szUnhandled) - 1))
+			{
+				constant.kind = VDBValue_Unhandled;
+				constant.i = atoi(pValue->psz + sizeof(szUnhandled) - 1);
+			}
+			else
+			{
+				constant.kind = VDBValue_String;
+				constant.str = pValue->psz;
+			}
+			break;
+		case JSONNode_t::Array:
+		{
+			if (pValue->count != 3)
+				return Fail(std::string("constant \"") + constant.name + "\" has a malformed vector");
+
+			constant.kind = VDBValue_Vector;
+			int i = 0;
+			for (const JSONNode_t *pComp = doc.FirstChild(*pValue); pComp; pComp = doc.NextSibling(*pComp, *pValue))
+				constant.vec[i++] = pComp->type == JSONNode_t::Integer ? float(pComp->i) : float(pComp->d);
+			break;
+		}
+		default:
+			return Fail(std::string("constant \"") + constant.name + "\" has an unknown value type");
+		}
+
+		out.push_back(constant);
+	}
+
+	return true;
+}
+
+bool VDBBuilder::AddValuesJSON(const JSONDocument &doc)
+{
+	const JSONNode_t *pRoot = doc.Root();
+	if (!pRoot || pRoot->type != JSONNode_t::Object)
+		return Fail("values dump is not an object");
+
+	for (const JSONNode_t *pNode = doc.FirstChild(*pRoot); pNode; pNode = doc.NextSibling(*pNode, *pRoot))
+	{
+		if (!strcmp(pNode->pszKey, "_Unscoped"))
+		{
+			if (!ReadConstants(doc, *pNode, m_GlobalConstants))
+				return false;
+			continue;
+		}
+
+		Enum_t scriptEnum;
+		scriptEnum.name = pNode->pszKey;
+		if (!ReadConstants(doc, *pNode, scriptEnum.constants))
+			return false;
+
+		m_Enums.push_back(scriptEnum);
+	}
+
+	return true;
+}
+
+namespace
+{
+	class StringTable
+	{
+	public:
+		StringTable() { m_Data.push_back(0); }
+
+		uint32_t Add(const std::string &str)
+		{
+			if (str.empty())
+				return 0;
+
+			auto result = m_Offsets.insert(std::make_pair(str, uint32_t(m_Data.size())));
+			if (result.second)
+				m_Data.insert(m_Data.end(), str.c_str(), str.c_str() + str.size() + 1);
+
+			return result.first->second;
+		}
+
+		const std::vector<char> &Data() const { return m_Data; }
+
+	private:
+		std::vector<char> m_Data;
+		std::unordered_map<std::string, uint32_t> m_Offsets;
+	};
+
+	struct Tables_t
+	{
+		StringTable strings;
+		std::vector<VDBClass_t> classes;
+		std::vector<VDBFunction_t> functions;
+		std::vector<VDBParam_t> params;
+		std::vector<VDBEnum_t> enums;
+		std::vector<VDBConstant_t> constants;
+	};
+
+	// Sorted by name, keeping only the last of any duplicates.
+	template <typename T>
+	std::vector<const T *> SortByName(const std::vector<T> &list)
+	{
+		std::vector<const T *> sorted;
+		sorted.reserve(list.size());
+		for (auto &i : list)
+			sorted.push_back(&i);
+
+		std::stable_sort(sorted.begin(), sorted.end(), [](const T *a, const T *b) {
+			return a->name < b->name;
+		});
+
+		size_t out = 0;
+		for (size_t i = 0; i < sorted.size(); ++i)
+		{
+			if (i + 1 < sorted.size() && sorted[i]->name == sorted[i + 1]->name)
+				continue;
+
+			sorted[out++] = sorted[i];
+		}
+		sorted.resize(out);
+
+		return sorted;
+	}
+
+	VDBRange_t AddFunctions(Tables_t &tables, const std::vector<VDBBuilder::Function_t> &list)
+	{
+		VDBRange_t range;
+		range.first = uint32_t(tables.functions.size());
+
+		for (auto *i : SortByName(list))
+		{
+			VDBFunction_t func;
+			func.name = tables.strings.Add(i->name);
+			func.description = tables.strings.Add(i->desc);
+			func.returnType = tables.strings.Add(i->returnType);
+			func.flags = i->hasParamNames ? uint32_t(VDBFunction_HasParamNames) : 0;
+			func.params.first = uint32_t(tables.params.size());
+			func.params.count = uint32_t(i->params.size());
+
+			for (auto &p : i->params)
+			{
+				VDBParam_t param;
+				param.name = i->hasParamNames ? tables.strings.Add(p.name) : kVDBNoString;
+				param.type = tables.strings.Add(p.type);
+				tables.params.push_back(param);
+			}
+
+			tables.functions.push_back(func);
+		}
+
+		range.count = uint32_t(tables.functions.size()) - range.first;
+		return range;
+	}
+
+	VDBRange_t AddConstants(Tables_t &tables, const std::vector<VDBBuilder::Constant_t> &list)
+	{
+		VDBRange_t range;
+		range.first = uint32_t(tables.constants.size());
+		range.count = uint32_t(list.size());
+
+		for (auto &i : list)
+		{
+			VDBConstant_t constant;
+			memset(&constant, 0, sizeof(constant));
+			constant.name = tables.strings.Add(i.name);
+			constant.description = tables.strings.Add(i.desc);
+			constant.scope = i.scope.empty() ? kVDBNoString : tables.strings.Add(i.scope);
+			constant.kind = i.kind;
+			if (i.kind == VDBValue_String)
+				constant.str = tables.strings.Add(i.str);
+			else
+				memcpy(constant.vec, i.vec, sizeof(constant.vec));
+
+			tables.constants.push_back(constant);
+		}
+
+		return range;
+	}
+
+	template <typename T>
+	VDBSection_t PlaceSection(uint32_t &offset, const std::vector<T> &records)
+	{
+		VDBSection_t section;
+		section.offset = offset;
+		section.count = uint32_t(records.size());
+		offset += uint32_t(records.size() * sizeof(T));
+		return section;
+	}
+
+	template <typename T>
+	void WriteSection(std::vector<char> &out, const std::vector<T> &records)
+	{
+		const char *p = (const char *)records.data();
+		out.insert(out.end(), p, p + records.size() * sizeof(T));
+	}
+}
+
+void VDBBuilder::Build(std::vector<char> &out) const
+{
+	Tables_t tables;
+
+	for (auto *i : SortByName(m_Classes))
+	{
+		VDBClass_t scriptClass;
+		scriptClass.name = tables.strings.Add(i->name);
+		scriptClass.description = i->hasDesc ? tables.strings.Add(i->desc) : kVDBNoString;
+		scriptClass.base = i->hasBase ? tables.strings.Add(i->base) : kVDBNoString;
+		scriptClass.functions = AddFunctions(tables, i->functions);
+		tables.classes.push_back(scriptClass);
+	}
+
+	VDBHeader_t header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kVDBMagic;
+	header.version = kVDBVersion;
+	header.vm = m_VM;
+	header.globalFunctions = AddFunctions(tables, m_GlobalFunctions);
+
+	for (auto *i : SortByName(m_Enums))
+	{
+		VDBEnum_t scriptEnum;
+		scriptEnum.name = tables.strings.Add(i->name);
+		scriptEnum.constants = AddConstants(tables, i->constants);
+		tables.enums.push_back(scriptEnum);
+	}
+	header.globalConstants = AddConstants(tables, m_GlobalConstants);
+
+	uint32_t offset = sizeof(VDBHeader_t);
+	header.classes = PlaceSection(offset, tables.classes);
+	header.functions = PlaceSection(offset, tables.functions);
+	header.params = PlaceSection(offset, tables.params);
+	header.enums = PlaceSection(offset, tables.enums);
+	header.constants = PlaceSection(offset, tables.constants);
+	header.strings.offset = offset;
+	header.strings.count = uint32_t(tables.strings.Data().size());
+	header.fileSize = offset + header.strings.count;
+
+	out.clear();
+	out.reserve(header.fileSize);
+	out.insert(out.end(), (const char *)&header, (const char *)&header + sizeof(header));
+	WriteSection(out, tables.classes);
+	WriteSection(out, tables.functions);
+	WriteSection(out, tables.params);
+	WriteSection(out, tables.enums);
+	WriteSection(out, tables.constants);
+	WriteSection(out, tables.strings.Data());
+}
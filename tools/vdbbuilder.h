@@ -0,0 +1,113 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include "../binaryformat.h"
+
+#include <string>
+#include <vector>
+
+class JSONDocument;
+struct JSONNode_t;
+
+// Owning model of one VM's dump, which can be filled from D2VDump's JSON output and written
+// out in the binary layout from binaryformat.h. Entries can be added in any order; they are
+// sorted, and duplicate names resolved to the last one added, when building.
+class VDBBuilder
+{
+public:
+	struct Param_t
+	{
+		std::string name;
+		std::string type;
+	};
+
+	struct Function_t
+	{
+		std::string name;
+		std::string desc;
+		std::string returnType;
+		bool hasParamNames;
+		std::vector<Param_t> params;
+	};
+
+	struct Class_t
+	{
+		std::string name;
+		std::string desc;
+		std::string base;
+		bool hasDesc;
+		bool hasBase;
+		std::vector<Function_t> functions;
+	};
+
+	struct Constant_t
+	{
+		std::string name;
+		std::string desc;
+		std::string scope; // Path of the table a global was set in, empty for the root
+		std::string str;   // For VDBValue_String
+		VDBValueKind_t kind;
+		union
+		{
+			int32_t i;
+			uint32_t u;
+			float f;
+			float vec[3];
+		};
+	};
+
+	struct Enum_t
+	{
+		std::string name;
+		std::vector<Constant_t> constants;
+	};
+
+public:
+	VDBBuilder() : m_VM(0) {}
+
+	// From out<vm>.json and values<vm>.json respectively.
+	bool AddFunctionsJSON(const JSONDocument &doc);
+	bool AddValuesJSON(const JSONDocument &doc);
+	const char *Error() const { return m_Error.c_str(); }
+
+	void Build(std::vector<char> &out) const;
+
+public:
+	uint32_t m_VM;
+	std::vector<Class_t> m_Classes;
+	std::vector<Function_t> m_GlobalFunctions;
+	std::vector<Enum_t> m_Enums;
+	std::vector<Constant_t> m_GlobalConstants;
+
+private:
+	bool ReadFunctions(const JSONDocument &doc, const JSONNode_t &object, std::vector<Function_t> &out);
+	bool ReadConstants(const JSONDocument &doc, const JSONNode_t &array, std::vector<Constant_t> &out);
+	bool Fail(const std::string &what);
+
+private:
+	std::string m_Error;
+};
@@ -0,0 +1,217 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumpreader.h"
+
+#include <jansson.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Compares answering "signature of Class::Function" from D2VDump's output the way tools that
+// re-parse out<vm>.json do it today, with a full jansson parse per query, against DumpReader.
+
+typedef std::chrono::steady_clock Clock;
+
+struct Query_t
+{
+	std::string className;
+	std::string funcName;
+	std::string returnType; // As the .vdb has it, to check every path answers the same
+};
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: vdumpbench [-n <queries>] <out.vdb> <out.json>\n"
+		"\n"
+		"Times class function lookups against a dump in both of its formats, which must be from the same\n"
+		"capture. Queries are spread evenly over the dump's classes (default 20).\n");
+}
+
+static double Micros(Clock::time_point start, Clock::time_point end)
+{
+	return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static const char *JanssonReturnType(const json_t *pRoot, const Query_t &query)
+{
+	const json_t *pFuncs = json_object_get(json_object_get(pRoot, query.className.c_str()), "functions");
+	return json_string_value(json_object_get(json_object_get(pFuncs, query.funcName.c_str()), "return"));
+}
+
+static const char *ReaderReturnType(const DumpReader &reader, const Query_t &query)
+{
+	const VDBClass_t *pClass = reader.FindClass(query.className.c_str());
+	const VDBFunction_t *pFunc = pClass ? reader.FindFunction(pClass->functions, query.funcName.c_str()) : nullptr;
+	return pFunc ? reader.String(pFunc->returnType) : nullptr;
+}
+
+// Mean time per query, opening the dump afresh for each one.
+template <typename Fn>
+static double TimeCold(const std::vector<Query_t> &queries, size_t &wrong, Fn answer)
+{
+	Clock::time_point start = Clock::now();
+	for (auto &query : queries)
+	{
+		std::string result;
+		if (!answer(query, result) || result != query.returnType)
+			++wrong;
+	}
+	return Micros(start, Clock::now()) / queries.size();
+}
+
+// Mean time per query against an already open dump, over enough rounds to time reliably.
+template <typename Fn>
+static double TimeWarm(const std::vector<Query_t> &queries, size_t &wrong, Fn answer)
+{
+	static const size_t kRounds = 1000;
+
+	Clock::time_point start = Clock::now();
+	for (size_t round = 0; round < kRounds; ++round)
+	{
+		for (auto &query : queries)
+		{
+			const char *pszResult = answer(query);
+			if (!pszResult || query.returnType != pszResult)
+				++wrong;
+		}
+	}
+	return Micros(start, Clock::now()) / (queries.size() * kRounds);
+}
+
+int main(int argc, char **argv)
+{
+	size_t count = 20;
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		if (!strcmp(argv[arg], "-n") && arg + 1 < argc && atoi(argv[arg + 1]) > 0)
+		{
+			count = size_t(atoi(argv[++arg]));
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (argc - arg != 2)
+	{
+		Usage();
+		return 2;
+	}
+
+	const char *pszVDB = argv[arg];
+	const char *pszJSON = argv[arg + 1];
+
+	DumpReader reader;
+	if (!reader.Open(pszVDB))
+	{
+		fprintf(stderr, "vdumpbench: %s\n", reader.Error());
+		return 2;
+	}
+
+	std::vector<Query_t> queries;
+	VDBRange_t classes = reader.AllClasses();
+	for (uint32_t i = 0; i < count && i < classes.count; ++i)
+	{
+		const VDBClass_t &scriptClass = reader.Classes()[classes.first + uint32_t(uint64_t(i) * classes.count / count)];
+		if (!scriptClass.functions.count)
+			continue;
+
+		const VDBFunction_t &func = reader.Functions()[scriptClass.functions.first + scriptClass.functions.count / 2];
+		Query_t query = { reader.String(scriptClass.name), reader.String(func.name), reader.String(func.returnType) };
+		queries.push_back(query);
+	}
+
+	if (queries.empty())
+	{
+		fprintf(stderr, "vdumpbench: %s has no class functions to look up\n", pszVDB);
+		return 2;
+	}
+
+	size_t wrong = 0;
+
+	double janssonCold = TimeCold(queries, wrong, [pszJSON](const Query_t &query, std::string &result) {
+		json_error_t error;
+		json_t *pRoot = json_load_file(pszJSON, 0, &error);
+		const char *pszResult = pRoot ? JanssonReturnType(pRoot, query) : nullptr;
+		if (pszResult)
+			result = pszResult;
+		json_decref(pRoot);
+		return pszResult != nullptr;
+	});
+
+	double vdbCold = TimeCold(queries, wrong, [pszVDB](const Query_t &query, std::string &result) {
+		DumpReader queryReader;
+		const char *pszResult = queryReader.Open(pszVDB) ? ReaderReturnType(queryReader, query) : nullptr;
+		if (pszResult)
+			result = pszResult;
+		return pszResult != nullptr;
+	});
+
+	double jsonCold = TimeCold(queries, wrong, [pszJSON](const Query_t &query, std::string &result) {
+		DumpReader queryReader;
+		const char *pszResult = queryReader.Open(pszJSON) ? ReaderReturnType(queryReader, query) : nullptr;
+		if (pszResult)
+			result = pszResult;
+		return pszResult != nullptr;
+	});
+
+	json_error_t error;
+	json_t *pRoot = json_load_file(pszJSON, 0, &error);
+	if (!pRoot)
+	{
+		fprintf(stderr, "vdumpbench: %s: %s\n", pszJSON, error.text);
+		return 2;
+	}
+
+	double janssonWarm = TimeWarm(queries, wrong, [pRoot](const Query_t &query) { return JanssonReturnType(pRoot, query); });
+	double readerWarm = TimeWarm(queries, wrong, [&reader](const Query_t &query) { return ReaderReturnType(reader, query); });
+	json_decref(pRoot);
+
+	printf("%u queries, opening the dump for each:\n", (unsigned)queries.size());
+	printf("  %-22s %12.1f us\n", "jansson, out.json", janssonCold);
+	printf("  %-22s %12.1f us  %.1fx faster\n", "DumpReader, out.vdb", vdbCold, janssonCold / vdbCold);
+	printf("  %-22s %12.1f us  %.1fx faster\n", "DumpReader, out.json", jsonCold, janssonCold / jsonCold);
+	printf("%u queries, dump already open:\n", (unsigned)queries.size());
+	printf("  %-22s %12.3f us\n", "jansson", janssonWarm);
+	printf("  %-22s %12.3f us\n", "DumpReader", readerWarm);
+
+	if (wrong)
+	{
+		fprintf(stderr, "vdumpbench: %u answers differed from the .vdb\n", (unsigned)wrong);
+		return 1;
+	}
+
+	return 0;
+}
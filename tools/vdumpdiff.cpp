@@ -0,0 +1,311 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumphash.h"
+#include "dumpreader.h"
+#include "../jsonwriter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: vdumpdiff [-t] <old dump> <new dump> [<old values.json> <new values.json>]\n"
+		"\n"
+		"Compares two dumps (.vdb or out<vm>.json, or .json.gz if the tools were built with zlib)\n"
+		"and prints one JSON object per change:\n"
+		"  {\"change\": \"added\"|\"removed\"|\"changed\", \"kind\": \"class\"|\"function\"|\"enum\"|\"constant\",\n"
+		"   \"class\"|\"enum\": <scope, if any>, \"name\": <name>, \"fields\": [<changed fields>]}\n"
+		"Added and removed classes and enums are reported once, not per member.\n"
+		"\n"
+		"  -t  Print how long loading, hashing and diffing took\n"
+		"\n"
+		"Exits with 0 if the dumps match, 1 if they differ and 2 on errors.\n");
+}
+
+struct Side_t
+{
+	DumpReader reader;
+	DumpHashes hashes;
+};
+
+class DiffPrinter
+{
+public:
+	DiffPrinter() : m_Changes(0) {}
+
+	void Change(const char *pszChange, const char *pszKind, const char *pszScopeKind, const char *pszScope, const char *pszName, const std::vector<const char *> &fields = std::vector<const char *>())
+	{
+		printf("{\"change\": \"%s\", \"kind\": \"%s\"", pszChange, pszKind);
+		if (pszScope)
+		{
+			printf(", \"%s\": ", pszScopeKind);
+			String(pszScope);
+		}
+		printf(", \"name\": ");
+		String(pszName);
+		if (!fields.empty())
+		{
+			printf(", \"fields\": [");
+			for (size_t i = 0; i < fields.size(); ++i)
+				printf("%s\"%s\"", i ? ", " : "", fields[i]);
+			printf("]");
+		}
+		printf("}\n");
+		++m_Changes;
+	}
+
+	size_t Changes() const { return m_Changes; }
+
+private:
+	static void String(const char *psz)
+	{
+		OutputBuffer escaped;
+		JSONStreamWriter::WriteEscaped(escaped, psz);
+		fwrite(escaped.Data(), 1, escaped.Size(), stdout);
+	}
+
+private:
+	size_t m_Changes;
+};
+
+static bool SameString(const char *a, const char *b)
+{
+	return a == b || (a && b && !strcmp(a, b));
+}
+
+// Walks two name-sorted runs of records together, calling fn(pOld, pNew) with null for
+// whichever side lacks the name.
+template <typename T, typename Fn>
+static void MergeByName(const Side_t &o, const T *pOld, const VDBRange_t &oldRange, const Side_t &n, const T *pNew, const VDBRange_t &newRange, Fn fn)
+{
+	uint32_t i = oldRange.first, iEnd = oldRange.first + oldRange.count;
+	uint32_t j = newRange.first, jEnd = newRange.first + newRange.count;
+	while (i < iEnd || j < jEnd)
+	{
+		int cmp = i == iEnd ? 1 : j == jEnd ? -1 : strcmp(o.reader.String(pOld[i].name), n.reader.String(pNew[j].name));
+		if (cmp < 0)
+			fn(&pOld[i++], (const T *)nullptr);
+		else if (cmp > 0)
+			fn((const T *)nullptr, &pNew[j++]);
+		else
+			fn(&pOld[i++], &pNew[j++]);
+	}
+}
+
+static void DiffFunctions(DiffPrinter &out, const Side_t &o, const VDBRange_t &oldFuncs, const Side_t &n, const VDBRange_t &newFuncs, const char *pszClass)
+{
+	MergeByName(o, o.reader.Functions(), oldFuncs, n, n.reader.Functions(), newFuncs, [&](const VDBFunction_t *pOld, const VDBFunction_t *pNew) {
+		if (!pOld || !pNew)
+		{
+			const char *pszName = pOld ? o.reader.String(pOld->name) : n.reader.String(pNew->name);
+			out.Change(pOld ? "removed" : "added", "function", "class", pszClass, pszName);
+			return;
+		}
+
+		if (o.hashes.Function(uint32_t(pOld - o.reader.Functions())) == n.hashes.Function(uint32_t(pNew - n.reader.Functions())))
+			return;
+
+		std::vector<const char *> fields;
+		if (!SameString(o.reader.String(pOld->returnType), n.reader.String(pNew->returnType)))
+			fields.push_back("return");
+
+		bool bArgs = pOld->params.count != pNew->params.count;
+		bool bNames = bArgs || (pOld->flags & VDBFunction_HasParamNames) != (pNew->flags & VDBFunction_HasParamNames);
+		for (uint32_t p = 0; p < pOld->params.count && p < pNew->params.count; ++p)
+		{
+			const VDBParam_t &oldParam = o.reader.Params()[pOld->params.first + p];
+			const VDBParam_t &newParam = n.reader.Params()[pNew->params.first + p];
+			bArgs = bArgs || !SameString(o.reader.String(oldParam.type), n.reader.String(newParam.type));
+			bNames = bNames || !SameString(o.reader.String(oldParam.name), n.reader.String(newParam.name));
+		}
+		if (bArgs)
+			fields.push_back("args");
+		if (bNames)
+			fields.push_back("arg_names");
+
+		if (!SameString(o.reader.String(pOld->description), n.reader.String(pNew->description)))
+			fields.push_back("description");
+
+		out.Change("changed", "function", "class", pszClass, o.reader.String(pOld->name), fields);
+	});
+}
+
+static void DiffConstants(DiffPrinter &out, const Side_t &o, const VDBRange_t &oldConsts, const Side_t &n, const VDBRange_t &newConsts, const char *pszEnum)
+{
+	// Constants keep registration order rather than being sorted, so match them up by name.
+	// Globals in different tables can share a name, so theirs include the table.
+	std::unordered_map<std::string, uint32_t> oldByName;
+	for (uint32_t i = 0; i < oldConsts.count; ++i)
+		oldByName[o.reader.ConstantPath(o.reader.Constants()[oldConsts.first + i])] = oldConsts.first + i;
+
+	std::unordered_map<std::string, uint32_t> newByName;
+	for (uint32_t i = 0; i < newConsts.count; ++i)
+		newByName[n.reader.ConstantPath(n.reader.Constants()[newConsts.first + i])] = newConsts.first + i;
+
+	for (uint32_t i = 0; i < oldConsts.count; ++i)
+	{
+		std::string name = o.reader.ConstantPath(o.reader.Constants()[oldConsts.first + i]);
+		auto oldIt = oldByName.find(name);
+		if (oldIt->second != oldConsts.first + i)
+			continue; // Overridden by a later duplicate
+
+		auto newIt = newByName.find(name);
+		if (newIt == newByName.end())
+		{
+			out.Change("removed", "constant", "enum", pszEnum, name.c_str());
+			continue;
+		}
+
+		if (o.hashes.Constant(oldIt->second) == n.hashes.Constant(newIt->second))
+			continue;
+
+		const VDBConstant_t &oldConst = o.reader.Constants()[oldIt->second];
+		const VDBConstant_t &newConst = n.reader.Constants()[newIt->second];
+
+		std::vector<const char *> fields;
+		bool bSameValue = oldConst.kind == newConst.kind
+			&& (oldConst.kind == VDBValue_String ? SameString(o.reader.String(oldConst.str), n.reader.String(newConst.str)) : !memcmp(oldConst.vec, newConst.vec, sizeof(oldConst.vec)));
+		if (!bSameValue)
+			fields.push_back("value");
+		if (!SameString(o.reader.String(oldConst.description), n.reader.String(newConst.description)))
+			fields.push_back("description");
+
+		out.Change("changed", "constant", "enum", pszEnum, name.c_str(), fields);
+	}
+
+	for (uint32_t i = 0; i < newConsts.count; ++i)
+	{
+		std::string name = n.reader.ConstantPath(n.reader.Constants()[newConsts.first + i]);
+		if (newByName[name] == newConsts.first + i && !oldByName.count(name))
+			out.Change("added", "constant", "enum", pszEnum, name.c_str());
+	}
+}
+
+static void Diff(DiffPrinter &out, const Side_t &o, const Side_t &n)
+{
+	MergeByName(o, o.reader.Classes(), o.reader.AllClasses(), n, n.reader.Classes(), n.reader.AllClasses(), [&](const VDBClass_t *pOld, const VDBClass_t *pNew) {
+		if (!pOld || !pNew)
+		{
+			out.Change(pOld ? "removed" : "added", "class", nullptr, nullptr, pOld ? o.reader.String(pOld->name) : n.reader.String(pNew->name));
+			return;
+		}
+
+		// Unchanged classes, which is nearly all of them between patches, stop here.
+		if (o.hashes.Class(uint32_t(pOld - o.reader.Classes())) == n.hashes.Class(uint32_t(pNew - n.reader.Classes())))
+			return;
+
+		const char *pszName = o.reader.String(pOld->name);
+
+		std::vector<const char *> fields;
+		if (!SameString(o.reader.String(pOld->base), n.reader.String(pNew->base)))
+			fields.push_back("extends");
+		if (!SameString(o.reader.String(pOld->description), n.reader.String(pNew->description)))
+			fields.push_back("description");
+		if (!fields.empty())
+			out.Change("changed", "class", nullptr, nullptr, pszName, fields);
+
+		DiffFunctions(out, o, pOld->functions, n, pNew->functions, pszName);
+	});
+
+	if (o.hashes.GlobalFunctions() != n.hashes.GlobalFunctions())
+		DiffFunctions(out, o, o.reader.Header().globalFunctions, n, n.reader.Header().globalFunctions, nullptr);
+
+	MergeByName(o, o.reader.Enums(), o.reader.AllEnums(), n, n.reader.Enums(), n.reader.AllEnums(), [&](const VDBEnum_t *pOld, const VDBEnum_t *pNew) {
+		if (!pOld || !pNew)
+		{
+			out.Change(pOld ? "removed" : "added", "enum", nullptr, nullptr, pOld ? o.reader.String(pOld->name) : n.reader.String(pNew->name));
+			return;
+		}
+
+		if (o.hashes.Enum(uint32_t(pOld - o.reader.Enums())) != n.hashes.Enum(uint32_t(pNew - n.reader.Enums())))
+			DiffConstants(out, o, pOld->constants, n, pNew->constants, o.reader.String(pOld->name));
+	});
+
+	if (o.hashes.GlobalConstants() != n.hashes.GlobalConstants())
+		DiffConstants(out, o, o.reader.Header().globalConstants, n, n.reader.Header().globalConstants, "_Unscoped");
+}
+
+int main(int argc, char **argv)
+{
+	bool bTime = false;
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		if (!strcmp(argv[arg], "-t"))
+		{
+			bTime = true;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	int paths = argc - arg;
+	if (paths != 2 && paths != 4)
+	{
+		Usage();
+		return 2;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	Side_t sides[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		if (!sides[i].reader.Open(argv[arg + i], paths == 4 ? argv[arg + 2 + i] : nullptr))
+		{
+			fprintf(stderr, "vdumpdiff: %s\n", sides[i].reader.Error());
+			return 2;
+		}
+	}
+
+	Clock::time_point loaded = Clock::now();
+	sides[0].hashes.Compute(sides[0].reader);
+	sides[1].hashes.Compute(sides[1].reader);
+
+	Clock::time_point hashed = Clock::now();
+	DiffPrinter out;
+	Diff(out, sides[0], sides[1]);
+	Clock::time_point done = Clock::now();
+
+	if (bTime)
+	{
+		typedef std::chrono::duration<double, std::milli> Ms;
+		fprintf(stderr, "load: %.3f ms, hash: %.3f ms, diff: %.3f ms, %u changes\n",
+			Ms(loaded - start).count(), Ms(hashed - loaded).count(), Ms(done - hashed).count(), (unsigned)out.Changes());
+	}
+
+	return out.Changes() ? 1 : 0;
+}
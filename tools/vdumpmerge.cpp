@@ -0,0 +1,745 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumphash.h"
+#include "dumpreader.h"
+#include "jsonrender.h"
+#include "vdbbuilder.h"
+#include "../jsonwriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: vdumpmerge [-j <threads>] [-o <outdir>] [-t] <vdump dir>...\n"
+		"\n"
+		"Merges the dumps from many servers' vdump directories into one union dump per VM, and\n"
+		"writes out<vm>.vdb, out<vm>.json and values<vm>.json for it to <outdir> (default .).\n"
+		"Each dir's out<vm>.vdb is read, or out<vm>.json and values<vm>.json if there's no .vdb\n"
+		"(or their .json.gz, if the tools were built with zlib).\n"
+		"\n"
+		"sources<vm>.json counts how many of the dirs each class, function, enum and value\n"
+		"appeared in. Anything that differs between dirs is printed as one JSON object per line:\n"
+		"  {\"conflict\": \"class\"|\"function\"|\"constant\", \"class\"|\"enum\": <scope, if any>,\n"
+		"   \"name\": <name>, \"variants\": [<dirs with each version, most common first>]}\n"
+		"and the merged dump keeps the most common version.\n"
+		"\n"
+		"  -j  Threads to load and merge with (default: one per core)\n"
+		"  -t  Print how long loading, merging and writing took\n"
+		"\n"
+		"Exits with 0 if nothing conflicted, 1 if something did and 2 on errors.\n");
+}
+
+// One VM's dump from one dir.
+struct Source_t
+{
+	DumpReader reader;
+	DumpHashes hashes;
+};
+
+// A record some source has, by index into that source's reader.
+struct Match_t
+{
+	const Source_t *pSource;
+	uint32_t index;
+};
+
+// Calls fn(i) for i in [0, count) from the given number of threads.
+template <typename Fn>
+static void ParallelFor(size_t count, unsigned threads, Fn fn)
+{
+	std::atomic<size_t> next(0);
+	auto worker = [&]() {
+		for (size_t i; (i = next++) < count;)
+			fn(i);
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned t = 1; t < threads && t < count; ++t)
+		pool.emplace_back(worker);
+	worker();
+
+	for (auto &thread : pool)
+		thread.join();
+}
+
+// Record types that are sorted by name in a dump.
+static const VDBClass_t *Records(const DumpReader &reader, const VDBClass_t *) { return reader.Classes(); }
+static const VDBFunction_t *Records(const DumpReader &reader, const VDBFunction_t *) { return reader.Functions(); }
+static const VDBEnum_t *Records(const DumpReader &reader, const VDBEnum_t *) { return reader.Enums(); }
+
+// A name-sorted run of records in one source.
+template <typename T>
+struct Run_t
+{
+	const Source_t *pSource;
+	uint32_t first;
+	uint32_t end;
+
+	const char *Name(uint32_t i) const { return pSource->reader.String(Records(pSource->reader, (const T *)nullptr)[i].name); }
+};
+
+// First record in the run whose name isn't below pszName.
+template <typename T>
+static uint32_t LowerBound(const Run_t<T> &run, const char *pszName)
+{
+	uint32_t lo = run.first, hi = run.end;
+	while (lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (strcmp(run.Name(mid), pszName) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// k-way merge of sorted runs, calling fn(matches) once per name with every source that has it,
+// in run order. Only the head of each run is ever looked at, so it streams.
+template <typename T, typename Fn>
+static void MergeRuns(const std::vector<Run_t<T>> &runs, Fn fn)
+{
+	typedef std::pair<uint32_t, uint32_t> Head_t; // Run, record
+	auto after = [&runs](const Head_t &a, const Head_t &b) {
+		int cmp = strcmp(runs[a.first].Name(a.second), runs[b.first].Name(b.second));
+		return cmp ? cmp > 0 : a.first > b.first;
+	};
+	std::priority_queue<Head_t, std::vector<Head_t>, decltype(after)> heads(after);
+
+	for (uint32_t r = 0; r < runs.size(); ++r)
+	{
+		if (runs[r].first < runs[r].end)
+			heads.push(Head_t(r, runs[r].first));
+	}
+
+	std::vector<Match_t> matches;
+	while (!heads.empty())
+	{
+		const char *pszName = runs[heads.top().first].Name(heads.top().second);
+		matches.clear();
+		do
+		{
+			Head_t head = heads.top();
+			heads.pop();
+
+			Match_t match = { runs[head.first].pSource, head.second };
+			matches.push_back(match);
+			if (++head.second < runs[head.first].end)
+				heads.push(head);
+		} while (!heads.empty() && !strcmp(runs[heads.top().first].Name(heads.top().second), pszName));
+
+		fn(matches);
+	}
+}
+
+// How many sources have each version of an entity. Most common first, ties going to whichever
+// turned up first.
+struct Variant_t
+{
+	uint32_t count;
+	Match_t first;
+};
+
+template <typename SameFn>
+static std::vector<Variant_t> CountVariants(const std::vector<Match_t> &matches, SameFn same)
+{
+	std::vector<Variant_t> variants;
+	for (auto &match : matches)
+	{
+		auto it = std::find_if(variants.begin(), variants.end(), [&](const Variant_t &v) { return same(v.first, match); });
+		if (it != variants.end())
+		{
+			++it->count;
+			continue;
+		}
+
+		Variant_t variant = { 1, match };
+		variants.push_back(variant);
+	}
+
+	std::stable_sort(variants.begin(), variants.end(), [](const Variant_t &a, const Variant_t &b) { return a.count > b.count; });
+	return variants;
+}
+
+// Per-entity source counts, in the order sources<vm>.json lists them.
+struct Counted_t
+{
+	std::string name;
+	uint32_t sources;
+	std::vector<Counted_t> members;
+};
+
+// Everything one merge task produced. Tasks cover disjoint parts of a VM and are put back
+// together in order, so the output doesn't depend on scheduling.
+struct MergeResult_t
+{
+	std::vector<VDBBuilder::Class_t> classes;
+	std::vector<VDBBuilder::Function_t> globalFunctions;
+	std::vector<VDBBuilder::Enum_t> enums;
+	std::vector<VDBBuilder::Constant_t> globalConstants;
+
+	std::vector<Counted_t> classCounts;
+	std::vector<Counted_t> functionCounts;
+	std::vector<Counted_t> enumCounts;
+	std::vector<Counted_t> valueCounts;
+
+	std::string conflicts; // Lines to print
+	size_t conflictCount = 0;
+};
+
+static void AppendString(std::string &out, const char *psz)
+{
+	OutputBuffer escaped;
+	JSONStreamWriter::WriteEscaped(escaped, psz);
+	out.append(escaped.Data(), escaped.Size());
+}
+
+static void AddConflict(MergeResult_t &result, const char *pszKind, const char *pszScopeKind, const char *pszScope, const char *pszName, const std::vector<Variant_t> &variants)
+{
+	std::string &out = result.conflicts;
+	out += "{\"conflict\": \"";
+	out += pszKind;
+	out += '"';
+	if (pszScope)
+	{
+		out += ", \"";
+		out += pszScopeKind;
+		out += "\": ";
+		AppendString(out, pszScope);
+	}
+	out += ", \"name\": ";
+	AppendString(out, pszName);
+	out += ", \"variants\": [";
+	for (size_t i = 0; i < variants.size(); ++i)
+	{
+		if (i)
+			out += ", ";
+		out += std::to_string(variants[i].count);
+	}
+	out += "]}\n";
+	++result.conflictCount;
+}
+
+static bool SameString(const char *a, const char *b)
+{
+	return a == b || (a && b && !strcmp(a, b));
+}
+
+static const char *OptString(const DumpReader &reader, uint32_t offset)
+{
+	const char *psz = reader.String(offset);
+	return psz ? psz : "";
+}
+
+static VDBBuilder::Function_t ToFunction(const Match_t &match)
+{
+	const DumpReader &reader = match.pSource->reader;
+	const VDBFunction_t &func = reader.Functions()[match.index];
+
+	VDBBuilder::Function_t out;
+	out.name = reader.String(func.name);
+	out.desc = OptString(reader, func.description);
+	out.returnType = OptString(reader, func.returnType);
+	out.hasParamNames = (func.flags & VDBFunction_HasParamNames) != 0;
+	for (uint32_t p = 0; p < func.params.count; ++p)
+	{
+		const VDBParam_t &param = reader.Params()[func.params.first + p];
+		VDBBuilder::Param_t outParam;
+		outParam.name = OptString(reader, param.name);
+		outParam.type = OptString(reader, param.type);
+		out.params.push_back(outParam);
+	}
+	return out;
+}
+
+static VDBBuilder::Constant_t ToConstant(const Match_t &match)
+{
+	const DumpReader &reader = match.pSource->reader;
+	const VDBConstant_t &constant = reader.Constants()[match.index];
+
+	VDBBuilder::Constant_t out;
+	out.name = reader.String(constant.name);
+	out.desc = OptString(reader, constant.description);
+	out.scope = OptString(reader, constant.scope);
+	out.kind = VDBValueKind_t(constant.kind);
+	memcpy(out.vec, constant.vec, sizeof(out.vec));
+	if (constant.kind == VDBValue_String)
+		out.str = OptString(reader, constant.str);
+	return out;
+}
+
+static void MergeFunctions(MergeResult_t &result, const std::vector<Run_t<VDBFunction_t>> &runs, const char *pszClass, std::vector<VDBBuilder::Function_t> &out, std::vector<Counted_t> &counts)
+{
+	MergeRuns(runs, [&](const std::vector<Match_t> &matches) {
+		std::vector<Variant_t> variants = CountVariants(matches, [](const Match_t &a, const Match_t &b) {
+			return a.pSource->hashes.Function(a.index) == b.pSource->hashes.Function(b.index);
+		});
+		out.push_back(ToFunction(variants[0].first));
+
+		Counted_t counted = { out.back().name, uint32_t(matches.size()), {} };
+		counts.push_back(counted);
+		if (variants.size() > 1)
+			AddConflict(result, "function", "class", pszClass, out.back().name.c_str(), variants);
+	});
+}
+
+// Constants aren't sorted, so they're matched up by name (and table, for globals), in the order
+// they first turn up.
+static void MergeConstants(MergeResult_t &result, const std::vector<Match_t> &scopes, VDBRange_t (*rangeOf)(const Match_t &), const char *pszEnum, std::vector<VDBBuilder::Constant_t> &out, std::vector<Counted_t> &counts)
+{
+	std::unordered_map<std::string, size_t> byName;
+	std::vector<std::vector<Match_t>> matches;
+	for (auto &scope : scopes)
+	{
+		const DumpReader &reader = scope.pSource->reader;
+		VDBRange_t range = rangeOf(scope);
+		for (uint32_t i = range.first; i < range.first + range.count; ++i)
+		{
+			auto inserted = byName.insert(std::make_pair(reader.ConstantPath(reader.Constants()[i]), matches.size()));
+			if (inserted.second)
+				matches.push_back(std::vector<Match_t>());
+
+			// A source that set the same name twice counts once, with the last value, as in its own dump.
+			std::vector<Match_t> &group = matches[inserted.first->second];
+			Match_t match = { scope.pSource, i };
+			if (!group.empty() && group.back().pSource == scope.pSource)
+				group.back() = match;
+			else
+				group.push_back(match);
+		}
+	}
+
+	for (auto &group : matches)
+	{
+		std::vector<Variant_t> variants = CountVariants(group, [](const Match_t &a, const Match_t &b) {
+			return a.pSource->hashes.Constant(a.index) == b.pSource->hashes.Constant(b.index);
+		});
+		out.push_back(ToConstant(variants[0].first));
+
+		std::string name = variants[0].first.pSource->reader.ConstantPath(variants[0].first.pSource->reader.Constants()[variants[0].first.index]);
+		Counted_t counted = { name, uint32_t(group.size()), {} };
+		counts.push_back(counted);
+		if (variants.size() > 1)
+			AddConflict(result, "constant", "enum", pszEnum, name.c_str(), variants);
+	}
+}
+
+static void MergeClasses(MergeResult_t &result, const std::vector<Run_t<VDBClass_t>> &runs)
+{
+	MergeRuns(runs, [&](const std::vector<Match_t> &matches) {
+		// Functions are compared one by one below, so only the class's own fields count here.
+		std::vector<Variant_t> variants = CountVariants(matches, [](const Match_t &a, const Match_t &b) {
+			const VDBClass_t &classA = a.pSource->reader.Classes()[a.index];
+			const VDBClass_t &classB = b.pSource->reader.Classes()[b.index];
+			return SameString(a.pSource->reader.String(classA.description), b.pSource->reader.String(classB.description))
+				&& SameString(a.pSource->reader.String(classA.base), b.pSource->reader.String(classB.base));
+		});
+
+		const DumpReader &reader = variants[0].first.pSource->reader;
+		const VDBClass_t &chosen = reader.Classes()[variants[0].first.index];
+
+		VDBBuilder::Class_t scriptClass;
+		scriptClass.name = reader.String(chosen.name);
+		scriptClass.hasDesc = chosen.description != kVDBNoString;
+		scriptClass.hasBase = chosen.base != kVDBNoString;
+		scriptClass.desc = OptString(reader, chosen.description);
+		scriptClass.base = OptString(reader, chosen.base);
+		if (variants.size() > 1)
+			AddConflict(result, "class", nullptr, nullptr, scriptClass.name.c_str(), variants);
+
+		// Nearly every class is the same on every server, and then one copy says it all.
+		bool bIdentical = std::all_of(matches.begin(), matches.end(), [&matches](const Match_t &m) {
+			return m.pSource->hashes.Class(m.index) == matches[0].pSource->hashes.Class(matches[0].index);
+		});
+
+		std::vector<Run_t<VDBFunction_t>> functionRuns;
+		for (auto &match : matches)
+		{
+			const VDBRange_t &functions = match.pSource->reader.Classes()[match.index].functions;
+			Run_t<VDBFunction_t> run = { match.pSource, functions.first, functions.first + functions.count };
+			functionRuns.push_back(run);
+			if (bIdentical)
+				break;
+		}
+
+		Counted_t counted = { scriptClass.name, uint32_t(matches.size()), {} };
+		MergeFunctions(result, functionRuns, scriptClass.name.c_str(), scriptClass.functions, counted.members);
+		if (bIdentical)
+		{
+			for (auto &member : counted.members)
+				member.sources = counted.sources;
+		}
+
+		result.classes.push_back(scriptClass);
+		result.classCounts.push_back(counted);
+	});
+}
+
+static void MergeGlobals(MergeResult_t &result, const std::vector<const Source_t *> &sources)
+{
+	std::vector<Run_t<VDBFunction_t>> functionRuns;
+	std::vector<Run_t<VDBEnum_t>> enumRuns;
+	std::vector<Match_t> globalScopes;
+	for (auto *pSource : sources)
+	{
+		const VDBHeader_t &header = pSource->reader.Header();
+		Run_t<VDBFunction_t> functions = { pSource, header.globalFunctions.first, header.globalFunctions.first + header.globalFunctions.count };
+		functionRuns.push_back(functions);
+		Run_t<VDBEnum_t> enums = { pSource, 0, header.enums.count };
+		enumRuns.push_back(enums);
+		Match_t scope = { pSource, 0 };
+		globalScopes.push_back(scope);
+	}
+
+	MergeFunctions(result, functionRuns, nullptr, result.globalFunctions, result.functionCounts);
+
+	MergeRuns(enumRuns, [&](const std::vector<Match_t> &matches) {
+		VDBBuilder::Enum_t scriptEnum;
+		scriptEnum.name = matches[0].pSource->reader.String(matches[0].pSource->reader.Enums()[matches[0].index].name);
+
+		Counted_t counted = { scriptEnum.name, uint32_t(matches.size()), {} };
+		MergeConstants(result, matches, [](const Match_t &m) { return m.pSource->reader.Enums()[m.index].constants; }, scriptEnum.name.c_str(), scriptEnum.constants, counted.members);
+
+		result.enums.push_back(scriptEnum);
+		result.enumCounts.push_back(counted);
+	});
+
+	MergeConstants(result, globalScopes, [](const Match_t &m) { return m.pSource->reader.Header().globalConstants; }, "_Unscoped", result.globalConstants, result.valueCounts);
+}
+
+// Splits the class names of a VM into about shards ranges of similar size, at names taken from
+// its largest source, and merges each range on its own.
+static std::vector<std::string> ClassSplits(const std::vector<const Source_t *> &sources, size_t shards)
+{
+	const Source_t *pLargest = nullptr;
+	for (auto *pSource : sources)
+	{
+		if (!pLargest || pSource->reader.Header().classes.count > pLargest->reader.Header().classes.count)
+			pLargest = pSource;
+	}
+
+	std::vector<std::string> splits;
+	uint32_t count = pLargest ? pLargest->reader.Header().classes.count : 0;
+	for (size_t s = 1; s < shards && count; ++s)
+	{
+		std::string name = pLargest->reader.String(pLargest->reader.Classes()[count * s / shards].name);
+		if (splits.empty() || splits.back() != name)
+			splits.push_back(name);
+	}
+	return splits;
+}
+
+static void WriteCounts(JSONStreamWriter &json, const std::vector<Counted_t> &counts, const char *pszMembers)
+{
+	json.BeginObject();
+	for (auto &counted : counts)
+	{
+		json.Key(counted.name.c_str());
+		if (!pszMembers)
+		{
+			json.Integer(counted.sources);
+			continue;
+		}
+
+		json.BeginObject();
+		json.Key("sources");
+		json.Integer(counted.sources);
+		json.Key(pszMembers);
+		WriteCounts(json, counted.members, nullptr);
+		json.EndObject();
+	}
+	json.EndObject();
+}
+
+static bool WriteFile(const std::string &path, const char *pData, size_t len)
+{
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f)
+	{
+		fprintf(stderr, "vdumpmerge: cannot write %s\n", path.c_str());
+		return false;
+	}
+
+	bool bOK = fwrite(pData, 1, len, f) == len;
+	bOK = fclose(f) == 0 && bOK;
+	if (!bOK)
+		fprintf(stderr, "vdumpmerge: failed writing %s\n", path.c_str());
+
+	return bOK;
+}
+
+static bool FileExists(const std::string &path)
+{
+	FILE *f = fopen(path.c_str(), "rb");
+	if (f)
+		fclose(f);
+	return f != nullptr;
+}
+
+// One VM's merge, split into tasks: a range of classes each, then everything else.
+struct VMMerge_t
+{
+	uint32_t vm;
+	std::vector<const Source_t *> sources;
+	std::vector<std::string> splits;
+	std::vector<MergeResult_t> results; // splits.size() + 1 class ranges, then the globals
+};
+
+int main(int argc, char **argv)
+{
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	std::string outDir = ".";
+	bool bTime = false;
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		if (!strcmp(argv[arg], "-t"))
+		{
+			bTime = true;
+		}
+		else if (!strcmp(argv[arg], "-j") && arg + 1 < argc)
+		{
+			threads = std::max(1, atoi(argv[++arg]));
+		}
+		else if (!strcmp(argv[arg], "-o") && arg + 1 < argc)
+		{
+			outDir = argv[++arg];
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (arg == argc)
+	{
+		Usage();
+		return 2;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	// Load every dir on its own thread. D2VDump always writes the main and bot VMs and numbers
+	// any others on from there, so a dir's VMs run from 0 up to the first one missing.
+	std::vector<std::string> dirs(argv + arg, argv + argc);
+	std::vector<std::vector<std::unique_ptr<Source_t>>> loaded(dirs.size());
+	std::vector<std::string> errors(dirs.size());
+	ParallelFor(dirs.size(), threads, [&](size_t d) {
+		for (uint32_t vm = 0;; ++vm)
+		{
+			std::string base = dirs[d] + "/out" + std::to_string(vm);
+			std::string values = dirs[d] + "/values" + std::to_string(vm);
+
+			// A .vdb if there is one, else the JSON, which vdump_compress leaves gzipped.
+			std::string path = base + ".vdb";
+			const char *pszValues = nullptr;
+			if (!FileExists(path))
+			{
+				const char *pszExt = FileExists(base + ".json") ? ".json" : ".json.gz";
+				path = base + pszExt;
+				values += pszExt;
+				pszValues = values.c_str();
+				if (!FileExists(path))
+					break;
+			}
+
+			std::unique_ptr<Source_t> pSource(new Source_t);
+			if (!pSource->reader.Open(path.c_str(), pszValues))
+			{
+				errors[d] = dirs[d] + ": " + pSource->reader.Error();
+				return;
+			}
+
+			pSource->hashes.Compute(pSource->reader);
+			loaded[d].push_back(std::move(pSource));
+		}
+	});
+
+	std::vector<VMMerge_t> merges;
+	for (size_t d = 0; d < dirs.size(); ++d)
+	{
+		if (!errors[d].empty())
+		{
+			fprintf(stderr, "vdumpmerge: %s\n", errors[d].c_str());
+			return 2;
+		}
+
+		for (size_t vm = 0; vm < loaded[d].size(); ++vm)
+		{
+			if (merges.size() <= vm)
+			{
+				merges.push_back(VMMerge_t());
+				merges.back().vm = uint32_t(vm);
+			}
+			merges[vm].sources.push_back(loaded[d][vm].get());
+		}
+	}
+
+	if (merges.empty())
+	{
+		fprintf(stderr, "vdumpmerge: no dumps found\n");
+		return 2;
+	}
+
+	Clock::time_point loadedTime = Clock::now();
+
+	// Classes are most of every dump, so they're what gets spread over the threads.
+	struct Task_t
+	{
+		VMMerge_t *pMerge;
+		size_t result;
+	};
+	std::vector<Task_t> tasks;
+	for (auto &merge : merges)
+	{
+		merge.splits = ClassSplits(merge.sources, threads * 4);
+		merge.results.resize(merge.splits.size() + 2);
+		for (size_t r = 0; r < merge.results.size(); ++r)
+		{
+			Task_t task = { &merge, r };
+			tasks.push_back(task);
+		}
+	}
+
+	ParallelFor(tasks.size(), threads, [&](size_t t) {
+		VMMerge_t &merge = *tasks[t].pMerge;
+		size_t r = tasks[t].result;
+		MergeResult_t &result = merge.results[r];
+		if (r == merge.splits.size() + 1)
+		{
+			MergeGlobals(result, merge.sources);
+			return;
+		}
+
+		std::vector<Run_t<VDBClass_t>> runs;
+		for (auto *pSource : merge.sources)
+		{
+			Run_t<VDBClass_t> run = { pSource, 0, pSource->reader.Header().classes.count };
+			uint32_t first = r > 0 ? LowerBound(run, merge.splits[r - 1].c_str()) : run.first;
+			uint32_t end = r < merge.splits.size() ? LowerBound(run, merge.splits[r].c_str()) : run.end;
+			run.first = first;
+			run.end = end;
+			runs.push_back(run);
+		}
+		MergeClasses(result, runs);
+	});
+
+	Clock::time_point mergedTime = Clock::now();
+
+	size_t conflicts = 0;
+	for (auto &merge : merges)
+	{
+		for (auto &result : merge.results)
+		{
+			fputs(result.conflicts.c_str(), stdout);
+			conflicts += result.conflictCount;
+		}
+	}
+
+	std::vector<char> bOK(merges.size(), 1);
+	ParallelFor(merges.size(), threads, [&](size_t m) {
+		VMMerge_t &merge = merges[m];
+		VDBBuilder builder;
+		builder.m_VM = merge.vm;
+
+		std::vector<Counted_t> classCounts;
+		MergeResult_t &globals = merge.results.back();
+		for (auto &result : merge.results)
+		{
+			builder.m_Classes.insert(builder.m_Classes.end(), result.classes.begin(), result.classes.end());
+			classCounts.insert(classCounts.end(), result.classCounts.begin(), result.classCounts.end());
+		}
+		builder.m_GlobalFunctions.swap(globals.globalFunctions);
+		builder.m_Enums.swap(globals.enums);
+		builder.m_GlobalConstants.swap(globals.globalConstants);
+
+		std::string vm = std::to_string(merge.vm);
+		std::vector<char> vdb;
+		builder.Build(vdb);
+
+		DumpReader reader;
+		if (!reader.Open(builder))
+		{
+			fprintf(stderr, "vdumpmerge: VM %s: %s\n", vm.c_str(), reader.Error());
+			bOK[m] = 0;
+			return;
+		}
+
+		OutputBuffer functions;
+		RenderFunctionsJSON(reader, functions);
+		OutputBuffer values;
+		RenderValuesJSON(reader, values);
+
+		OutputBuffer counts;
+		JSONStreamWriter json(counts);
+		json.BeginObject();
+		json.Key("sources");
+		json.Integer(merge.sources.size());
+		json.Key("classes");
+		WriteCounts(json, classCounts, "functions");
+		json.Key("functions");
+		WriteCounts(json, globals.functionCounts, nullptr);
+		json.Key("enums");
+		WriteCounts(json, globals.enumCounts, "values");
+		json.Key("values");
+		WriteCounts(json, globals.valueCounts, nullptr);
+		json.EndObject();
+
+		bOK[m] = WriteFile(outDir + "/out" + vm + ".vdb", vdb.data(), vdb.size())
+			&& WriteFile(outDir + "/out" + vm + ".json", functions.Data(), functions.Size())
+			&& WriteFile(outDir + "/values" + vm + ".json", values.Data(), values.Size())
+			&& WriteFile(outDir + "/sources" + vm + ".json", counts.Data(), counts.Size());
+	});
+
+	Clock::time_point done = Clock::now();
+
+	if (bTime)
+	{
+		typedef std::chrono::duration<double, std::milli> Ms;
+		fprintf(stderr, "load: %.3f ms, merge: %.3f ms, write: %.3f ms, %u dirs, %u VMs, %u conflicts\n",
+			Ms(loadedTime - start).count(), Ms(mergedTime - loadedTime).count(), Ms(done - mergedTime).count(),
+			(unsigned)dirs.size(), (unsigned)merges.size(), (unsigned)conflicts);
+	}
+
+	if (std::find(bOK.begin(), bOK.end(), 0) != bOK.end())
+		return 2;
+	return conflicts ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumpreader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: vdumpquery [-v values.json] [-t] <dump> <query> <name>\n"
+		"\n"
+		"  <dump>    out<vm>.vdb, or out<vm>.json (with -v for its values<vm>.json);\n"
+		"            .json.gz works too if the tools were built with zlib\n"
+		"  -t        Print how long opening the dump and answering the query took\n"
+		"\n"
+		"Queries:\n"
+		"  class <name>              Class, its base and its functions\n"
+		"  function <[class::]name>  Signature of a class or global function\n"
+		"  enum <name>               Constants of an enum, or _Unscoped for globals\n"
+		"  prefix <[class::]text>    Classes, global functions and enums starting with text,\n"
+		"                            or a class's functions when given class::text\n");
+}
+
+static void PrintFunction(const DumpReader &reader, const VDBFunction_t &func, const char *pszClass)
+{
+	printf("%s %s%s%s(", reader.String(func.returnType), pszClass ? pszClass : "", pszClass ? "::" : "", reader.String(func.name));
+	for (uint32_t i = 0; i < func.params.count; ++i)
+	{
+		const VDBParam_t &param = reader.Params()[func.params.first + i];
+		const char *pszName = reader.String(param.name);
+		printf("%s%s%s%s", i ? ", " : "", reader.String(param.type), pszName && *pszName ? " " : "", pszName ? pszName : "");
+	}
+	printf(")\n");
+
+	if (*reader.String(func.description))
+		printf("\t// %s\n", reader.String(func.description));
+}
+
+static void PrintConstants(const DumpReader &reader, const VDBRange_t &constants)
+{
+	for (uint32_t i = 0; i < constants.count; ++i)
+	{
+		const VDBConstant_t &k = reader.Constants()[constants.first + i];
+		printf("%s = ", reader.ConstantPath(k).c_str());
+		switch (k.kind)
+		{
+		case VDBValue_Int:
+			printf("%d", k.i);
+			break;
+		case VDBValue_UInt:
+			printf("%u", k.u);
+			break;
+		case VDBValue_Float:
+			printf("%.9g", k.f);
+			break;
+		case VDBValue_String:
+			printf("\"%s\"", reader.String(k.str));
+			break;
+		case VDBValue_Vector:
+			printf("(%.9g, %.9g, %.9g)", k.vec[0], k.vec[1], k.vec[2]);
+			break;
+		case VDBValue_Handle:
+			printf("<handle>");
+			break;
+		default:
+			printf("<unhandled_variant_type_%d>", k.i);
+			break;
+		}
+
+		if (*reader.String(k.description))
+			printf(" // %s", reader.String(k.description));
+		printf("\n");
+	}
+}
+
+static bool QueryClass(const DumpReader &reader, const char *pszName)
+{
+	const VDBClass_t *pClass = reader.FindClass(pszName);
+	if (!pClass)
+		return false;
+
+	printf("class %s", reader.String(pClass->name));
+	if (reader.String(pClass->base))
+		printf(" : %s", reader.String(pClass->base));
+	printf("\n");
+
+	const char *pszDesc = reader.String(pClass->description);
+	if (pszDesc && *pszDesc)
+		printf("// %s\n", pszDesc);
+
+	for (uint32_t i = 0; i < pClass->functions.count; ++i)
+		PrintFunction(reader, reader.Functions()[pClass->functions.first + i], pszName);
+
+	return true;
+}
+
+static bool QueryFunction(const DumpReader &reader, const char *pszName)
+{
+	const char *pszSep = strstr(pszName, "::");
+	if (!pszSep)
+	{
+		const VDBFunction_t *pFunc = reader.FindFunction(reader.Header().globalFunctions, pszName);
+		if (pFunc)
+			PrintFunction(reader, *pFunc, nullptr);
+		return pFunc != nullptr;
+	}
+
+	std::string className(pszName, pszSep);
+	const VDBClass_t *pClass = reader.FindClass(className.c_str());
+	const VDBFunction_t *pFunc = pClass ? reader.FindFunction(pClass->functions, pszSep + 2) : nullptr;
+	if (pFunc)
+		PrintFunction(reader, *pFunc, className.c_str());
+	return pFunc != nullptr;
+}
+
+static bool QueryEnum(const DumpReader &reader, const char *pszName)
+{
+	if (!strcmp(pszName, "_Unscoped"))
+	{
+		PrintConstants(reader, reader.Header().globalConstants);
+		return true;
+	}
+
+	const VDBEnum_t *pEnum = reader.FindEnum(pszName);
+	if (pEnum)
+		PrintConstants(reader, pEnum->constants);
+	return pEnum != nullptr;
+}
+
+static bool QueryPrefix(const DumpReader &reader, const char *pszPrefix)
+{
+	const char *pszSep = strstr(pszPrefix, "::");
+	if (pszSep)
+	{
+		std::string className(pszPrefix, pszSep);
+		const VDBClass_t *pClass = reader.FindClass(className.c_str());
+		if (!pClass)
+			return false;
+
+		VDBRange_t funcs = reader.FunctionsWithPrefix(pClass->functions, pszSep + 2);
+		for (uint32_t i = 0; i < funcs.count; ++i)
+			printf("function %s::%s\n", className.c_str(), reader.String(reader.Functions()[funcs.first + i].name));
+		return funcs.count > 0;
+	}
+
+	VDBRange_t classes = reader.ClassesWithPrefix(pszPrefix);
+	for (uint32_t i = 0; i < classes.count; ++i)
+		printf("class %s\n", reader.String(reader.Classes()[classes.first + i].name));
+
+	VDBRange_t funcs = reader.FunctionsWithPrefix(reader.Header().globalFunctions, pszPrefix);
+	for (uint32_t i = 0; i < funcs.count; ++i)
+		printf("function %s\n", reader.String(reader.Functions()[funcs.first + i].name));
+
+	VDBRange_t enums = reader.EnumsWithPrefix(pszPrefix);
+	for (uint32_t i = 0; i < enums.count; ++i)
+		printf("enum %s\n", reader.String(reader.Enums()[enums.first + i].name));
+
+	return classes.count + funcs.count + enums.count > 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *pszValuesPath = nullptr;
+	bool bTime = false;
+
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		if (!strcmp(argv[arg], "-v") && arg + 1 < argc)
+		{
+			pszValuesPath = argv[++arg];
+		}
+		else if (!strcmp(argv[arg], "-t"))
+		{
+			bTime = true;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (argc - arg != 3)
+	{
+		Usage();
+		return 2;
+	}
+
+	const char *pszDump = argv[arg];
+	const char *pszQuery = argv[arg + 1];
+	const char *pszName = argv[arg + 2];
+
+	static const struct
+	{
+		const char *pszName;
+		bool (*pfnQuery)(const DumpReader &reader, const char *pszName);
+	} queries[] = {
+		{ "class", QueryClass },
+		{ "function", QueryFunction },
+		{ "enum", QueryEnum },
+		{ "prefix", QueryPrefix },
+	};
+
+	bool (*pfnQuery)(const DumpReader &, const char *) = nullptr;
+	for (auto &q : queries)
+	{
+		if (!strcmp(q.pszName, pszQuery))
+			pfnQuery = q.pfnQuery;
+	}
+	if (!pfnQuery)
+	{
+		Usage();
+		return 2;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	DumpReader reader;
+	if (!reader.Open(pszDump, pszValuesPath))
+	{
+		fprintf(stderr, "vdumpquery: %s\n", reader.Error());
+		return 2;
+	}
+
+	Clock::time_point opened = Clock::now();
+	bool bFound = pfnQuery(reader, pszName);
+	Clock::time_point done = Clock::now();
+
+	if (!bFound)
+		fprintf(stderr, "vdumpquery: no %s matching \"%s\"\n", pszQuery, pszName);
+
+	if (bTime)
+	{
+		fprintf(stderr, "open: %.1f us, query: %.1f us\n",
+			std::chrono::duration<double, std::micro>(opened - start).count(),
+			std::chrono::duration<double, std::micro>(done - opened).count());
+	}
+
+	return bFound ? 0 : 1;
+}
@@ -0,0 +1,530 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "dumpreader.h"
+#include "jsonrender.h"
+#include "vdbbuilder.h"
+#include "../journalformat.h"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+static void Usage()
+{
+	fprintf(stderr,
+		"Usage: vdumprecover <journal> [outdir]\n"
+		"\n"
+		"  <journal>  vdump/journal.prev.bin, kept from a session that never unloaded\n"
+		"  [outdir]   Where to write out<vm>.vdb, out<vm>.json and values<vm>.json (default .)\n"
+		"\n"
+		"Replays a capture journal written with -vdump_journal and writes the dumps D2VDump would\n"
+		"have saved. Everything up to the first damaged record is recovered. Value history\n"
+		"(vdump_value_history) isn't journaled, so globals come back without it.\n");
+}
+
+// Bounds-checked cursor over one record's payload. Reads past the end fail the whole record.
+class PayloadReader
+{
+public:
+	PayloadReader(const char *pData, size_t size) : m_pData(pData), m_Size(size), m_Pos(0), m_bFailed(false) {}
+
+	bool Failed() const { return m_bFailed; }
+	// The payload was read exactly, so the record was intact.
+	bool Complete() const { return !m_bFailed && m_Pos == m_Size; }
+
+	uint32_t U32()
+	{
+		uint32_t value = 0;
+		Bytes(&value, sizeof(value));
+		return value;
+	}
+
+	uint64_t U64()
+	{
+		uint64_t value = 0;
+		Bytes(&value, sizeof(value));
+		return value;
+	}
+
+	// Returns false for a string that was never set, leaving out empty.
+	bool String(std::string &out)
+	{
+		out.clear();
+		uint32_t len = U32();
+		if (m_bFailed || len == kVDBNoString)
+			return false;
+
+		if (len > m_Size - m_Pos)
+		{
+			m_bFailed = true;
+			return false;
+		}
+
+		out.assign(m_pData + m_Pos, len);
+		m_Pos += len;
+		return true;
+	}
+
+	void Bytes(void *p, size_t len)
+	{
+		if (m_bFailed || len > m_Size - m_Pos)
+		{
+			m_bFailed = true;
+			memset(p, 0, len);
+			return;
+		}
+
+		memcpy(p, m_pData + m_Pos, len);
+		m_Pos += len;
+	}
+
+private:
+	const char *m_pData;
+	size_t m_Size;
+	size_t m_Pos;
+	bool m_bFailed;
+};
+
+static void ReadFunction(PayloadReader &in, VDBBuilder::Function_t &func)
+{
+	in.String(func.name);
+	in.String(func.desc);
+	in.String(func.returnType);
+	func.hasParamNames = (in.U32() & VDBFunction_HasParamNames) != 0;
+
+	// Counts come from the file, so grow as the params are actually read.
+	uint32_t count = in.U32();
+	for (uint32_t i = 0; i < count && !in.Failed(); ++i)
+	{
+		VDBBuilder::Param_t param;
+		in.String(param.type);
+		in.String(param.name);
+		func.params.push_back(param);
+	}
+}
+
+static void ReadValue(PayloadReader &in, VDBBuilder::Constant_t &constant)
+{
+	constant.kind = VDBValueKind_t(in.U32());
+	if (constant.kind == VDBValue_String)
+		in.String(constant.str);
+	else
+		in.Bytes(constant.vec, sizeof(constant.vec));
+}
+
+// One VM's capture as replayed so far.
+struct RecoveredVM_t
+{
+	// A table, as ScriptModel::Scope_t. Scope 0 is the root.
+	struct Scope_t
+	{
+		uint32_t parent;
+		std::string name;
+	};
+
+	static const uint32_t kNoScope = 0xFFFFFFFF;
+
+	RecoveredVM_t() { ResetScopes(); }
+
+	void ResetScopes()
+	{
+		Scope_t root = { kNoScope, std::string() };
+		scopes.assign(1, root);
+		scopeIds.clear();
+		pendingTables.clear();
+	}
+
+	// Numbered in the order values are first set in them, as the model numbers them.
+	uint32_t ScopeId(uint64_t handle)
+	{
+		if (!handle)
+			return 0;
+
+		auto inserted = scopeIds.insert(std::make_pair(handle, uint32_t(scopes.size())));
+		if (inserted.second)
+		{
+			Scope_t scope = { kNoScope, std::string() };
+			scopes.push_back(scope);
+
+			// As ScriptModel::ScopeId, a table set as a value before anything was set in it.
+			auto pending = pendingTables.find(handle);
+			if (pending != pendingTables.end())
+			{
+				size_t global = pending->second;
+				pendingTables.erase(pending);
+				LinkScope(inserted.first->second, globalScopes[global], builder.m_GlobalConstants[global].name);
+			}
+		}
+		return inserted.first->second;
+	}
+
+	uint32_t FindScope(uint64_t handle) const
+	{
+		auto found = scopeIds.find(handle);
+		return found != scopeIds.end() ? found->second : kNoScope;
+	}
+
+	// As ScriptModel::ForgetTable.
+	void ForgetTable(size_t global)
+	{
+		uint64_t handle = globalTables[global];
+		if (!handle)
+			return;
+
+		auto pending = pendingTables.find(handle);
+		if (pending != pendingTables.end() && pending->second == global)
+			pendingTables.erase(pending);
+		globalTables[global] = 0;
+	}
+
+	// As ScriptModel::LinkScope.
+	void LinkScope(uint32_t scope, uint32_t parent, const std::string &name)
+	{
+		if (scope == kNoScope || scope == 0 || scopes[scope].parent != kNoScope)
+			return;
+
+		for (uint32_t i = parent; i != kNoScope; i = scopes[i].parent)
+		{
+			if (i == scope)
+				return;
+		}
+
+		scopes[scope].parent = parent;
+		scopes[scope].name = name;
+	}
+
+	// Fills in every global's scope, with paths as ScriptModel::ScopePaths writes them.
+	void ResolveScopes()
+	{
+		std::vector<std::string> paths(scopes.size());
+		std::vector<bool> done(scopes.size(), false);
+		done[0] = true;
+
+		std::vector<uint32_t> chain;
+		for (uint32_t i = 0; i < scopes.size(); ++i)
+		{
+			for (uint32_t j = i; !done[j]; j = scopes[j].parent)
+			{
+				chain.push_back(j);
+				if (scopes[j].parent == kNoScope)
+				{
+					paths[j] = "<table " + std::to_string(j) + ">";
+					done[j] = true;
+					chain.pop_back();
+					break;
+				}
+			}
+
+			while (!chain.empty())
+			{
+				uint32_t j = chain.back();
+				chain.pop_back();
+
+				const std::string &parent = paths[scopes[j].parent];
+				paths[j] = parent;
+				if (!parent.empty() && scopes[j].name[0] != '[')
+					paths[j] += '.';
+				paths[j] += scopes[j].name;
+				done[j] = true;
+			}
+		}
+
+		for (size_t i = 0; i < builder.m_GlobalConstants.size(); ++i)
+			builder.m_GlobalConstants[i].scope = paths[globalScopes[i]];
+	}
+
+	VDBBuilder builder;
+	std::map<std::string, size_t> enumIndex; // Name to index into builder.m_Enums
+	std::map<std::pair<uint32_t, std::string>, size_t> globalIndex; // Scope and name to index into builder.m_GlobalConstants
+	std::vector<uint32_t> globalScopes; // Per global
+	std::vector<uint64_t> globalTables; // Per global, the table it holds, or 0
+	std::vector<Scope_t> scopes;
+	std::map<uint64_t, uint32_t> scopeIds;
+	std::map<uint64_t, size_t> pendingTables; // As ScriptModel's, a table nothing was set in yet to the first global holding it
+};
+
+// Applies one record the way D2VDump applied the event behind it. False if the payload is damaged,
+// in which case nothing was applied.
+static bool Replay(RecoveredVM_t &vm, uint8_t kind, PayloadReader &in)
+{
+	VDBBuilder &builder = vm.builder;
+
+	switch (kind)
+	{
+	case VDJRecord_ClearVM:
+		builder.m_Enums.clear();
+		builder.m_GlobalConstants.clear();
+		vm.enumIndex.clear();
+		vm.globalIndex.clear();
+		vm.globalScopes.clear();
+		vm.globalTables.clear();
+		vm.ResetScopes();
+		break;
+	case VDJRecord_DestroyVM:
+		// Its capture is still dumped, as it would have been at unload.
+		break;
+	case VDJRecord_Class:
+	{
+		VDBBuilder::Class_t scriptClass;
+		in.String(scriptClass.name);
+		scriptClass.hasDesc = in.String(scriptClass.desc);
+		scriptClass.hasBase = in.String(scriptClass.base);
+		uint32_t count = in.U32();
+		for (uint32_t i = 0; i < count && !in.Failed(); ++i)
+		{
+			scriptClass.functions.emplace_back();
+			ReadFunction(in, scriptClass.functions.back());
+		}
+		if (!in.Complete())
+			return false;
+
+		builder.m_Classes.push_back(std::move(scriptClass));
+		break;
+	}
+	case VDJRecord_Function:
+	{
+		VDBBuilder::Function_t func;
+		ReadFunction(in, func);
+		if (!in.Complete())
+			return false;
+
+		builder.m_GlobalFunctions.push_back(std::move(func));
+		break;
+	}
+	case VDJRecord_Value:
+	{
+		VDBBuilder::Constant_t constant;
+		uint64_t scopeHandle = in.U64();
+		in.String(constant.name);
+		ReadValue(in, constant);
+		uint64_t tableHandle = constant.kind == VDBValue_Handle ? in.U64() : 0;
+		if (!in.Complete())
+			return false;
+
+		// A table only becomes a scope once something is set in it, as in the model.
+		uint32_t scope = vm.ScopeId(scopeHandle);
+		uint32_t table = tableHandle ? vm.FindScope(tableHandle) : RecoveredVM_t::kNoScope;
+		std::string name = constant.name;
+
+		// Updated in place, keeping the position it was first set at.
+		auto inserted = vm.globalIndex.insert(std::make_pair(std::make_pair(scope, constant.name), builder.m_GlobalConstants.size()));
+		size_t global = inserted.first->second;
+		if (inserted.second)
+		{
+			builder.m_GlobalConstants.push_back(std::move(constant));
+			vm.globalScopes.push_back(scope);
+			vm.globalTables.push_back(0);
+		}
+		else
+		{
+			builder.m_GlobalConstants[global] = std::move(constant);
+			vm.ForgetTable(global);
+		}
+
+		if (tableHandle)
+		{
+			vm.globalTables[global] = tableHandle;
+			if (table == RecoveredVM_t::kNoScope)
+				vm.pendingTables.insert(std::make_pair(tableHandle, global));
+			else
+				vm.LinkScope(table, scope, name);
+		}
+		break;
+	}
+	case VDJRecord_EnumValue:
+	{
+		std::string enumName;
+		VDBBuilder::Constant_t constant;
+		in.String(enumName);
+		in.String(constant.name);
+		in.String(constant.desc);
+		ReadValue(in, constant);
+		if (!in.Complete())
+			return false;
+
+		auto inserted = vm.enumIndex.insert(std::make_pair(enumName, builder.m_Enums.size()));
+		if (inserted.second)
+		{
+			builder.m_Enums.emplace_back();
+			builder.m_Enums.back().name = enumName;
+		}
+		builder.m_Enums[inserted.first->second].constants.push_back(std::move(constant));
+		break;
+	}
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+static bool ReadWholeFile(const char *pszPath, std::vector<char> &out)
+{
+	FILE *f = fopen(pszPath, "rb");
+	if (!f)
+		return false;
+
+	char chunk[64 * 1024];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), f)) > 0)
+		out.insert(out.end(), chunk, chunk + read);
+
+	fclose(f);
+	return true;
+}
+
+static bool WriteFile(const std::string &path, const char *pData, size_t len)
+{
+	FILE *f = fopen(path.c_str(), "wb");
+	if (!f)
+	{
+		fprintf(stderr, "vdumprecover: cannot write %s\n", path.c_str());
+		return false;
+	}
+
+	bool bOK = fwrite(pData, 1, len, f) == len;
+	bOK = fclose(f) == 0 && bOK;
+	if (!bOK)
+		fprintf(stderr, "vdumprecover: failed writing %s\n", path.c_str());
+
+	return bOK;
+}
+
+// Same files as D2VDump writes, without fingerprints, so the plugin rewrites them all next time.
+static bool WriteDumps(const VDBBuilder &builder, const std::string &outDir)
+{
+	char szVM[16];
+	snprintf(szVM, sizeof(szVM), "%u", builder.m_VM);
+
+	std::vector<char> vdb;
+	builder.Build(vdb);
+	if (!WriteFile(outDir + "/out" + szVM + ".vdb", vdb.data(), vdb.size()))
+		return false;
+
+	DumpReader reader;
+	if (!reader.Open(builder))
+	{
+		fprintf(stderr, "vdumprecover: VM %s: %s\n", szVM, reader.Error());
+		return false;
+	}
+
+	OutputBuffer functions;
+	RenderFunctionsJSON(reader, functions);
+	OutputBuffer values;
+	RenderValuesJSON(reader, values);
+
+	return WriteFile(outDir + "/out" + szVM + ".json", functions.Data(), functions.Size())
+		&& WriteFile(outDir + "/values" + szVM + ".json", values.Data(), values.Size());
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3 || argv[1][0] == '-')
+	{
+		Usage();
+		return 2;
+	}
+
+	const char *pszJournal = argv[1];
+	std::string outDir = argc > 2 ? argv[2] : ".";
+
+	std::vector<char> data;
+	if (!ReadWholeFile(pszJournal, data))
+	{
+		fprintf(stderr, "vdumprecover: cannot read %s\n", pszJournal);
+		return 2;
+	}
+
+	VDJHeader_t header;
+	if (data.size() < sizeof(header))
+	{
+		fprintf(stderr, "vdumprecover: %s is too small for a journal\n", pszJournal);
+		return 2;
+	}
+
+	memcpy(&header, data.data(), sizeof(header));
+	if (header.magic != kVDJMagic || header.version != kVDJVersion)
+	{
+		fprintf(stderr, "vdumprecover: %s is not a version %u capture journal\n", pszJournal, kVDJVersion);
+		return 2;
+	}
+
+	std::vector<std::unique_ptr<RecoveredVM_t>> vms;
+	auto getVM = [&vms](uint32_t v) -> RecoveredVM_t & {
+		while (vms.size() <= v)
+		{
+			vms.emplace_back(new RecoveredVM_t);
+			vms.back()->builder.m_VM = uint32_t(vms.size() - 1);
+		}
+		return *vms[v];
+	};
+
+	// Main and bot VMs always get a dump, as they do from D2VDump.
+	getVM(1);
+
+	size_t records = 0;
+	size_t pos = sizeof(header);
+	while (pos < data.size())
+	{
+		VDJRecord_t record;
+		if (data.size() - pos < sizeof(record))
+		{
+			fprintf(stderr, "vdumprecover: journal ends partway through a record, recovered up to there\n");
+			break;
+		}
+
+		memcpy(&record, &data[pos], sizeof(record));
+		pos += sizeof(record);
+		if (record.size > data.size() - pos)
+		{
+			fprintf(stderr, "vdumprecover: journal ends partway through a record, recovered up to there\n");
+			break;
+		}
+
+		PayloadReader in(&data[pos], record.size);
+		if (!Replay(getVM(record.vm), record.kind, in))
+		{
+			fprintf(stderr, "vdumprecover: damaged record at offset %u, recovered up to there\n", unsigned(pos - sizeof(record)));
+			break;
+		}
+
+		pos += record.size;
+		++records;
+	}
+
+	bool bOK = true;
+	for (auto &vm : vms)
+	{
+		vm->ResolveScopes();
+		bOK = WriteDumps(vm->builder, outDir) && bOK;
+	}
+
+	printf("Replayed %u records, wrote dumps for %u VMs to %s\n", unsigned(records), unsigned(vms.size()), outDir.c_str());
+	return bOK ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#include "workerpool.h"
+
+#include <algorithm>
+
+static const size_t kMaxWorkerThreads = 8;
+
+WorkerPool::WorkerPool(size_t threads)
+{
+	if (!threads)
+	{
+		size_t cores = std::thread::hardware_concurrency();
+		threads = std::min(cores > 1 ? cores - 1 : 0, kMaxWorkerThreads);
+	}
+
+	for (size_t i = 0; i < threads; ++i)
+	{
+		m_Threads.emplace_back(&WorkerPool::WorkerMain, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bShutdown = true;
+	}
+	m_WorkCV.notify_all();
+
+	for (auto &t : m_Threads)
+	{
+		t.join();
+	}
+}
+
+void WorkerPool::RunBatch(Batch_t &batch)
+{
+	size_t i;
+	while ((i = batch.next.fetch_add(1)) < batch.count)
+	{
+		(*batch.pFn)(i);
+		batch.done.fetch_add(1);
+	}
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)> &fn)
+{
+	if (m_Threads.empty() || count < 2)
+	{
+		for (size_t i = 0; i < count; ++i)
+			fn(i);
+
+		return;
+	}
+
+	Batch_t batch;
+	batch.pFn = &fn;
+	batch.count = count;
+	batch.next = 0;
+	batch.done = 0;
+	batch.users = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Batches.push_back(&batch);
+	}
+	m_WorkCV.notify_all();
+
+	RunBatch(batch);
+
+	// Stop new workers from joining, then wait out the ones still on their last item.
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	auto it = std::find(m_Batches.begin(), m_Batches.end(), &batch);
+	if (it != m_Batches.end())
+		m_Batches.erase(it);
+
+	m_DoneCV.wait(lock, [&batch]() { return batch.users == 0 && batch.done == batch.count; });
+}
+
+void WorkerPool::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	for (;;)
+	{
+		m_WorkCV.wait(lock, [this]() { return m_bShutdown || !m_Batches.empty(); });
+		if (m_bShutdown)
+			return;
+
+		Batch_t *pBatch = m_Batches.front();
+		if (pBatch->next >= pBatch->count)
+		{
+			m_Batches.pop_front();
+			continue;
+		}
+
+		++pBatch->users;
+		lock.unlock();
+
+		RunBatch(*pBatch);
+
+		lock.lock();
+		if (--pBatch->users == 0)
+			m_DoneCV.notify_all();
+	}
+}
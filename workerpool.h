@@ -0,0 +1,71 @@
+/**
+* =============================================================================
+* D2VDump
+* Copyright (C) 2016 Nicholas Hastings
+* =============================================================================
+*
+* This program is free software; you can redistribute it and/or modify it under
+* the terms of the GNU General Public License, version 2.0 or later, as published
+* by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+* details.
+*
+* You should have received a copy of the GNU General Public License along with
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+* As a special exception, you are also granted permission to link the code
+* of this program (as well as its derivative works) to "Dota 2," the
+* "Source Engine, and any Game MODs that run on software by the Valve Corporation.
+* You must obey the GNU General Public License in all respects for all other
+* code used.  Additionally, this exception is granted to all derivative works.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fork-join pool. The thread calling ParallelFor works on its own batch too, so
+// batches can be nested from inside a worker without starving the pool.
+class WorkerPool
+{
+public:
+	// Zero picks one thread per spare core.
+	explicit WorkerPool(size_t threads = 0);
+	~WorkerPool();
+
+	// Counts the calling thread.
+	size_t ThreadCount() const { return m_Threads.size() + 1; }
+
+	// Runs fn(0) .. fn(count - 1) across the pool and returns once all of them are done.
+	void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+private:
+	struct Batch_t
+	{
+		const std::function<void(size_t)> *pFn;
+		size_t count;
+		std::atomic<size_t> next;
+		std::atomic<size_t> done;
+		size_t users; // Workers currently inside RunBatch, guarded by m_Mutex
+	};
+
+	void WorkerMain();
+	static void RunBatch(Batch_t &batch);
+
+private:
+	std::vector<std::thread> m_Threads;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkCV;
+	std::condition_variable m_DoneCV;
+	std::deque<Batch_t *> m_Batches;
+	bool m_bShutdown = false;
+};